@@ -0,0 +1,568 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "block_engine.h"
+#include "chip8.h"
+#include "cpu_core.h"
+#include "options.h"
+#include "pixel_expand.h"
+#include "rom.h"
+#include "wide_engine.h"
+
+#define BENCH_HANDLER_CALLS         2000000
+#define BENCH_EXPAND_FRAMES         2000
+#define BENCH_DEFAULT_FRAMES        2000
+#define BENCH_DEFAULT_CYCLES        1000    // Per frame, big enough that timing a frame costs next to nothing
+
+#ifndef CHIP8_BUILD_TYPE
+#define CHIP8_BUILD_TYPE            "unknown"
+#endif
+
+using BenchClock = std::chrono::steady_clock;
+
+typedef struct {
+    std::string json {};
+    unsigned int cyclesPerFrame { BENCH_DEFAULT_CYCLES };
+    unsigned int frames { BENCH_DEFAULT_FRAMES };
+    bool micro { true };
+    std::vector<std::string> roms {};
+}BenchOptions;
+
+// One timed case, name is what shows up in the report
+typedef struct {
+    std::string name;
+    double nsPerOp;
+}MicroResult;
+
+// Frame times in microseconds
+typedef struct {
+    double p50;
+    double p90;
+    double p99;
+    double max;
+}FramePercentiles;
+
+typedef struct {
+    std::string rom;
+    std::string engine;
+    unsigned long long instructions;
+    double seconds;
+    FramePercentiles frameTimes;
+}RomResult;
+
+typedef struct {
+    std::vector<MicroResult> handlers {};
+    std::vector<MicroResult> dispatch {};
+    std::vector<MicroResult> draw {};
+    std::vector<MicroResult> expand {};
+    std::vector<RomResult> roms {};
+}BenchReport;
+
+// Copy of the old mask/compare table, only kept here to measure against
+typedef struct {
+    unsigned short mask;
+    unsigned short opcode;
+}LinearMapping;
+
+const LinearMapping LinearLookup[] {
+    {0xFFFF, OP_CLEAR_SCREEN_MASK}, {0xFFFF, OP_RETURN_FROM_SUB_MASK},
+    {0xF000, OP_JUMP_ADDR_MASK}, {0xF000, OP_CALL_SUB_MASK},
+    {0xF000, OP_SE_VX_MASK}, {0xF000, OP_SNE_VX_MASK},
+    {0xF000, OP_SE_VX_VY_MASK}, {0xF000, OP_LOAD_VX_MASK},
+    {0xF000, OP_ADD_VX_MASK}, {0xF00F, OP_LOAD_VX_VY_MASK},
+    {0xF00F, OP_LOAD_OR_VX_VY_MASK}, {0xF00F, OP_LOAD_AND_VX_VY_MASK},
+    {0xF00F, OP_LOAD_XOR_VX_VY_MASK}, {0xF00F, OP_LOAD_ADD_VX_VY_MASK},
+    {0xF00F, OP_LOAD_SUB_VX_VY_MASK}, {0xF00F, OP_LOAD_SHIFT_RIGHT_VX_MASK},
+    {0xF00F, OP_LOAD_SUB_VY_VX_MASK}, {0xF00F, OP_LOAD_SHIFT_LEFT_VX_MASK},
+    {0xF000, OP_SNE_VX_VY_MASK}, {0xF000, OP_LOAD_I_MASK},
+    {0xF000, OP_JUMP_ADDR_V0_MASK}, {0xF000, OP_LOAD_VX_RAND_MASK},
+    {0xF000, OP_DRAW_SPRITE_MASK}, {0xF0FF, OP_SE_KEY_MASK},
+    {0xF0FF, OP_SNE_KEY_MASK}, {0xF0FF, OP_LOAD_VX_DELAY_MASK},
+    {0xF0FF, OP_LOAD_VX_KEY_MASK}, {0xF0FF, OP_LOAD_DELAY_TO_VX_MASK},
+    {0xF0FF, OP_LOAD_SOUND_TO_VX_MASK}, {0xF0FF, OP_LOAD_I_VX_MASK},
+    {0xF0FF, OP_LOAD_I_SPRITE_ADDR_MASK}, {0xF0FF, OP_BCD_VX_MASK},
+    {0xF0FF, OP_STORE_REGISTER_VALUES_MASK}, {0xF0FF, OP_LOAD_REGISTER_VALUES_MASK}
+};
+
+// Handlers timed one by one. Left out: 2NNN/00EE (the stack runs out), FX0A (parks the machine)
+typedef struct {
+    const char* name;
+    unsigned short opcode;
+}HandlerCase;
+
+const HandlerCase HandlerCases[] {
+    {"00E0 clear", 0x00E0},
+    {"00FB scroll right", 0x00FB},
+    {"00C4 scroll down", 0x00C4},
+    {"1NNN jump", 0x1300},
+    {"3XNN skip", 0x3A12},
+    {"5XY0 skip", 0x5AB0},
+    {"6XNN load", 0x6A12},
+    {"7XNN add", 0x7A01},
+    {"8XY0 move", 0x8AB0},
+    {"8XY1 or", 0x8AB1},
+    {"8XY4 add carry", 0x8AB4},
+    {"8XY5 subtract", 0x8AB5},
+    {"8XY6 shift right", 0x8AB6},
+    {"8XYE shift left", 0x8ABE},
+    {"ANNN load I", 0xA300},
+    {"BNNN jump V0", 0xB300},
+    {"CXNN random", 0xCA7F},
+    {"DXY5 draw", 0xDAB5},
+    {"EX9E skip key", 0xEA9E},
+    {"FX07 read delay", 0xFA07},
+    {"FX15 set delay", 0xFA15},
+    {"FX1E add I", 0xFA1E},
+    {"FX29 font", 0xFA29},
+    {"FX33 BCD", 0xFA33},
+    {"FX55 store", 0xF555},
+    {"FX65 load", 0xF565}
+};
+
+// Sprite shapes that take different paths through opDrawSprite
+typedef struct {
+    const char* name;
+    unsigned short opcode;
+    unsigned char x;
+    unsigned char y;
+    bool hires;
+    unsigned char planeMask;
+}DrawCase;
+
+const DrawCase DrawCases[] {
+    {"lores 8x5 aligned", 0xDAB5, 0, 4, false, 1},
+    {"lores 8x15 unaligned", 0xDABF, 29, 4, false, 1},
+    {"lores 8x5 clipped", 0xDAB5, 60, 30, false, 1},
+    {"hires 8x5 straddling", 0xDAB5, 61, 20, true, 1},
+    {"hires 16x16", 0xDAB0, 40, 20, true, 1},
+    {"hires 16x16 two planes", 0xDAB0, 40, 20, true, 3}
+};
+
+static size_t decodeLinear(unsigned short opcode) {
+    size_t index {};
+
+    for(const auto &entry : LinearLookup) {
+        if((opcode & entry.mask) == entry.opcode)
+            break;
+        index++;
+    }
+
+    return index;
+}
+
+static double secondsSince(BenchClock::time_point start) {
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+static void addRoms(const std::string& path, std::vector<std::string>& roms) {
+    if(!std::filesystem::is_directory(path)) {
+        roms.push_back(path);
+        return;
+    }
+
+    std::vector<std::string> found {};
+    for(const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+        if(entry.is_regular_file() && entry.path().extension() == ".ch8")
+            found.push_back(entry.path().string());
+    }
+
+    // Keep reports diffable between runs
+    std::sort(found.begin(), found.end());
+    roms.insert(roms.end(), found.begin(), found.end());
+
+    return;
+}
+
+static char parseOptions(int argc, char* argv[], BenchOptions& options) {
+    for(int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+
+        if(strncmp(arg, "--json=", 7) == 0)
+            options.json = arg + 7;
+        else if(strncmp(arg, "--cycles-per-frame=", 19) == 0) {
+            if(parseNumber(arg + 19, options.cyclesPerFrame) || options.cyclesPerFrame == 0)
+                return -1;
+        }
+        else if(strncmp(arg, "--frames=", 9) == 0) {
+            if(parseNumber(arg + 9, options.frames) || options.frames == 0)
+                return -1;
+        }
+        else if(strcmp(arg, "--no-micro") == 0)
+            options.micro = false;
+        else if(strncmp(arg, "--", 2) == 0)
+            return -1;
+        else if(!std::filesystem::exists(arg)) {
+            // A ROM that can't load would be timed running empty memory
+            fprintf(stderr, "No such ROM or directory %s\n", arg);
+            return -1;
+        }
+        else
+            addRoms(arg, options.roms);
+    }
+
+    // Without ROMs on the command line, the ROM collection the build points at
+    if(options.roms.empty() && std::filesystem::is_directory(CHIP8_DEFAULT_ROM_DIR))
+        addRoms(CHIP8_DEFAULT_ROM_DIR, options.roms);
+
+    return 0;
+}
+
+// Nearest rank on an already sorted list
+static double percentile(const std::vector<double>& sorted, double fraction) {
+    if(sorted.empty())
+        return 0.0;
+
+    size_t rank = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+static FramePercentiles summarizeFrames(std::vector<double>& frameTimes) {
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    return {percentile(frameTimes, 0.50), percentile(frameTimes, 0.90),
+            percentile(frameTimes, 0.99), frameTimes.empty() ? 0.0 : frameTimes.back()};
+}
+
+// Machine with some sprite data at 0x300 and every register non-zero, for the handler cases
+static std::unique_ptr<Chip8> makeBenchMachine() {
+    std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+    unsigned char sprites[32] {};
+
+    for(unsigned char index = 0; index < sizeof(sprites); index++)
+        sprites[index] = static_cast<unsigned char>(0x5A ^ (index * 37));
+    chip8->writeMemory(sprites, sizeof(sprites), 0x300);
+
+    for(unsigned char reg = 0; reg < REGISTER_COUNT; reg++)
+        chip8->setRegisterValue(reg, static_cast<unsigned char>(reg * 17 + 3));
+    chip8->setI(0x300);
+
+    return chip8;
+}
+
+// Straight calls through the predecoded handler, no fetch or decode
+static void benchHandlers(BenchReport& report) {
+    for(const HandlerCase& handlerCase : HandlerCases) {
+        std::unique_ptr<Chip8> chip8 = makeBenchMachine();
+        Opcodes::Instruction instruction = Opcodes::decodeInstruction(handlerCase.opcode);
+
+        BenchClock::time_point start = BenchClock::now();
+        for(unsigned int call = 0; call < BENCH_HANDLER_CALLS; call++) {
+            // Skips and jumps walk PC around, keep it inside ROM space
+            chip8->setProgramCounter(ROM_MEM_START);
+            chip8->setI(0x300);
+            instruction.handler(instruction, *chip8);
+        }
+        double seconds = secondsSince(start);
+
+        report.handlers.push_back({handlerCase.name, seconds / BENCH_HANDLER_CALLS * 1e9});
+    }
+
+    return;
+}
+
+// The same opcode mix through executeOpcode (decodes every time) and through predecoded handlers
+static void benchDispatch(BenchReport& report) {
+    std::vector<unsigned short> opcodes {};
+    std::vector<Opcodes::Instruction> instructions {};
+
+    for(const HandlerCase& handlerCase : HandlerCases) {
+        opcodes.push_back(handlerCase.opcode);
+        instructions.push_back(Opcodes::decodeInstruction(handlerCase.opcode));
+    }
+
+    const unsigned int rounds = BENCH_HANDLER_CALLS / opcodes.size();
+    const double calls = static_cast<double>(rounds) * opcodes.size();
+    std::unique_ptr<Chip8> chip8 = makeBenchMachine();
+    Opcodes dispatcher {};
+
+    BenchClock::time_point start = BenchClock::now();
+    for(unsigned int round = 0; round < rounds; round++) {
+        for(unsigned short opcode : opcodes) {
+            chip8->setProgramCounter(ROM_MEM_START);
+            chip8->setI(0x300);
+            dispatcher.executeOpcode(opcode, *chip8);
+        }
+    }
+    report.dispatch.push_back({"executeOpcode", secondsSince(start) / calls * 1e9});
+
+    chip8 = makeBenchMachine();
+    start = BenchClock::now();
+    for(unsigned int round = 0; round < rounds; round++) {
+        for(const Opcodes::Instruction& instruction : instructions) {
+            chip8->setProgramCounter(ROM_MEM_START);
+            chip8->setI(0x300);
+            instruction.handler(instruction, *chip8);
+        }
+    }
+    report.dispatch.push_back({"predecoded handler", secondsSince(start) / calls * 1e9});
+
+    // Decode only, linear mask scan vs the two level table
+    size_t checksum {};
+    start = BenchClock::now();
+    for(unsigned int round = 0; round < rounds; round++) {
+        for(unsigned short opcode : opcodes)
+            checksum += decodeLinear(opcode);
+    }
+    report.dispatch.push_back({"decode linear scan", secondsSince(start) / calls * 1e9});
+
+    start = BenchClock::now();
+    for(unsigned int round = 0; round < rounds; round++) {
+        for(unsigned short opcode : opcodes)
+            checksum += reinterpret_cast<size_t>(Opcodes::decodeOpcode(opcode));
+    }
+    report.dispatch.push_back({"decode table", secondsSince(start) / calls * 1e9});
+
+    // Keeps the decode loops from being optimised away
+    if(checksum == 0)
+        fprintf(stderr, "checksum 0\n");
+
+    return;
+}
+
+static void benchDraw(BenchReport& report) {
+    for(const DrawCase& drawCase : DrawCases) {
+        std::unique_ptr<Chip8> chip8 = makeBenchMachine();
+        Opcodes::Instruction highRes = Opcodes::decodeInstruction(OP_HIGH_RES_MASK);
+        Opcodes::Instruction planes = Opcodes::decodeInstruction(OP_SELECT_PLANES_MASK | (drawCase.planeMask << 8));
+        Opcodes::Instruction instruction = Opcodes::decodeInstruction(drawCase.opcode);
+
+        // Resolution and planes are set by the real opcodes so the machine stays consistent
+        if(drawCase.hires)
+            highRes.handler(highRes, *chip8);
+        planes.handler(planes, *chip8);
+
+        chip8->setRegisterValue(instruction.x, drawCase.x);
+        chip8->setRegisterValue(instruction.y, drawCase.y);
+
+        BenchClock::time_point start = BenchClock::now();
+        for(unsigned int call = 0; call < BENCH_HANDLER_CALLS; call++)
+            instruction.handler(instruction, *chip8);
+        double seconds = secondsSince(start);
+
+        report.draw.push_back({drawCase.name, seconds / BENCH_HANDLER_CALLS * 1e9});
+    }
+
+    return;
+}
+
+// What Display::renderDisplay spends on the CPU, minus the texture lock
+static void benchExpand(BenchReport& report) {
+    std::unique_ptr<Chip8> chip8 = makeBenchMachine();
+    pixels::PackedBuffer packed = chip8->getPixels();
+
+    // Busy screen on both planes so the palette path runs too
+    for(pixels::PackedPlane& plane : packed) {
+        for(size_t row = 0; row < plane.size(); row++)
+            plane[row] = 0x9E3779B97F4A7C15ULL * (row + 1);
+    }
+
+    const int scales[] {1, 4};
+    for(bool hires : {false, true}) {
+        for(int scale : scales) {
+            const int width = pixels::getWidth(hires) * scale;
+            const int height = pixels::getHeight(hires) * scale;
+            std::vector<pixels::Pixel> texture(static_cast<size_t>(width) * height);
+            const int pitch = width * sizeof(pixels::Pixel);
+
+            BenchClock::time_point start = BenchClock::now();
+            for(unsigned int frame = 0; frame < BENCH_EXPAND_FRAMES; frame++)
+                pixels::expandPackedRows(packed, hires, texture.data(), pitch, scale);
+            double seconds = secondsSince(start);
+
+            std::string name = std::string(hires ? "hires" : "lores") + " x" + std::to_string(scale);
+            report.expand.push_back({name, seconds / BENCH_EXPAND_FRAMES * 1e9});
+        }
+    }
+
+    return;
+}
+
+// Full fetch/decode/execute in frames, each frame timed on its own
+// Idle iterations the cores skip still count as instructions, as they do in Chip8Batch
+static RomResult benchRom(const BenchOptions& options, const std::string& rom, CpuCore& cpuCore, const char* engine) {
+    std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+    FileRomManager romManager;
+    std::vector<double> frameTimes {};
+    RomResult result { rom, engine, 0, 0.0, {} };
+
+    romManager.loadRom(rom, *chip8);
+    frameTimes.reserve(options.frames);
+
+    BenchClock::time_point start = BenchClock::now();
+    for(unsigned int frame = 0; frame < options.frames; frame++) {
+        BenchClock::time_point frameStart = BenchClock::now();
+
+        result.instructions += cpuCore.run(*chip8, options.cyclesPerFrame);
+        chip8->tickTimers();
+
+        frameTimes.push_back(secondsSince(frameStart) * 1e6);
+    }
+    result.seconds = secondsSince(start);
+    result.frameTimes = summarizeFrames(frameTimes);
+
+    return result;
+}
+
+// WIDE_MAX_LANES copies with their own seeds in lockstep, instructions count every lane
+static RomResult benchWide(const BenchOptions& options, const std::string& rom) {
+    std::vector<std::unique_ptr<Chip8>> machines {};
+    std::vector<Chip8*> lanes {};
+    FileRomManager romManager;
+    std::vector<double> frameTimes {};
+    RomResult result { rom, "wide", 0, 0.0, {} };
+
+    for(unsigned int lane = 0; lane < WIDE_MAX_LANES; lane++) {
+        machines.push_back(std::make_unique<Chip8>());
+        romManager.loadRom(rom, *machines.back());
+        machines.back()->seedRandom(lane);
+        lanes.push_back(machines.back().get());
+    }
+
+    // Same frames as the single machine runs, so every lane goes through the same part of the ROM
+    // Splitting the frames between the lanes would time only the start, which rarely idles
+    const unsigned int frames = options.frames;
+    WideEngine wideEngine(lanes.data(), WIDE_MAX_LANES);
+    frameTimes.reserve(frames);
+
+    BenchClock::time_point start = BenchClock::now();
+    for(unsigned int frame = 0; frame < frames; frame++) {
+        BenchClock::time_point frameStart = BenchClock::now();
+
+        result.instructions += static_cast<unsigned long long>(wideEngine.run(options.cyclesPerFrame)) * WIDE_MAX_LANES;
+        wideEngine.tickTimers();
+
+        frameTimes.push_back(secondsSince(frameStart) * 1e6);
+    }
+    result.seconds = secondsSince(start);
+    result.frameTimes = summarizeFrames(frameTimes);
+
+    return result;
+}
+
+static void printMicro(const char* title, const std::vector<MicroResult>& results) {
+    printf("%s\n", title);
+    for(const MicroResult& result : results)
+        printf("  %-26s %10.2f ns/op\n", result.name.c_str(), result.nsPerOp);
+
+    return;
+}
+
+// Paths may hold backslashes or quotes, everything else we print is plain ASCII
+static std::string jsonString(const std::string& text) {
+    std::string escaped { "\"" };
+
+    for(char character : text) {
+        if(character == '"' || character == '\\')
+            escaped += '\\';
+        escaped += character;
+    }
+
+    return escaped + "\"";
+}
+
+static void writeMicro(FILE* file, const char* key, const std::vector<MicroResult>& results, bool last = false) {
+    fprintf(file, "  \"%s\": [\n", key);
+    for(size_t index = 0; index < results.size(); index++) {
+        fprintf(file, "    {\"name\": %s, \"nsPerOp\": %.3f}%s\n", jsonString(results[index].name).c_str(),
+                results[index].nsPerOp, index + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]%s\n", last ? "" : ",");
+
+    return;
+}
+
+static char writeJson(const BenchOptions& options, const BenchReport& report) {
+    FILE* file = fopen(options.json.c_str(), "w");
+    if(file == NULL)
+        return -1;
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"buildType\": %s,\n", jsonString(CHIP8_BUILD_TYPE).c_str());
+    fprintf(file, "  \"cyclesPerFrame\": %u,\n", options.cyclesPerFrame);
+    fprintf(file, "  \"frames\": %u,\n", options.frames);
+    writeMicro(file, "handlers", report.handlers);
+    writeMicro(file, "dispatch", report.dispatch);
+    writeMicro(file, "draw", report.draw);
+    writeMicro(file, "expand", report.expand);
+
+    fprintf(file, "  \"roms\": [\n");
+    for(size_t index = 0; index < report.roms.size(); index++) {
+        const RomResult& result = report.roms[index];
+
+        fprintf(file, "    {\"rom\": %s, \"engine\": \"%s\", \"instructions\": %llu, \"mips\": %.3f, \"nsPerOp\": %.3f, "
+                      "\"frameUs\": {\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}}%s\n",
+                jsonString(std::filesystem::path(result.rom).filename().string()).c_str(), result.engine.c_str(),
+                result.instructions, result.instructions / result.seconds / 1e6, result.seconds / result.instructions * 1e9,
+                result.frameTimes.p50, result.frameTimes.p90, result.frameTimes.p99, result.frameTimes.max,
+                index + 1 < report.roms.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options {};
+    BenchReport report {};
+
+    if(parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s [--json=FILE] [--cycles-per-frame=N] [--frames=N] [--no-micro] [ROM or directory]...\n"
+                        "Runs the ROMs in %s when none are given\n", argv[0], CHIP8_DEFAULT_ROM_DIR);
+        return -1;
+    }
+
+    // Otherwise --no-micro would time nothing and still look like it passed
+    if(options.roms.empty()) {
+        fprintf(stderr, "No ROMs given and none found in %s\n", CHIP8_DEFAULT_ROM_DIR);
+        return -1;
+    }
+
+    // Debug numbers say nothing about the core, but still let the harness itself be checked
+    if(strcmp(CHIP8_BUILD_TYPE, "Release") != 0 && strcmp(CHIP8_BUILD_TYPE, "RelWithDebInfo") != 0)
+        fprintf(stderr, "Warning: %s build, configure with -DCMAKE_BUILD_TYPE=Release for real numbers\n", CHIP8_BUILD_TYPE);
+
+#ifdef CHIP8_PROFILE
+    fprintf(stderr, "Warning: profiling hooks are compiled in, configure with -DCHIP8_PROFILE=OFF for real numbers\n");
+#endif
+
+    if(options.micro) {
+        benchHandlers(report);
+        benchDispatch(report);
+        benchDraw(report);
+        benchExpand(report);
+
+        printMicro("handlers", report.handlers);
+        printMicro("dispatch", report.dispatch);
+        printMicro("opDrawSprite", report.draw);
+        printMicro("renderDisplay expansion (per frame)", report.expand);
+    }
+
+    for(const auto &rom : options.roms) {
+        InterpreterCore interpreterCore;
+        BlockCore blockCore;
+
+        printf("%s\n", std::filesystem::path(rom).filename().string().c_str());
+        report.roms.push_back(benchRom(options, rom, interpreterCore, "interp"));
+        report.roms.push_back(benchRom(options, rom, blockCore, "block"));
+        report.roms.push_back(benchWide(options, rom));
+
+        for(size_t index = report.roms.size() - 3; index < report.roms.size(); index++) {
+            const RomResult& result = report.roms[index];
+            printf("  %-7s %9.2f MIPS %8.2f ns/op   frame us p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f\n",
+                    result.engine.c_str(), result.instructions / result.seconds / 1e6, result.seconds / result.instructions * 1e9,
+                    result.frameTimes.p50, result.frameTimes.p90, result.frameTimes.p99, result.frameTimes.max);
+        }
+    }
+
+    if(!options.json.empty() && writeJson(options, report)) {
+        fprintf(stderr, "Could not write %s\n", options.json.c_str());
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <cstdio>
+#include "aot.h"
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+AotLibrary::~AotLibrary() {
+#ifndef _WIN32
+    for(const auto &entry : modules) {
+        if(entry.second.handle != nullptr)
+            dlclose(entry.second.handle);
+    }
+#endif
+}
+
+std::string AotLibrary::getModuleName(unsigned long long romHash) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llX.so", romHash);
+
+    return name;
+}
+
+const AotModule* AotLibrary::find(unsigned long long romHash) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = modules.find(romHash);
+    if(found != modules.end())
+        return found->second.module;
+
+    // Misses are remembered too, a ROM without a module shouldn't hit the disk every time
+    LoadedModule& loaded = modules[romHash];
+    loaded = {nullptr, nullptr};
+
+#ifndef _WIN32
+    const std::string path = directory + "/" + getModuleName(romHash);
+
+    loaded.handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(loaded.handle == nullptr)
+        return nullptr;
+
+    typedef const AotModule*(*EntryPoint)();
+    EntryPoint entryPoint = reinterpret_cast<EntryPoint>(dlsym(loaded.handle, AOT_ENTRY_POINT));
+    const AotModule* module = (entryPoint != nullptr) ? entryPoint() : nullptr;
+
+    if(module == nullptr || module->abiVersion != AOT_ABI_VERSION || module->chip8Size != sizeof(Chip8) ||
+       module->romHash != romHash) {
+        LOG_WARN("Ignoring %s, it was built for a different ROM or emulator build", path.c_str());
+        dlclose(loaded.handle);
+        loaded.handle = nullptr;
+        return nullptr;
+    }
+
+    loaded.module = module;
+#endif
+
+    return loaded.module;
+}
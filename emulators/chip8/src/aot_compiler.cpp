@@ -0,0 +1,505 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "aot.h"
+#include "block_engine.h"
+#include "chip8.h"
+#include "rom.h"
+
+#ifndef CHIP8_INCLUDE_DIR
+#define CHIP8_INCLUDE_DIR   "src/inc"
+#endif
+
+#ifndef CHIP8_AOT_CXX
+#define CHIP8_AOT_CXX       "c++"
+#endif
+
+typedef struct {
+    std::string outputDir { "aot" };
+    std::string compiler { CHIP8_AOT_CXX };
+    bool sourceOnly {};
+    std::vector<std::string> roms {};
+}AotOptions;
+
+// Registers and timers the generated body needs a local reference to
+typedef struct {
+    bool registers;
+    bool index;
+    bool delay;
+    bool sound;
+    bool handlers;
+}AotUses;
+
+// Walks a ROM's control flow with BlockCore's own block former and writes the bodies out as C++
+class AotCompiler {
+    public:
+        AotCompiler(Chip8& chip8) : chip8(chip8) {};
+
+        // Every block reachable from ROM_MEM_START without knowing register values
+        void discover();
+
+        void writeSource(FILE* file, const std::string& romName, unsigned long long romHash) const;
+
+        size_t getBlockCount() const { return starts.size(); };
+        size_t getInstructionCount() const;
+
+    private:
+        void addSuccessors(unsigned short addr, const BlockCore::Block* block, std::vector<unsigned short>& pending) const;
+        static void addTargets(unsigned short opcode, unsigned short next, std::vector<unsigned short>& pending);
+        static bool emitSkip(const Opcodes::Instruction& instruction, std::string& condition, AotUses& uses);
+        static bool emitInline(const Opcodes::Instruction& instruction, std::string& line, AotUses& uses);
+        static bool loopsBack(const BlockCore::Block& block, size_t index);
+        static bool hasLoop(const BlockCore::Block& block);
+        static std::string emitClose(const BlockCore::Block& block, size_t index);
+        void writeBody(FILE* file, const BlockCore::Block& block, bool loop) const;
+        void writeBlock(FILE* file, const BlockCore::Block& block) const;
+
+        Chip8& chip8;
+        BlockCore core {};
+        std::vector<unsigned short> starts {};     // Blocks with a body worth compiling
+};
+
+void AotCompiler::discover() {
+    std::set<unsigned short> seen {};
+    std::vector<unsigned short> pending { ROM_MEM_START };
+
+    while(!pending.empty()) {
+        const unsigned short addr = pending.back();
+        pending.pop_back();
+
+        if(addr < ROM_MEM_START || addr >= CHIP_8_MEM_SIZE - 1 || !seen.insert(addr).second)
+            continue;
+
+        const BlockCore::Block* block = core.findBlock(chip8, addr);
+        addSuccessors(addr, block, pending);
+
+        if(block != nullptr && !block->body.empty())
+            starts.push_back(addr);
+    }
+
+    std::sort(starts.begin(), starts.end());
+
+    return;
+}
+
+// Where control can go after the block, computed jumps (BNNN) and returns are left to runtime
+// Returns are still covered, every call pushes the address after it
+void AotCompiler::addSuccessors(unsigned short addr, const BlockCore::Block* block, std::vector<unsigned short>& pending) const {
+    // Folded jumps or a lone handler, the interpreter runs it and carries on from there
+    if(block == nullptr) {
+        addTargets(GET_OPCODE(chip8.getMachineCode(addr), chip8.getMachineCode(addr + 1)), addr + 2, pending);
+        return;
+    }
+
+    // Control flow behind a skip can leave the block partway through
+    for(size_t index = 0; index < block->body.size(); index++) {
+        if(BlockCore::isLeave(block->steps[index].kind))
+            addTargets(block->body[index].opcode, block->steps[index].addr + 2, pending);
+    }
+
+    if(block->exit.handler == nullptr) {
+        pending.push_back(block->exitAddr);
+        return;
+    }
+
+    addTargets(block->exit.opcode, block->exitAddr + 2, pending);
+
+    return;
+}
+
+// Successors of a control flow instruction, next is the address after it
+void AotCompiler::addTargets(unsigned short opcode, unsigned short next, std::vector<unsigned short>& pending) {
+    switch(opcode & 0xF000) {
+        case OP_JUMP_ADDR_MASK:
+            pending.push_back(opcode & 0xFFF);
+            break;
+        case OP_CALL_SUB_MASK:
+            pending.push_back(opcode & 0xFFF);
+            pending.push_back(next);
+            break;
+        case OP_SE_VX_MASK:
+        case OP_SNE_VX_MASK:
+        case OP_SE_VX_VY_MASK:
+        case OP_SNE_VX_VY_MASK:
+        case 0xE000:
+            pending.push_back(next);
+            pending.push_back(next + 2);
+            break;
+        case OP_JUMP_ADDR_V0_MASK:
+            break;
+        case 0x0000:
+            if(opcode != OP_RETURN_FROM_SUB_MASK && opcode != OP_EXIT_MASK)
+                pending.push_back(next);
+            break;
+        default:
+            pending.push_back(next);
+
+            // F000 NNNN carries its operand in the next word
+            if(opcode == OP_LOAD_I_LONG_MASK)
+                pending.push_back(next + 2);
+            break;
+    }
+
+    return;
+}
+
+// Handlers without quirk variants become plain C++, anything else keeps its handler call
+// Each line does exactly what the handler does, including the order VF is written in
+bool AotCompiler::emitInline(const Opcodes::Instruction& instruction, std::string& line, AotUses& uses) {
+    char buffer[160];
+    const unsigned short opcode = instruction.opcode;
+    const unsigned int x = instruction.x;
+    const unsigned int y = instruction.y;
+
+    switch(opcode & 0xF000) {
+        case OP_LOAD_VX_MASK:
+            snprintf(buffer, sizeof(buffer), "v[0x%X] = 0x%02X;", x, instruction.nn);
+            break;
+        case OP_ADD_VX_MASK:
+            snprintf(buffer, sizeof(buffer), "v[0x%X] = static_cast<unsigned char>(v[0x%X] + 0x%02X);", x, x, instruction.nn);
+            break;
+        case OP_LOAD_I_MASK:
+            snprintf(buffer, sizeof(buffer), "I = 0x%03X;", instruction.nnn);
+            uses.index = true;
+            line = buffer;
+            return true;
+        case OP_LOAD_VX_VY_MASK:
+            switch(opcode & 0xF00F) {
+                case OP_LOAD_VX_VY_MASK:
+                    snprintf(buffer, sizeof(buffer), "v[0x%X] = v[0x%X];", x, y);
+                    break;
+                case OP_LOAD_ADD_VX_VY_MASK:
+                    snprintf(buffer, sizeof(buffer), "{ const int sum = v[0x%X] + v[0x%X]; v[0x%X] = static_cast<unsigned char>(sum); v[0xF] = sum > 255; }", x, y, x);
+                    break;
+                case OP_LOAD_SUB_VX_VY_MASK:
+                    snprintf(buffer, sizeof(buffer), "{ const unsigned char vx = v[0x%X], vy = v[0x%X]; v[0x%X] = static_cast<unsigned char>(vx - vy); v[0xF] = vy <= vx; }", x, y, x);
+                    break;
+                case OP_LOAD_SUB_VY_VX_MASK:
+                    snprintf(buffer, sizeof(buffer), "{ const unsigned char vx = v[0x%X], vy = v[0x%X]; v[0x%X] = static_cast<unsigned char>(vy - vx); v[0xF] = vy >= vx; }", x, y, x);
+                    break;
+                default:
+                    return false;
+            }
+            break;
+        case 0xF000:
+            switch(opcode & 0xF0FF) {
+                case OP_LOAD_VX_DELAY_MASK:
+                    snprintf(buffer, sizeof(buffer), "v[0x%X] = static_cast<unsigned char>(delayTimer);", x);
+                    uses.delay = true;
+                    break;
+                case OP_LOAD_DELAY_TO_VX_MASK:
+                    snprintf(buffer, sizeof(buffer), "delayTimer = v[0x%X];", x);
+                    uses.delay = true;
+                    break;
+                case OP_LOAD_SOUND_TO_VX_MASK:
+                    snprintf(buffer, sizeof(buffer), "soundTimer = v[0x%X];", x);
+                    uses.sound = true;
+                    break;
+                case OP_LOAD_I_VX_MASK:
+                    snprintf(buffer, sizeof(buffer), "I = static_cast<unsigned short>(I + v[0x%X]);", x);
+                    uses.index = true;
+                    break;
+                case OP_LOAD_I_SPRITE_ADDR_MASK:
+                    snprintf(buffer, sizeof(buffer), "I = 0x%X + (v[0x%X] & 0xF) * %d;", FONT_START, x, FONT_CHAR_SIZE);
+                    uses.index = true;
+                    break;
+                default:
+                    return false;
+            }
+            break;
+        default:
+            return false;
+    }
+
+    uses.registers = true;
+    line = buffer;
+
+    return true;
+}
+
+// Condition under which a skip in the body steps over the next instruction
+bool AotCompiler::emitSkip(const Opcodes::Instruction& instruction, std::string& condition, AotUses& uses) {
+    char buffer[96];
+    const unsigned short opcode = instruction.opcode;
+    const unsigned int x = instruction.x;
+    const unsigned int y = instruction.y;
+
+    switch(opcode & 0xF000) {
+        case OP_SE_VX_MASK:
+            snprintf(buffer, sizeof(buffer), "v[0x%X] == 0x%02X", x, instruction.nn);
+            break;
+        case OP_SNE_VX_MASK:
+            snprintf(buffer, sizeof(buffer), "v[0x%X] != 0x%02X", x, instruction.nn);
+            break;
+        case OP_SE_VX_VY_MASK:
+            if(Opcodes::isRegisterRange(opcode))
+                return false;
+            snprintf(buffer, sizeof(buffer), "v[0x%X] == v[0x%X]", x, y);
+            break;
+        case OP_SNE_VX_VY_MASK:
+            snprintf(buffer, sizeof(buffer), "v[0x%X] != v[0x%X]", x, y);
+            break;
+        case 0xE000:
+            snprintf(buffer, sizeof(buffer), "%s(chip8.getKeyMask() & (1 << (v[0x%X] & 0xF)))",
+                     ((opcode & 0xF0FF) == OP_SE_KEY_MASK) ? "" : "!", x);
+            break;
+        default:
+            return false;
+    }
+
+    uses.registers = true;
+    condition = buffer;
+
+    return true;
+}
+
+// Whether the leave at index, or the exit for the body's length, jumps back to the block's start
+bool AotCompiler::loopsBack(const BlockCore::Block& block, size_t index) {
+    if(index == block.body.size())
+        return block.exitKind == BlockCore::ExitKind::Jump && block.exit.nnn == block.start;
+
+    return block.steps[index].kind == BlockCore::BodyKind::LeaveJump && block.body[index].nnn == block.start;
+}
+
+bool AotCompiler::hasLoop(const BlockCore::Block& block) {
+    for(size_t index = 0; index <= block.body.size(); index++) {
+        if(loopsBack(block, index))
+            return true;
+    }
+
+    return false;
+}
+
+// A loop's jump back to start, the last pass it may close leaves it to BlockCore like a body would
+std::string AotCompiler::emitClose(const BlockCore::Block& block, size_t index) {
+    char buffer[200];
+    const bool exit = index == block.body.size();
+    const unsigned int count = exit ? block.length : block.steps[index].count;
+    const unsigned short pollSkips = exit ? block.pollSkips : block.steps[index].pollSkips;
+    std::string polling = "false";
+
+    if(pollSkips != BLOCK_NOT_POLLING)
+        polling = "skipped == " + std::to_string(pollSkips);
+
+    snprintf(buffer, sizeof(buffer), "if(pass == passes) return %zu; if(AotAccess::closeLoop(chip8, 0x%04X, %u - skipped, %s)) return AOT_LOOP_IDLE + %zu;",
+             index, block.start, count, polling.c_str(), index);
+
+    return buffer;
+}
+
+// The body on its own, or as a loop that closes the jumps back to start itself
+void AotCompiler::writeBody(FILE* file, const BlockCore::Block& block, bool loop) const {
+    std::vector<std::string> lines {};
+    AotUses uses {};
+    char buffer[96];
+
+    bool skips {};
+    bool guarded {};     // The previous instruction was a skip
+
+    for(size_t index = 0; index < block.body.size(); index++) {
+        const Opcodes::Instruction& instruction = block.body[index];
+        std::string line {};
+
+        const bool skip = emitSkip(instruction, line, uses);
+
+        // Control flow the skip didn't step over is left to BlockCore
+        if(skip) {
+            line = "const bool skip" + std::to_string(index) + " = " + line + ";";
+            skips = true;
+        }
+        else if(loop && loopsBack(block, index))
+            line = emitClose(block, index) + " continue;";
+        else if(BlockCore::isLeave(block.steps[index].kind))
+            line = "return " + std::to_string(index) + ";";
+        else if(!emitInline(instruction, line, uses)) {
+            snprintf(buffer, sizeof(buffer), "body[%zu].handler(body[%zu], chip8);", index, index);
+            line = buffer;
+            uses.handlers = true;
+        }
+
+        // The skip before this instruction decides whether it runs
+        if(guarded)
+            line = "if(skip" + std::to_string(index - 1) + ") skipped++; else { " + line + " }";
+        guarded = skip;
+
+        // Opcode comments line up past the longest inline form
+        snprintf(buffer, sizeof(buffer), " // %04X", instruction.opcode);
+        line.resize(std::max<size_t>(line.size(), 104), ' ');
+        lines.push_back(line + buffer);
+    }
+
+    if(loop) {
+        fprintf(file, "static unsigned int loop%04X(Chip8& chip8, const Opcodes::Instruction*%s, unsigned int passes, unsigned int& skipped) {\n",
+                block.start, uses.handlers ? " body" : "");
+    }
+    else {
+        fprintf(file, "static unsigned int block%04X(Chip8& chip8, const Opcodes::Instruction*%s, unsigned int&%s) {\n",
+                block.start, uses.handlers ? " body" : "", skips ? " skipped" : "");
+    }
+    if(uses.registers)
+        fprintf(file, "    unsigned char* v = AotAccess::registers(chip8);\n");
+    if(uses.index)
+        fprintf(file, "    unsigned short& I = AotAccess::indexRegister(chip8);\n");
+    if(uses.delay)
+        fprintf(file, "    unsigned short& delayTimer = AotAccess::delayTimer(chip8);\n");
+    if(uses.sound)
+        fprintf(file, "    unsigned short& soundTimer = AotAccess::soundTimer(chip8);\n");
+    fprintf(file, "\n");
+
+    if(!loop) {
+        for(const std::string& line : lines)
+            fprintf(file, "    %s\n", line.c_str());
+        fprintf(file, "\n    return %zu;\n}\n\n", block.body.size());
+
+        return;
+    }
+
+    fprintf(file, "    for(unsigned int pass = 0;; pass++) {\n        skipped = 0;\n\n");
+    for(const std::string& line : lines)
+        fprintf(file, "        %s\n", line.c_str());
+    if(loopsBack(block, block.body.size()))
+        fprintf(file, "\n        %s\n    }\n}\n\n", emitClose(block, block.body.size()).c_str());
+    else
+        fprintf(file, "\n        return %zu;\n    }\n}\n\n", block.body.size());
+
+    return;
+}
+
+void AotCompiler::writeBlock(FILE* file, const BlockCore::Block& block) const {
+    writeBody(file, block, false);
+    if(hasLoop(block))
+        writeBody(file, block, true);
+
+    fprintf(file, "static const unsigned short opcodes%04X[] {", block.start);
+    for(size_t index = 0; index < block.body.size(); index++)
+        fprintf(file, "%s0x%04X", index ? ", " : " ", block.body[index].opcode);
+    fprintf(file, " };\n\n");
+
+    return;
+}
+
+void AotCompiler::writeSource(FILE* file, const std::string& romName, unsigned long long romHash) const {
+    fprintf(file, "// Generated by Chip8Aot from %s, do not edit\n", romName.c_str());
+    fprintf(file, "#include \"aot.h\"\n\n");
+
+    for(unsigned short start : starts)
+        writeBlock(file, *core.blocks[start - ROM_MEM_START]);
+
+    fprintf(file, "static const AotBlock blocks[] {\n");
+    for(unsigned short start : starts) {
+        const BlockCore::Block& block = *core.blocks[start - ROM_MEM_START];
+        char loop[16] { "nullptr" };
+        if(hasLoop(block))
+            snprintf(loop, sizeof(loop), "loop%04X", start);
+
+        fprintf(file, "    { 0x%04X, %zu, opcodes%04X, block%04X, %s },\n", start, block.body.size(), start, start, loop);
+    }
+    fprintf(file, "};\n\n");
+
+    fprintf(file, "static const AotModule module { AOT_ABI_VERSION, sizeof(Chip8), 0x%016llXULL, %zu, blocks };\n\n",
+            romHash, starts.size());
+    fprintf(file, "extern \"C\" __attribute__((visibility(\"default\"))) const AotModule* %s() {\n", AOT_ENTRY_POINT);
+    fprintf(file, "    return &module;\n}\n");
+
+    return;
+}
+
+size_t AotCompiler::getInstructionCount() const {
+    size_t count {};
+    for(unsigned short start : starts)
+        count += core.blocks[start - ROM_MEM_START]->body.size();
+
+    return count;
+}
+
+static char parseOptions(int argc, char* argv[], AotOptions& options) {
+    for(int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+
+        if(strncmp(arg, "--out=", 6) == 0)
+            options.outputDir = arg + 6;
+        else if(strncmp(arg, "--cxx=", 6) == 0)
+            options.compiler = arg + 6;
+        else if(strcmp(arg, "--source-only") == 0)
+            options.sourceOnly = true;
+        else if(strncmp(arg, "--", 2) == 0)
+            return -1;
+        else
+            options.roms.push_back(arg);
+    }
+
+    return options.roms.empty() ? -1 : 0;
+}
+
+// Built with the same log level and profiler setting as this binary, so Chip8's layout matches
+static std::string getCompileCommand(const AotOptions& options, const std::string& source, const std::string& module) {
+    std::string command = options.compiler + " -std=c++17 -O2 -shared -fPIC -fvisibility=hidden";
+    command += " -I\"" CHIP8_INCLUDE_DIR "\"";
+    command += " -DCHIP8_LOG_LEVEL=" + std::to_string(CHIP8_LOG_LEVEL);
+#ifdef CHIP8_PROFILE
+    command += " -DCHIP8_PROFILE";
+#endif
+    command += " -o \"" + module + "\" \"" + source + "\"";
+
+    return command;
+}
+
+static char compileRom(const AotOptions& options, const std::string& rom) {
+    std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+    MappedRomManager romManager;
+
+    if(romManager.loadRom(rom, *chip8)) {
+        fprintf(stderr, "Could not load ROM %s\n", rom.c_str());
+        return -1;
+    }
+
+    const unsigned long long romHash = RomCache::acquire(rom)->getHash();
+    AotCompiler compiler(*chip8);
+    compiler.discover();
+
+    const std::string module = options.outputDir + "/" + AotLibrary::getModuleName(romHash);
+    const std::string source = module.substr(0, module.size() - 3) + ".cpp";
+
+    FILE* file = fopen(source.c_str(), "w");
+    if(file == nullptr) {
+        fprintf(stderr, "Could not write %s\n", source.c_str());
+        return -1;
+    }
+    compiler.writeSource(file, std::filesystem::path(rom).filename().string(), romHash);
+    if(fclose(file) != 0)
+        return -1;
+
+    if(!options.sourceOnly && system(getCompileCommand(options, source, module).c_str()) != 0) {
+        fprintf(stderr, "Could not compile %s\n", source.c_str());
+        return -1;
+    }
+
+    printf("%016llX %6zu blocks %7zu instructions %s\n", romHash, compiler.getBlockCount(),
+           compiler.getInstructionCount(), rom.c_str());
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    AotOptions options {};
+
+    if(parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s [--out=DIR] [--cxx=COMPILER] [--source-only] <ROM>...\n", argv[0]);
+        return -1;
+    }
+
+    std::error_code error {};
+    std::filesystem::create_directories(options.outputDir, error);
+
+    int failures {};
+    for(const std::string& rom : options.roms)
+        failures += compileRom(options, rom) != 0;
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "aot.h"
+#include "block_engine.h"
+#include "chip8.h"
+#include "cpu_core.h"
+#include "options.h"
+#include "rom.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+#include "wide_engine.h"
+
+#define BATCH_DEFAULT_CYCLES    1000000
+#define BATCH_NO_LIMIT          ~0ULL
+#define BATCH_WIDE_CHECK_FRAMES 256     // Frames between checks on whether a wide group still shares its work
+
+// The last --engine flag wins
+enum class BatchEngine : unsigned char {
+    Interpreter,
+    Block,
+    Wide
+};
+
+typedef struct {
+    unsigned long long cycleBudget { BATCH_NO_LIMIT };
+    unsigned long long frameBudget { BATCH_NO_LIMIT };
+    unsigned int cyclesPerFrame { DEFAULT_CYCLES_PER_FRAME };
+    unsigned int threadCount { std::thread::hardware_concurrency() };
+    unsigned int repeat { 1 };
+    unsigned long long seed { DEFAULT_RANDOM_SEED };
+    BatchEngine engine { BatchEngine::Interpreter };
+    bool overrideQuirks {};
+    QuirkProfile quirkProfile {};
+    const char* profilePath {};
+    std::unique_ptr<AotLibrary> aotLibrary {};
+    std::vector<std::string> roms {};
+}BatchOptions;
+
+typedef struct {
+    std::string rom;
+    unsigned int copy;
+    char error;
+    unsigned long long cycles;
+    unsigned long long frames;
+    unsigned long long stateHash;
+}BatchResult;
+
+static void addRoms(const std::string& path, std::vector<std::string>& roms) {
+    if(!std::filesystem::is_directory(path)) {
+        roms.push_back(path);
+        return;
+    }
+
+    std::vector<std::string> found {};
+    for(const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+        if(entry.is_regular_file() && entry.path().extension() == ".ch8")
+            found.push_back(entry.path().string());
+    }
+
+    // Directory order is unspecified, keep reports diffable between runs
+    std::sort(found.begin(), found.end());
+    roms.insert(roms.end(), found.begin(), found.end());
+
+    return;
+}
+
+static char parseOptions(int argc, char* argv[], BatchOptions& options) {
+    for(int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+
+        if(strncmp(arg, "--cycles=", 9) == 0) {
+            if(parseNumber(arg + 9, options.cycleBudget))
+                return -1;
+        }
+        else if(strncmp(arg, "--frames=", 9) == 0) {
+            if(parseNumber(arg + 9, options.frameBudget))
+                return -1;
+        }
+        else if(strncmp(arg, "--cycles-per-frame=", 19) == 0) {
+            if(parseNumber(arg + 19, options.cyclesPerFrame) || options.cyclesPerFrame == 0)
+                return -1;
+        }
+        else if(strncmp(arg, "--threads=", 10) == 0) {
+            if(parseNumber(arg + 10, options.threadCount))
+                return -1;
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0) {
+            if(parseNumber(arg + 7, options.seed, 0))
+                return -1;
+        }
+        else if(strncmp(arg, "--repeat=", 9) == 0) {
+            if(parseNumber(arg + 9, options.repeat))
+                return -1;
+        }
+        else if(strcmp(arg, "--engine=interp") == 0)
+            options.engine = BatchEngine::Interpreter;
+        else if(strcmp(arg, "--engine=block") == 0)
+            options.engine = BatchEngine::Block;
+        else if(strcmp(arg, "--engine=wide") == 0)
+            options.engine = BatchEngine::Wide;
+        else if(strncmp(arg, "--quirks=", 9) == 0) {
+            if(parseQuirkProfile(arg + 9, options.quirkProfile))
+                return -1;
+            options.overrideQuirks = true;
+        }
+        else if(strncmp(arg, "--profile=", 10) == 0)
+            options.profilePath = arg + 10;
+        else if(strncmp(arg, "--aot=", 6) == 0)
+            options.aotLibrary = std::make_unique<AotLibrary>(arg + 6);
+        else if(strncmp(arg, "--", 2) == 0)
+            return -1;
+        else
+            addRoms(arg, options.roms);
+    }
+
+    if(options.cycleBudget == BATCH_NO_LIMIT && options.frameBudget == BATCH_NO_LIMIT)
+        options.cycleBudget = BATCH_DEFAULT_CYCLES;
+
+    // AOT modules are block engine bodies, wide lanes would never run them
+    if(options.aotLibrary != nullptr && options.engine == BatchEngine::Wide) {
+        fprintf(stderr, "--aot can't be combined with --engine=wide\n");
+        return -1;
+    }
+
+    return options.roms.empty() ? -1 : 0;
+}
+
+// Every instance owns its machine and core, nothing is shared between tasks
+// Same frame structure as the frontend, just never waiting on the clock
+// A cycle budget that ends mid frame runs the partial slice without a timer tick
+// Carries on from result's cycles and frames, so a wide group can hand its lanes over partway
+static void runFrames(const BatchOptions& options, Chip8& chip8, CpuCore& cpuCore, BatchResult& result) {
+    FrameScheduler scheduler(options.cyclesPerFrame, true);
+
+    while(result.cycles < options.cycleBudget && result.frames < options.frameBudget) {
+        if(options.cycleBudget - result.cycles < options.cyclesPerFrame) {
+            result.cycles += cpuCore.run(chip8, static_cast<unsigned int>(options.cycleBudget - result.cycles));
+            break;
+        }
+
+        result.cycles += scheduler.runFrame(chip8, cpuCore);
+        result.frames++;
+    }
+
+    result.stateHash = chip8.getStateHash();
+
+    return;
+}
+
+static void runInstance(const BatchOptions& options, BatchResult& result) {
+    std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+    std::unique_ptr<CpuCore> cpuCore {};
+    MappedRomManager romManager;
+
+    if(options.engine == BatchEngine::Block || options.aotLibrary != nullptr)
+        cpuCore = std::make_unique<BlockCore>();
+    else
+        cpuCore = std::make_unique<InterpreterCore>();
+
+    result.error = romManager.loadRom(result.rom, *chip8);
+    if(result.error)
+        return;
+
+    // ROMs without a module stay on the plain block engine
+    if(options.aotLibrary != nullptr)
+        static_cast<BlockCore*>(cpuCore.get())->setNativeModule(options.aotLibrary->find(RomCache::acquire(result.rom)->getHash()));
+
+    if(options.overrideQuirks)
+        chip8->setQuirkProfile(options.quirkProfile);
+
+    // Each --repeat copy gets its own seed, so repeats sweep seeds instead of redoing the same run
+    chip8->seedRandom(options.seed + result.copy);
+
+    runFrames(options, *chip8, *cpuCore, result);
+
+    return;
+}
+
+// Copies of one ROM run as lanes of a single WideEngine, same frame structure as runInstance
+static void runWideGroup(const BatchOptions& options, BatchResult* results, unsigned int count) {
+    std::vector<std::unique_ptr<Chip8>> machines {};
+    std::vector<Chip8*> lanes {};
+    MappedRomManager romManager;
+    unsigned long long cycles {};
+    unsigned long long frames {};
+
+    for(unsigned int index = 0; index < count; index++) {
+        machines.push_back(std::make_unique<Chip8>());
+
+        // The lanes only run together, one copy that can't load fails the whole group
+        if(romManager.loadRom(results[index].rom, *machines.back())) {
+            for(unsigned int failed = 0; failed < count; failed++)
+                results[failed].error = -1;
+            return;
+        }
+
+        if(options.overrideQuirks)
+            machines.back()->setQuirkProfile(options.quirkProfile);
+
+        // Same seed runInstance gives the copy, so engines stay comparable
+        machines.back()->seedRandom(options.seed + results[index].copy);
+        lanes.push_back(machines.back().get());
+    }
+
+    WideEngine engine(lanes.data(), count);
+    unsigned long long checkedVector {};
+    unsigned long long checkedScalar {};
+    while(cycles < options.cycleBudget && frames < options.frameBudget) {
+        if(options.cycleBudget - cycles < options.cyclesPerFrame) {
+            cycles += engine.run(static_cast<unsigned int>(options.cycleBudget - cycles));
+            break;
+        }
+
+        cycles += engine.run(options.cyclesPerFrame);
+        engine.tickTimers();
+        frames++;
+
+        // Lanes that run most of their instructions on their own machines anyway (split up, or
+        // WideEngine gave up on them) are faster one after another than taking turns every frame
+        // Skipped idle cycles cost nothing either way and don't count
+        if(frames % BATCH_WIDE_CHECK_FRAMES == 0) {
+            const unsigned long long scalar = engine.getScalarSteps() - engine.getIdleSteps();
+            if(engine.getVectorSteps() - checkedVector < scalar - checkedScalar)
+                break;
+
+            checkedVector = engine.getVectorSteps();
+            checkedScalar = scalar;
+        }
+    }
+
+    // Whatever is left of the budgets runs copy by copy, nothing if the lockstep got through all of it
+    for(unsigned int index = 0; index < count; index++) {
+        InterpreterCore interpreter {};
+
+        results[index].cycles = cycles;
+        results[index].frames = frames;
+        runFrames(options, *machines[index], interpreter, results[index]);
+    }
+
+    return;
+}
+
+int main(int argc, char* argv[]) {
+    BatchOptions options {};
+
+    if(parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s [--cycles=N] [--frames=N] [--cycles-per-frame=N] [--threads=N] [--repeat=N] [--seed=N] [--quirks=default|chip8|schip|xochip] [--engine=interp|block|wide] [--aot=DIR] [--profile=FILE] <ROM or directory>...\n", argv[0]);
+        return -1;
+    }
+
+    if(options.profilePath != nullptr)
+        profiler::install(options.profilePath);
+
+    std::vector<BatchResult> results {};
+    for(const auto &rom : options.roms) {
+        for(unsigned int copy = 0; copy < options.repeat; copy++)
+            results.push_back({rom, copy, 0, 0, 0, 0});
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(options.threadCount);
+
+        if(options.engine == BatchEngine::Wide) {
+            // Copies of a ROM sit next to each other in results, hand them out in groups of up to 32
+            size_t first {};
+            while(first < results.size()) {
+                unsigned int count = 1;
+                while(count < WIDE_MAX_LANES && first + count < results.size() && results[first + count].rom == results[first].rom)
+                    count++;
+
+                BatchResult* group = &results[first];
+                pool.submit([&options, group, count] { runWideGroup(options, group, count); });
+                first += count;
+            }
+        }
+        else {
+            for(auto &result : results)
+                pool.submit([&options, &result] { runInstance(options, result); });
+        }
+
+        pool.wait();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned long long totalCycles {};
+    int failures {};
+    for(const auto &result : results) {
+        if(result.error) {
+            printf("%-16s %12s %8s %s\n", "LOAD-FAILED", "-", "-", result.rom.c_str());
+            failures++;
+            continue;
+        }
+
+        printf("%016llX %12llu %8llu %s\n", result.stateHash, result.cycles, result.frames, result.rom.c_str());
+        totalCycles += result.cycles;
+    }
+
+    fprintf(stderr, "%zu instances, %llu instructions in %.3f s (%.2f MIPS)\n",
+            results.size(), totalCycles, seconds, totalCycles / seconds / 1e6);
+
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,877 @@
+#include <algorithm>
+#include "block_engine.h"
+
+#ifdef CHIP8_PROFILE
+#define PREDICATE_SKIPS     false
+#else
+#define PREDICATE_SKIPS     true
+#endif
+
+// Threaded dispatch needs GNU labels as values, other compilers run the same code through a switch
+// CHIP8_SWITCH_DISPATCH forces the switch, so GCC and Clang builds can test it
+#if defined(__GNUC__) && !defined(CHIP8_SWITCH_DISPATCH)
+#define BLOCK_COMPUTED_GOTO
+#endif
+
+// Jumps, calls, returns, skips and memory stores all end a block
+// Stores end it too so a block can never keep running over code it just rewrote
+bool BlockCore::endsBlock(unsigned short opcode) {
+    switch(opcode >> 12) {
+        case 0x0:
+            return opcode != OP_CLEAR_SCREEN_MASK;     // 00EE and 0NNN
+        case 0x1:
+        case 0x2:
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x9:
+        case 0xB:
+        case 0xE:
+            return true;
+        case 0xF:
+            return writesMemory(opcode) || waitsForKey(opcode) || opcode == OP_LOAD_I_LONG_MASK;
+        default:
+            return false;
+    }
+}
+
+bool BlockCore::writesMemory(unsigned short opcode) {
+    // 5XY2 only stores under XO-CHIP, elsewhere counting it just ends a block a little early
+    return (opcode & 0xF0FF) == OP_BCD_VX_MASK || (opcode & 0xF0FF) == OP_STORE_REGISTER_VALUES_MASK ||
+           (opcode & 0xF00F) == OP_STORE_RANGE_MASK;
+}
+
+bool BlockCore::waitsForKey(unsigned short opcode) {
+    return (opcode & 0xF0FF) == OP_LOAD_VX_KEY_MASK;
+}
+
+BlockCore::ExitKind BlockCore::classifyExit(unsigned short opcode, unsigned short exitAddr) {
+    // Near the top of memory addProgramCounter can refuse a skip, leave that to the handler
+    bool skipFits = exitAddr + 4 < CHIP_8_MEM_SIZE - 1;
+
+    switch(opcode & 0xF000) {
+        case OP_JUMP_ADDR_MASK:
+            return ExitKind::Jump;
+        case OP_CALL_SUB_MASK:
+            return ExitKind::Call;
+        case 0x0000:
+            return (opcode == OP_RETURN_FROM_SUB_MASK) ? ExitKind::Return : ExitKind::Handler;
+        case 0xE000:
+            if(!skipFits)
+                return ExitKind::Handler;
+            if((opcode & 0xF0FF) == OP_SE_KEY_MASK)
+                return ExitKind::SkipKeyPressed;
+            return ((opcode & 0xF0FF) == OP_SNE_KEY_MASK) ? ExitKind::SkipKeyReleased : ExitKind::Handler;
+        case OP_SE_VX_MASK:
+            return skipFits ? ExitKind::SkipEqualImmediate : ExitKind::Handler;
+        case OP_SNE_VX_MASK:
+            return skipFits ? ExitKind::SkipNotEqualImmediate : ExitKind::Handler;
+        case OP_SE_VX_VY_MASK:
+            if(Opcodes::isRegisterRange(opcode))
+                return ExitKind::Handler;
+            return skipFits ? ExitKind::SkipEqualRegister : ExitKind::Handler;
+        case OP_SNE_VX_VY_MASK:
+            return skipFits ? ExitKind::SkipNotEqualRegister : ExitKind::Handler;
+        default:
+            return ExitKind::Handler;
+    }
+}
+
+BlockCore::BodyKind BlockCore::classifyBody(unsigned short opcode) {
+    switch(opcode & 0xF000) {
+        case OP_LOAD_VX_MASK:
+            return BodyKind::LoadImmediate;
+        case OP_ADD_VX_MASK:
+            return BodyKind::AddImmediate;
+        case OP_LOAD_I_MASK:
+            return BodyKind::LoadIndex;
+        case OP_LOAD_VX_VY_MASK:
+            switch(opcode & 0xF00F) {
+                case OP_LOAD_VX_VY_MASK:            return BodyKind::Copy;
+                case OP_LOAD_OR_VX_VY_MASK:         return BodyKind::Or;
+                case OP_LOAD_AND_VX_VY_MASK:        return BodyKind::And;
+                case OP_LOAD_XOR_VX_VY_MASK:        return BodyKind::Xor;
+                case OP_LOAD_ADD_VX_VY_MASK:        return BodyKind::Add;
+                case OP_LOAD_SUB_VX_VY_MASK:        return BodyKind::Subtract;
+                case OP_LOAD_SHIFT_RIGHT_VX_MASK:   return BodyKind::ShiftRight;
+                case OP_LOAD_SUB_VY_VX_MASK:        return BodyKind::SubtractReverse;
+                case OP_LOAD_SHIFT_LEFT_VX_MASK:    return BodyKind::ShiftLeft;
+                default:                            return BodyKind::Handler;
+            }
+        case OP_SE_VX_MASK:
+            return BodyKind::SkipEqualImmediate;
+        case OP_SNE_VX_MASK:
+            return BodyKind::SkipNotEqualImmediate;
+        case OP_SE_VX_VY_MASK:
+            return Opcodes::isRegisterRange(opcode) ? BodyKind::Handler : BodyKind::SkipEqualRegister;
+        case OP_SNE_VX_VY_MASK:
+            return BodyKind::SkipNotEqualRegister;
+        case 0xE000:
+            return ((opcode & 0xF0FF) == OP_SE_KEY_MASK) ? BodyKind::SkipKeyPressed : BodyKind::SkipKeyReleased;
+        case 0xF000:
+            switch(opcode & 0xF0FF) {
+                case OP_LOAD_VX_DELAY_MASK:         return BodyKind::LoadDelay;
+                case OP_LOAD_DELAY_TO_VX_MASK:      return BodyKind::SetDelay;
+                case OP_LOAD_SOUND_TO_VX_MASK:      return BodyKind::SetSound;
+                case OP_LOAD_I_VX_MASK:             return BodyKind::AddIndex;
+                case OP_LOAD_I_SPRITE_ADDR_MASK:    return BodyKind::FontIndex;
+                default:                            return BodyKind::Handler;
+            }
+        default:
+            return BodyKind::Handler;
+    }
+}
+
+BlockCore::BodyKind BlockCore::classifyLeave(ExitKind kind) {
+    switch(kind) {
+        case ExitKind::Jump:
+            return BodyKind::LeaveJump;
+        case ExitKind::Call:
+            return BodyKind::LeaveCall;
+        case ExitKind::Return:
+            return BodyKind::LeaveReturn;
+        default:
+            return BodyKind::LeaveHandler;
+    }
+}
+
+bool BlockCore::isLeave(BodyKind kind) {
+    return kind >= BodyKind::LeaveJump && kind <= BodyKind::LeaveHandler;
+}
+
+bool BlockCore::isSkip(ExitKind kind) {
+    return kind >= ExitKind::SkipEqualImmediate && kind <= ExitKind::SkipKeyReleased;
+}
+
+bool BlockCore::isSkip(BodyKind kind) {
+    return kind >= BodyKind::SkipEqualImmediate && kind <= BodyKind::SkipKeyReleased;
+}
+
+// Key and register polls, loops that only test things and jump back to the block's start
+// Skips don't write anything and folded jumps aren't in the body, so if every other body
+// instruction up to the jump was skipped the next pass sees the same state and does the same
+void BlockCore::findPolling(Block& block) {
+    unsigned short others {};
+
+    for(size_t index = 0; index < block.body.size(); index++) {
+        BodyStep& step = block.steps[index];
+
+        if(step.kind == BodyKind::LeaveJump && block.body[index].nnn == block.start)
+            step.pollSkips = others;
+        if(!isSkip(step.kind))
+            others++;
+    }
+
+    const bool loops = block.exitKind == ExitKind::Jump && block.exit.nnn == block.start;
+    block.pollSkips = loops ? others : BLOCK_NOT_POLLING;
+
+    return;
+}
+
+// Same conditions the skip handlers test
+bool BlockCore::testSkip(const Chip8& chip8, ExitKind kind, const Opcodes::Instruction& instruction) {
+    switch(kind) {
+        case ExitKind::SkipEqualImmediate:
+            return chip8.v[instruction.x] == instruction.nn;
+        case ExitKind::SkipNotEqualImmediate:
+            return chip8.v[instruction.x] != instruction.nn;
+        case ExitKind::SkipEqualRegister:
+            return chip8.v[instruction.x] == chip8.v[instruction.y];
+        case ExitKind::SkipNotEqualRegister:
+            return chip8.v[instruction.x] != chip8.v[instruction.y];
+        case ExitKind::SkipKeyPressed:
+            return chip8.getKeyMask() & (1 << (chip8.v[instruction.x] & 0xF));
+        case ExitKind::SkipKeyReleased:
+            return !(chip8.getKeyMask() & (1 << (chip8.v[instruction.x] & 0xF)));
+        default:
+            return false;
+    }
+}
+
+// Slots in runBody's label table. Quirked instructions get a slot per variant so the
+// block's profile is settled when it's threaded instead of tested every time they run
+enum ThreadedLabel : unsigned char {
+    LabelLoadImmediate,
+    LabelAddImmediate,
+    LabelLoadIndex,
+    LabelCopy,
+    LabelOr,
+    LabelOrResetVF,
+    LabelAnd,
+    LabelAndResetVF,
+    LabelXor,
+    LabelXorResetVF,
+    LabelAdd,
+    LabelSubtract,
+    LabelShiftRight,
+    LabelShiftRightVy,
+    LabelSubtractReverse,
+    LabelShiftLeft,
+    LabelShiftLeftVy,
+    LabelLoadDelay,
+    LabelSetDelay,
+    LabelSetSound,
+    LabelAddIndex,
+    LabelFontIndex,
+    LabelSkipEqualImmediate,
+    LabelSkipNotEqualImmediate,
+    LabelSkipEqualRegister,
+    LabelSkipNotEqualRegister,
+    LabelSkipKeyPressed,
+    LabelSkipKeyReleased,
+    LabelLeave,
+    LabelHandler,
+    LabelEnd,
+    LABEL_COUNT
+};
+
+// Resolves every body instruction to the code that runs it, plus the step that ends the body
+// labels is null without computed goto, runBody then switches on the slot alone
+void BlockCore::threadBody(Block& block, const void* const* labels) {
+    block.threaded.reserve(block.body.size() + 1);
+
+    for(size_t index = 0; index < block.body.size(); index++) {
+        const Opcodes::Instruction& instruction = block.body[index];
+        const BodyKind kind = block.steps[index].kind;
+        ThreadedLabel label {};
+
+        switch(kind) {
+            case BodyKind::LoadImmediate:           label = LabelLoadImmediate; break;
+            case BodyKind::AddImmediate:            label = LabelAddImmediate; break;
+            case BodyKind::LoadIndex:               label = LabelLoadIndex; break;
+            case BodyKind::Copy:                    label = LabelCopy; break;
+            case BodyKind::Or:                      label = block.quirks.logicResetsVF ? LabelOrResetVF : LabelOr; break;
+            case BodyKind::And:                     label = block.quirks.logicResetsVF ? LabelAndResetVF : LabelAnd; break;
+            case BodyKind::Xor:                     label = block.quirks.logicResetsVF ? LabelXorResetVF : LabelXor; break;
+            case BodyKind::Add:                     label = LabelAdd; break;
+            case BodyKind::Subtract:                label = LabelSubtract; break;
+            case BodyKind::ShiftRight:              label = block.quirks.shiftUsesVy ? LabelShiftRightVy : LabelShiftRight; break;
+            case BodyKind::SubtractReverse:         label = LabelSubtractReverse; break;
+            case BodyKind::ShiftLeft:               label = block.quirks.shiftUsesVy ? LabelShiftLeftVy : LabelShiftLeft; break;
+            case BodyKind::LoadDelay:               label = LabelLoadDelay; break;
+            case BodyKind::SetDelay:                label = LabelSetDelay; break;
+            case BodyKind::SetSound:                label = LabelSetSound; break;
+            case BodyKind::AddIndex:                label = LabelAddIndex; break;
+            case BodyKind::FontIndex:               label = LabelFontIndex; break;
+            case BodyKind::SkipEqualImmediate:      label = LabelSkipEqualImmediate; break;
+            case BodyKind::SkipNotEqualImmediate:   label = LabelSkipNotEqualImmediate; break;
+            case BodyKind::SkipEqualRegister:       label = LabelSkipEqualRegister; break;
+            case BodyKind::SkipNotEqualRegister:    label = LabelSkipNotEqualRegister; break;
+            case BodyKind::SkipKeyPressed:          label = LabelSkipKeyPressed; break;
+            case BodyKind::SkipKeyReleased:         label = LabelSkipKeyReleased; break;
+            case BodyKind::Handler:                 label = LabelHandler; break;
+            default:                                label = LabelLeave; break;
+        }
+
+        block.threaded.push_back({(labels != nullptr) ? labels[label] : nullptr, label, instruction.x, instruction.y,
+                                  (kind == BodyKind::LoadIndex) ? instruction.nnn : static_cast<unsigned short>(instruction.nn),
+                                  static_cast<unsigned short>(index)});
+    }
+
+    block.threaded.push_back({(labels != nullptr) ? labels[LabelEnd] : nullptr, LabelEnd, 0, 0, 0,
+                              static_cast<unsigned short>(block.body.size())});
+
+    return;
+}
+
+// Same effects as the handlers, in the same order, without their bounds checks or a call each
+// Every instruction's code ends by jumping to the next one's, the last step returns
+// x and y are nibbles, so every register index is in range
+// Counts the instructions taken skips stepped over, returns where control flow left the block or the body's length
+size_t BlockCore::runBody(Chip8& chip8, Block& block, unsigned int& skipped) {
+#ifdef BLOCK_COMPUTED_GOTO
+    static const void* const labels[LABEL_COUNT] {
+        &&LoadImmediate, &&AddImmediate, &&LoadIndex, &&Copy,
+        &&Or, &&OrResetVF, &&And, &&AndResetVF, &&Xor, &&XorResetVF,
+        &&Add, &&Subtract, &&ShiftRight, &&ShiftRightVy, &&SubtractReverse, &&ShiftLeft, &&ShiftLeftVy,
+        &&LoadDelay, &&SetDelay, &&SetSound, &&AddIndex, &&FontIndex,
+        &&SkipEqualImmediate, &&SkipNotEqualImmediate, &&SkipEqualRegister, &&SkipNotEqualRegister,
+        &&SkipKeyPressed, &&SkipKeyReleased,
+        &&Leave, &&Handler, &&End
+    };
+#else
+    static const void* const* labels {};
+#endif
+
+    if(block.threaded.empty())
+        threadBody(block, labels);
+
+    unsigned char* v = chip8.v;
+    const ThreadedStep* step = block.threaded.data();
+
+    // compileBlock never ends a body on a skip, so stepping over the next one stays inside the body
+    // or lands on the final step
+#ifdef BLOCK_COMPUTED_GOTO
+#define OP(name)        name
+#define NEXT(count)     step += count; goto *step->label
+#else
+#define OP(name)        case Label##name
+#define NEXT(count)     step += count; continue
+#endif
+#define SKIP_IF(taken)  if(taken) { skipped++; NEXT(2); } NEXT(1)
+
+#ifdef BLOCK_COMPUTED_GOTO
+    goto *step->label;
+#else
+    for(;;) switch(step->slot) {
+#endif
+
+OP(LoadImmediate):
+    v[step->x] = static_cast<unsigned char>(step->operand);
+    NEXT(1);
+OP(AddImmediate):
+    v[step->x] = static_cast<unsigned char>(v[step->x] + step->operand);
+    NEXT(1);
+OP(LoadIndex):
+    chip8.I = step->operand;
+    NEXT(1);
+OP(Copy):
+    v[step->x] = v[step->y];
+    NEXT(1);
+OP(Or):
+    v[step->x] |= v[step->y];
+    NEXT(1);
+OP(OrResetVF):
+    v[step->x] |= v[step->y];
+    v[0xF] = 0;
+    NEXT(1);
+OP(And):
+    v[step->x] &= v[step->y];
+    NEXT(1);
+OP(AndResetVF):
+    v[step->x] &= v[step->y];
+    v[0xF] = 0;
+    NEXT(1);
+OP(Xor):
+    v[step->x] ^= v[step->y];
+    NEXT(1);
+OP(XorResetVF):
+    v[step->x] ^= v[step->y];
+    v[0xF] = 0;
+    NEXT(1);
+OP(Add): {
+    const int sum = v[step->x] + v[step->y];
+    v[step->x] = static_cast<unsigned char>(sum);
+    v[0xF] = sum > 255;
+    NEXT(1);
+}
+OP(Subtract): {
+    const unsigned char vx = v[step->x], vy = v[step->y];
+    v[step->x] = static_cast<unsigned char>(vx - vy);
+    v[0xF] = vy <= vx;
+    NEXT(1);
+}
+OP(ShiftRight): {
+    const unsigned char value = v[step->x];
+    v[step->x] = value >> 1;
+    v[0xF] = value & 0x1;
+    NEXT(1);
+}
+OP(ShiftRightVy): {
+    const unsigned char value = v[step->y];
+    v[step->x] = value >> 1;
+    v[0xF] = value & 0x1;
+    NEXT(1);
+}
+OP(SubtractReverse): {
+    const unsigned char vx = v[step->x], vy = v[step->y];
+    v[step->x] = static_cast<unsigned char>(vy - vx);
+    v[0xF] = vy >= vx;
+    NEXT(1);
+}
+OP(ShiftLeft): {
+    const unsigned char value = v[step->x];
+    v[step->x] = static_cast<unsigned char>(value << 1);
+    v[0xF] = value >> 7;
+    NEXT(1);
+}
+OP(ShiftLeftVy): {
+    const unsigned char value = v[step->y];
+    v[step->x] = static_cast<unsigned char>(value << 1);
+    v[0xF] = value >> 7;
+    NEXT(1);
+}
+OP(LoadDelay):
+    v[step->x] = static_cast<unsigned char>(chip8.delay_timer);
+    NEXT(1);
+OP(SetDelay):
+    chip8.delay_timer = v[step->x];
+    NEXT(1);
+OP(SetSound):
+    chip8.sound_timer = v[step->x];
+    NEXT(1);
+OP(AddIndex):
+    chip8.I = static_cast<unsigned short>(chip8.I + v[step->x]);
+    NEXT(1);
+OP(FontIndex):
+    chip8.I = FONT_START + (v[step->x] & 0xF) * FONT_CHAR_SIZE;
+    NEXT(1);
+OP(SkipEqualImmediate):
+    SKIP_IF(v[step->x] == step->operand);
+OP(SkipNotEqualImmediate):
+    SKIP_IF(v[step->x] != step->operand);
+OP(SkipEqualRegister):
+    SKIP_IF(v[step->x] == v[step->y]);
+OP(SkipNotEqualRegister):
+    SKIP_IF(v[step->x] != v[step->y]);
+OP(SkipKeyPressed):
+    SKIP_IF(chip8.getKeyMask() & (1 << (v[step->x] & 0xF)));
+OP(SkipKeyReleased):
+    SKIP_IF(!(chip8.getKeyMask() & (1 << (v[step->x] & 0xF))));
+// Counted before the control flow runs, same as an exit
+OP(Leave): {
+    const BodyStep& leave = block.steps[step->index];
+    chip8.cycleCount += leave.count - skipped;
+    runControl(chip8, leave.control, block.body[step->index], leave.addr);
+    return step->index;
+}
+OP(Handler): {
+    const Opcodes::Instruction& instruction = block.body[step->index];
+    instruction.handler(instruction, chip8);
+    NEXT(1);
+}
+OP(End):
+    return step->index;
+
+#ifndef BLOCK_COMPUTED_GOTO
+    }
+#endif
+
+#undef SKIP_IF
+#undef NEXT
+#undef OP
+}
+
+// Native bodies stop short of control flow, it runs here instead
+size_t BlockCore::runNative(Chip8& chip8, const Block& block, unsigned int& skipped) {
+    const size_t stop = block.native(chip8, block.body.data(), skipped);
+
+    return finishNative(chip8, block, stop, skipped);
+}
+
+size_t BlockCore::finishNative(Chip8& chip8, const Block& block, size_t stop, unsigned int skipped) {
+    if(stop != block.body.size()) {
+        const BodyStep& step = block.steps[stop];
+        chip8.cycleCount += step.count - skipped;
+        runControl(chip8, step.control, block.body[stop], step.addr);
+    }
+
+    return stop;
+}
+
+// Control flow instruction sitting at addr, PC ends up wherever its handler would leave it
+void BlockCore::runControl(Chip8& chip8, ExitKind kind, const Opcodes::Instruction& instruction, unsigned short addr) {
+    switch(kind) {
+        case ExitKind::Jump:
+            if(instruction.nnn <= addr)
+                chip8.probeLoop(instruction.nnn);
+            chip8.PC = instruction.nnn;
+            break;
+        case ExitKind::Call:
+            // A full stack drops the call, same as opCallSub
+            chip8.PC = addr + 2;
+            if(chip8.SP >= STACK_SIZE)
+                break;
+            chip8.stack[chip8.SP++] = addr + 2;
+            chip8.PC = instruction.nnn;
+            break;
+        case ExitKind::Return:
+            chip8.PC = addr + 2;
+            if(chip8.SP == 0 || chip8.SP > STACK_SIZE)
+                break;
+            chip8.setProgramCounter(chip8.stack[chip8.SP - 1]);
+            chip8.SP--;
+            break;
+        default:
+            chip8.PC = addr;
+            chip8.addProgramCounter(2);
+            instruction.handler(instruction, chip8);
+            break;
+    }
+
+    return;
+}
+
+// One instantiation per exit kind, so running the exit needs no dispatch
+// Counts what ran before the exit does anything, a loop probe sees the same cycle count as the interpreter
+template<BlockCore::ExitKind Exit>
+unsigned int BlockCore::runBlock(Chip8& chip8, Block& block, Block**& successor, unsigned int) {
+    unsigned int skipped {};
+    size_t stop = block.body.size();
+
+    if(!block.body.empty())
+        stop = (block.native != nullptr) ? runNative(chip8, block, skipped) : runBody(chip8, block, skipped);
+
+    return finishBlock<Exit>(chip8, block, stop, skipped, successor);
+}
+
+// Every pass that fits in budget with room for one more closes its loop inside the module,
+// the last one ends the same way runBlock's would
+template<BlockCore::ExitKind Exit>
+unsigned int BlockCore::runLoop(Chip8& chip8, Block& block, Block**& successor, unsigned int budget) {
+    const unsigned long long first = chip8.cycleCount;
+    unsigned int skipped {};
+    size_t stop = block.nativeLoop(chip8, block.body.data(), budget / block.length - 1, skipped);
+
+    if(stop >= AOT_LOOP_IDLE) {
+        stop -= AOT_LOOP_IDLE;
+        chip8.PC = block.start;
+        successor = (stop != block.body.size()) ? &block.steps[stop].successor : &block.successor[0];
+
+        return static_cast<unsigned int>(chip8.cycleCount - first);
+    }
+
+    const unsigned int looped = static_cast<unsigned int>(chip8.cycleCount - first);
+    finishNative(chip8, block, stop, skipped);
+
+    return looped + finishBlock<Exit>(chip8, block, stop, skipped, successor);
+}
+
+// What's left of the block once its body stopped at stop
+template<BlockCore::ExitKind Exit>
+unsigned int BlockCore::finishBlock(Chip8& chip8, Block& block, size_t stop, unsigned int skipped, Block**& successor) {
+    if(stop != block.body.size()) {
+        BodyStep& step = block.steps[stop];
+        successor = &step.successor;
+
+        // Same period the loop probe would find a couple of passes later
+        if(step.pollSkips == skipped)
+            chip8.idlePeriod = step.count - skipped;
+
+        return step.count - skipped;
+    }
+
+    const unsigned int ran = block.length - skipped;
+    chip8.cycleCount += ran;
+
+    if constexpr(Exit == ExitKind::Fallthrough) {
+        chip8.PC = block.exitAddr;
+        successor = &block.successor[0];
+    }
+    else if constexpr(Exit >= ExitKind::SkipEqualImmediate && Exit <= ExitKind::SkipKeyReleased) {
+        const bool taken = testSkip(chip8, Exit, block.exit);
+        chip8.PC = block.exitAddr + (taken ? 4 : 2);
+        successor = &block.successor[taken];
+    }
+    else {
+        runControl(chip8, Exit, block.exit, block.exitAddr);
+        successor = &block.successor[0];
+
+        // A lone jump to itself can't change anything, no need for the loop probe to find out
+        if constexpr(Exit == ExitKind::Jump) {
+            if(block.body.empty() && block.exit.nnn == block.exitAddr)
+                chip8.idlePeriod = 1;
+            else if(block.pollSkips == skipped)
+                chip8.idlePeriod = ran;
+        }
+    }
+
+    return ran;
+}
+
+BlockCore::BlockRunner BlockCore::selectRunner(ExitKind exit, bool loops) {
+#define RUNNER(kind) (loops ? &runLoop<ExitKind::kind> : &runBlock<ExitKind::kind>)
+    switch(exit) {
+        case ExitKind::Jump:
+            return RUNNER(Jump);
+        case ExitKind::Call:
+            return RUNNER(Call);
+        case ExitKind::Return:
+            return RUNNER(Return);
+        case ExitKind::SkipEqualImmediate:
+            return RUNNER(SkipEqualImmediate);
+        case ExitKind::SkipNotEqualImmediate:
+            return RUNNER(SkipNotEqualImmediate);
+        case ExitKind::SkipEqualRegister:
+            return RUNNER(SkipEqualRegister);
+        case ExitKind::SkipNotEqualRegister:
+            return RUNNER(SkipNotEqualRegister);
+        case ExitKind::SkipKeyPressed:
+            return RUNNER(SkipKeyPressed);
+        case ExitKind::SkipKeyReleased:
+            return RUNNER(SkipKeyReleased);
+        case ExitKind::Handler:
+            return RUNNER(Handler);
+        default:
+            return RUNNER(Fallthrough);
+    }
+#undef RUNNER
+}
+
+BlockCore::Block* BlockCore::compileBlock(Chip8& chip8, unsigned short addr) {
+    std::unique_ptr<Block> block = std::make_unique<Block>();
+    unsigned int foldedJumps {};
+    block->start = addr;
+    block->exit = {};
+    block->exitKind = ExitKind::Fallthrough;
+    block->writesMemory = false;
+    block->quirks = getQuirks(chip8.quirkProfile);
+    block->ranges.push_back({addr, addr});
+
+    // Stops short of the top of memory, where addProgramCounter refuses to move PC
+    while(addr + 2 < CHIP_8_MEM_SIZE - 1 && block->length < BLOCK_MAX_INSTRUCTIONS) {
+        unsigned short opcode = GET_OPCODE(chip8.memory[addr], chip8.memory[addr + 1]);
+        unsigned short target = opcode & 0xFFF;
+        bool revisits = false;
+
+        for(const CodeRange& range : block->ranges)
+            revisits |= (target >= range.start && target <= range.end);
+
+        // Keep compiling at the target of a forward jump unless it loops back into this block
+        // Backward jumps stay exits so the loop probe sees every loop close
+        if((opcode & 0xF000) == OP_JUMP_ADDR_MASK && !revisits && target > addr) {
+            block->ranges.back().end = addr + 2;
+            block->ranges.push_back({target, target});
+            block->length++;
+            foldedJumps++;
+            addr = target;
+            continue;
+        }
+
+        // The skip and the instruction it guards go in together, the second can't start the next block
+        // The profiler counts every instruction in a block's ranges, so it keeps skips as plain exits
+        ExitKind kind = classifyExit(opcode, addr);
+        if(PREDICATE_SKIPS && isSkip(kind) && block->length + 2 <= BLOCK_MAX_INSTRUCTIONS && addr + 4 < CHIP_8_MEM_SIZE - 1) {
+            const unsigned short next = GET_OPCODE(chip8.memory[addr + 2], chip8.memory[addr + 3]);
+            const ExitKind nextKind = classifyExit(next, addr + 2);
+
+            // Two skips in a row are left to the exit, the first one decides whether the second runs at all
+            // A skip over F000 NNNN jumps four bytes under xoExtensions, also left to the exit
+            if(!isSkip(nextKind) && !(block->quirks.xoExtensions && next == OP_LOAD_I_LONG_MASK)) {
+                block->body.push_back(Opcodes::decodeInstruction(opcode, chip8.quirkProfile));
+                block->steps.push_back({classifyBody(opcode)});
+                block->length++;
+                addr += 2;
+
+                // A jump right behind a skip is a side exit, never folded
+                if(endsBlock(next) || (next & 0xF000) == OP_JUMP_ADDR_MASK) {
+                    block->body.push_back(Opcodes::decodeInstruction(next, chip8.quirkProfile));
+                    block->length++;
+                    block->steps.push_back({classifyLeave(nextKind), nextKind, addr, static_cast<unsigned short>(block->length)});
+                    block->writesMemory |= writesMemory(next);
+                    addr += 2;
+                }
+
+                block->ranges.back().end = addr;
+                continue;
+            }
+        }
+
+        if(endsBlock(opcode)) {
+            // The handler looks at what follows the skip when it runs, the word after the block isn't marked as code
+            if(block->quirks.xoExtensions && isSkip(kind))
+                kind = ExitKind::Handler;
+
+            block->exit = Opcodes::decodeInstruction(opcode, chip8.quirkProfile);
+            block->exitKind = kind;
+            block->length++;
+            block->ranges.back().end = addr + 2;
+            break;
+        }
+
+        block->body.push_back(Opcodes::decodeInstruction(opcode, chip8.quirkProfile));
+        block->steps.push_back({classifyBody(opcode)});
+        block->length++;
+        addr += 2;
+        block->ranges.back().end = addr;
+    }
+
+    // Without an exit instruction, exitAddr is simply where execution continues
+    block->exitAddr = addr;
+    block->writesMemory |= (block->exit.handler != nullptr) && writesMemory(block->exit.opcode);
+    block->successor[0] = nullptr;
+    block->successor[1] = nullptr;
+    const AotBlock* native = findNative(*block);
+    block->native = (native != nullptr) ? native->run : nullptr;
+    block->nativeLoop = (native != nullptr) ? native->loop : nullptr;
+#ifdef CHIP8_PROFILE
+    // profileBlock counts once per runner call, passes closed inside the module would go missing
+    block->nativeLoop = nullptr;
+#endif
+    block->runner = selectRunner(block->exitKind, block->nativeLoop != nullptr);
+    findPolling(*block);
+
+    // A block that is nothing but folded jumps gains nothing, let the interpreter take it
+    // Neither does a lone draw or key wait, the interpreter calls the same handler without the lookup
+    if(block->body.empty() && block->exit.handler == nullptr && foldedJumps != 0)
+        block->length = 0;
+    if(block->body.empty() && block->exitKind == ExitKind::Handler && foldedJumps == 0)
+        block->length = 0;
+
+    markCode(chip8, *block);
+    compiledStarts.push_back(block->start);
+    blocks[block->start - ROM_MEM_START] = std::move(block);
+
+    return blocks[compiledStarts.back() - ROM_MEM_START].get();
+}
+
+void BlockCore::markCode(Chip8& chip8, const Block& block) {
+    for(const CodeRange& range : block.ranges) {
+        for(unsigned short byte = range.start; byte < range.end; byte++)
+            chip8.codeBytes.set(byte);
+    }
+
+    return;
+}
+
+// Only a body compiled from exactly these opcodes can stand in for the handlers
+const AotBlock* BlockCore::findNative(const Block& block) const {
+    if(nativeModule == nullptr || block.body.empty())
+        return nullptr;
+
+    const AotBlock* first = nativeModule->blocks;
+    const AotBlock* last = nativeModule->blocks + nativeModule->blockCount;
+    const AotBlock* found = std::lower_bound(first, last, block.start, [](const AotBlock& entry, unsigned short start) {
+        return entry.start < start;
+    });
+
+    if(found == last || found->start != block.start || found->length != block.body.size())
+        return nullptr;
+
+    for(size_t index = 0; index < block.body.size(); index++) {
+        if(found->opcodes[index] != block.body[index].opcode)
+            return nullptr;
+    }
+
+    return found;
+}
+
+#ifdef CHIP8_PROFILE
+// Counts every instruction of the block at its own address, same as the interpreter would
+void BlockCore::profileBlock(const Chip8& chip8, const Block& block) {
+    for(const CodeRange& range : block.ranges) {
+        for(unsigned short addr = range.start; addr < range.end; addr += 2)
+            PROFILE_INSTRUCTION(addr, GET_OPCODE(chip8.memory[addr], chip8.memory[addr + 1]));
+    }
+
+    return;
+}
+#endif
+
+BlockCore::Block* BlockCore::findBlock(Chip8& chip8, unsigned short addr) {
+    if(addr < ROM_MEM_START || addr >= CHIP_8_MEM_SIZE - 1)
+        return nullptr;
+
+    Block* block = blocks[addr - ROM_MEM_START].get();
+    if(block == nullptr)
+        block = compileBlock(chip8, addr);
+
+    return (block->length != 0) ? block : nullptr;
+}
+
+// Throws away every block that overlaps a byte written since the last check
+void BlockCore::dropDirtyBlocks(Chip8& chip8) {
+    std::vector<unsigned short> survivors {};
+
+    chip8.codeBytes.reset();
+    for(unsigned short start : compiledStarts) {
+        std::unique_ptr<Block>& block = blocks[start - ROM_MEM_START];
+        bool dirty = false;
+
+        for(const CodeRange& range : block->ranges) {
+            for(unsigned short byte = range.start; byte < range.end && !dirty; byte++)
+                dirty = chip8.dirtyCode[byte];
+        }
+
+        if(dirty) {
+            block.reset();
+            continue;
+        }
+
+        markCode(chip8, *block);
+        survivors.push_back(start);
+    }
+
+    // Successor links may point at dropped blocks
+    for(unsigned short start : survivors) {
+        Block& block = *blocks[start - ROM_MEM_START];
+        block.successor[0] = nullptr;
+        block.successor[1] = nullptr;
+        for(BodyStep& step : block.steps)
+            step.successor = nullptr;
+    }
+
+    compiledStarts.swap(survivors);
+    chip8.dirtyCode.reset();
+    seenGeneration = chip8.codeGeneration;
+
+    return;
+}
+
+unsigned int BlockCore::run(Chip8& chip8, unsigned int cycleBudget) {
+    unsigned int executed {};
+
+    // Blocks would run straight past breakpoints, the debugger steps the machine itself
+    if(Debugger::isArmed())
+        return Debugger::getActive()->runSlice(chip8, cycleBudget);
+
+    // Memory may have been written from outside since the last run
+    if(chip8.codeGeneration != seenGeneration)
+        dropDirtyBlocks(chip8);
+
+    chip8.beginSlice();
+    Block* block = findBlock(chip8, chip8.PC);
+
+    while(executed < cycleBudget) {
+        // What's left of the slice is shorter than the next block, the interpreter finishes it
+        // Keeps the executed count exact so both engines stop on the same instruction, and looks
+        // up no blocks for addresses in the middle of one
+        if(block != nullptr && block->length > cycleBudget - executed) {
+            while(executed < cycleBudget) {
+                chip8.readNextInstruction();
+                executed++;
+
+                if(chip8.isIdle())
+                    executed += chip8.skipIdleCycles(cycleBudget - executed);
+            }
+            break;
+        }
+
+        // Reserved space goes through the interpreter
+        if(block == nullptr) {
+            chip8.readNextInstruction();
+            executed++;
+
+            if(chip8.isIdle())
+                executed += chip8.skipIdleCycles(cycleBudget - executed);
+
+            // The next slice starts with the same check, a key wait parked here needs no lookup
+            if(executed >= cycleBudget)
+                break;
+
+            if(chip8.codeGeneration != seenGeneration)
+                dropDirtyBlocks(chip8);
+
+            block = findBlock(chip8, chip8.PC);
+            continue;
+        }
+
+#ifdef CHIP8_PROFILE
+        profileBlock(chip8, *block);
+#endif
+        LOG_TRACE("Block: %04X    %u instructions", block->start, block->length);
+
+        Block** cached {};
+        executed += block->runner(chip8, *block, cached, cycleBudget - executed);
+
+        // Only jump, 00FD and FX0A exits can make the machine idle
+        if(chip8.isIdle())
+            executed += chip8.skipIdleCycles(cycleBudget - executed);
+
+        if(block->writesMemory && chip8.codeGeneration != seenGeneration) {
+            dropDirtyBlocks(chip8);
+            block = findBlock(chip8, chip8.PC);
+            continue;
+        }
+
+        // Most exits go back to the same place, skip the table when they do
+        Block* successor = *cached;
+        if(successor == nullptr || successor->start != chip8.PC) {
+            successor = findBlock(chip8, chip8.PC);
+            *cached = successor;
+        }
+        block = successor;
+    }
+
+    return executed;
+}
@@ -1,2 +1,75 @@
 #include <memory>
+#include <cstring>
 #include "chip8.h"
+
+Snapshot Chip8::takeSnapshot() {
+    Snapshot snapshot;
+
+    // Only pages written since the last sync need a fresh copy
+    for(unsigned char page = 0; page < SNAPSHOT_PAGE_COUNT; page++) {
+        if(basePages[page] != nullptr && !(dirtyPages & (1 << page)))
+            continue;
+
+        std::shared_ptr<MemoryPage> copy = std::make_shared<MemoryPage>();
+        memcpy(copy->data(), memory + page * SNAPSHOT_PAGE_SIZE, SNAPSHOT_PAGE_SIZE);
+        basePages[page] = std::move(copy);
+    }
+    dirtyPages = 0;
+
+    snapshot.pages = basePages;
+    memcpy(snapshot.v, v, sizeof(v));
+    memcpy(snapshot.stack, stack, sizeof(stack));
+    snapshot.PC = PC;
+    snapshot.SP = SP;
+    snapshot.I = I;
+    snapshot.delay_timer = delay_timer;
+    snapshot.sound_timer = sound_timer;
+    snapshot.keyMask = getKeyMask();
+    snapshot.randomState = randomState;
+    snapshot.cycleCount = cycleCount;
+    snapshot.pixels = pixels;
+    snapshot.hires = hires;
+    snapshot.planeMask = planeMask;
+    memcpy(snapshot.audioPattern, audioPattern, sizeof(audioPattern));
+    snapshot.audioPitch = audioPitch;
+    snapshot.keyWaiting = keyWaiting;
+    snapshot.keyWaitIgnored = keyWaitIgnored;
+    snapshot.keyWaitKey = keyWaitKey;
+
+    return snapshot;
+}
+
+void Chip8::restoreSnapshot(const Snapshot& snapshot) {
+    // A page can only differ if we wrote it or the snapshot holds another version of it
+    for(unsigned char page = 0; page < SNAPSHOT_PAGE_COUNT; page++) {
+        if(!(dirtyPages & (1 << page)) && basePages[page] == snapshot.pages[page])
+            continue;
+
+        memcpy(memory + page * SNAPSHOT_PAGE_SIZE, snapshot.pages[page]->data(), SNAPSHOT_PAGE_SIZE);
+        onMemoryWrite(page * SNAPSHOT_PAGE_SIZE, SNAPSHOT_PAGE_SIZE);
+    }
+    basePages = snapshot.pages;
+    dirtyPages = 0;
+
+    memcpy(v, snapshot.v, sizeof(v));
+    memcpy(stack, snapshot.stack, sizeof(stack));
+    PC = snapshot.PC;
+    SP = snapshot.SP;
+    I = snapshot.I;
+    delay_timer = snapshot.delay_timer;
+    sound_timer = snapshot.sound_timer;
+    setKeyMask(snapshot.keyMask);
+    randomState = snapshot.randomState;
+    cycleCount = snapshot.cycleCount;
+    pixels = snapshot.pixels;
+    hires = snapshot.hires;
+    planeMask = snapshot.planeMask;
+    memcpy(audioPattern, snapshot.audioPattern, sizeof(audioPattern));
+    audioPitch = snapshot.audioPitch;
+    keyWaiting = snapshot.keyWaiting;
+    keyWaitIgnored = snapshot.keyWaitIgnored;
+    keyWaitKey = snapshot.keyWaitKey;
+    displayDirty = true;
+
+    return;
+}
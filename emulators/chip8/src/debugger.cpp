@@ -0,0 +1,494 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "debugger.h"
+#include "logger.h"
+#include "opcode.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+Debugger::~Debugger() {
+#ifndef _WIN32
+    stopping = true;
+    if(listenSocket >= 0)
+        shutdown(listenSocket, SHUT_RDWR);
+
+    {
+        std::lock_guard<std::mutex> lock(sendMutex);
+        if(clientSocket >= 0)
+            shutdown(clientSocket, SHUT_RDWR);
+    }
+
+    if(server.joinable())
+        server.join();
+
+    if(listenSocket >= 0) {
+        close(listenSocket);
+        unlink(socketPath.c_str());
+    }
+#endif
+
+    if(active == this) {
+        armed = false;
+        active = nullptr;
+    }
+}
+
+char Debugger::listen(const char* path) {
+#ifndef _WIN32
+    sockaddr_un address {};
+    if(active != nullptr || strlen(path) >= sizeof(address.sun_path))
+        return -1;
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    // A socket file left behind by an earlier run would make bind fail
+    unlink(path);
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenSocket < 0)
+        return -1;
+
+    if(bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listenSocket, 1) != 0) {
+        close(listenSocket);
+        listenSocket = -1;
+        return -1;
+    }
+
+    socketPath = path;
+    active = this;
+    server = std::thread(&Debugger::serve, this);
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+// Parks the emulation thread while the instruction at PC shouldn't run yet, -1 if the stopped
+// callback gave up the stop and the slice should end here
+char Debugger::waitWhileStopped(Chip8& chip8, std::unique_lock<std::mutex>& lock) {
+    const std::string reason = findStopReason(chip8);
+    if(reason.empty())
+        return 0;
+
+    stoppedMachine = &chip8;
+    send("stopped " + reason + " " + describeRegisters(chip8));
+
+    while(!resumed.wait_for(lock, std::chrono::milliseconds(DEBUG_STOPPED_POLL_MS), [this] { return stoppedMachine == nullptr; })) {
+        if(stoppedCallback && !stoppedCallback()) {
+            resume(0);
+            return -1;
+        }
+    }
+
+    // Whatever stopped the machine, the instruction it stopped on runs without another check
+    return 0;
+}
+
+// Empty unless the instruction at PC shouldn't run yet
+std::string Debugger::findStopReason(const Chip8& chip8) {
+    char reason[DEBUG_MAX_LINE];
+
+    if(stepsRemaining != 0 && --stepsRemaining == 0)
+        return "step";
+
+    if(pauseRequested) {
+        pauseRequested = false;
+        return "pause";
+    }
+
+    const unsigned short pc = chip8.PC;
+    if(attributes[pc] & DEBUG_BREAK) {
+        auto condition = breakConditions.find(pc);
+        if(condition == breakConditions.end() || testCondition(chip8, condition->second)) {
+            snprintf(reason, sizeof(reason), "break 0x%03X", pc);
+            return reason;
+        }
+    }
+
+    // Only stores and reads through I can hit a watchpoint
+    const unsigned short opcode = GET_OPCODE(chip8.memory[pc], chip8.memory[(pc + 1) & (CHIP_8_MEM_SIZE - 1)]);
+    unsigned int reads {}, writes {};
+    findAccess(chip8, opcode, reads, writes);
+
+    for(unsigned int offset = 0; offset < std::max(reads, writes); offset++) {
+        const unsigned short address = (chip8.I + offset) & (CHIP_8_MEM_SIZE - 1);
+        const unsigned char watched = attributes[address] & ((reads ? DEBUG_WATCH_READ : 0) | (writes ? DEBUG_WATCH_WRITE : 0));
+
+        if(watched != 0) {
+            snprintf(reason, sizeof(reason), "%s 0x%03X", (watched & DEBUG_WATCH_WRITE) ? "write" : "read", address);
+            return reason;
+        }
+    }
+
+    for(const Condition& condition : conditions) {
+        if(testCondition(chip8, condition))
+            return "when " + condition.text;
+    }
+
+    return {};
+}
+
+// Bytes the instruction reads or stores starting at I, the same amounts the handlers use
+void Debugger::findAccess(const Chip8& chip8, unsigned short opcode, unsigned int& reads, unsigned int& writes) {
+    const unsigned int x = (opcode >> 8) & 0xF;
+    const unsigned int n = opcode & 0xF;
+
+    reads = 0;
+    writes = 0;
+
+    if((opcode & 0xF000) == OP_DRAW_SPRITE_MASK)
+        reads = (n == 0 ? 32 : n) * __builtin_popcount(chip8.planeMask);
+    else if(opcode == OP_LOAD_AUDIO_PATTERN_MASK)
+        reads = AUDIO_PATTERN_SIZE;
+    else if((opcode & 0xF0FF) == OP_LOAD_REGISTER_VALUES_MASK)
+        reads = x + 1;
+    else if((opcode & 0xF00F) == OP_LOAD_RANGE_MASK && getQuirks(chip8.quirkProfile).xoExtensions)
+        reads = Opcodes::rangeLength(opcode);
+    else
+        writes = Opcodes::storeLength(opcode, chip8.quirkProfile);
+
+    return;
+}
+
+std::string Debugger::describeRegisters(const Chip8& chip8) const {
+    char text[DEBUG_MAX_LINE];
+    int length = snprintf(text, sizeof(text), "PC=0x%03X I=0x%03X SP=%u DT=%u ST=%u",
+                          chip8.PC, chip8.I, chip8.SP, chip8.delay_timer, chip8.sound_timer);
+
+    for(unsigned char index = 0; index < REGISTER_COUNT; index++)
+        length += snprintf(text + length, sizeof(text) - length, " V%X=0x%02X", index, chip8.v[index]);
+    snprintf(text + length, sizeof(text) - length, " cycle=%llu", chip8.cycleCount);
+
+    return text;
+}
+
+// "V3==0x10", "I>=0x300", "DT!=0"
+char Debugger::parseCondition(const char* text, Condition& condition) {
+    static constexpr struct { const char* name; ConditionCompare compare; } compares[] {
+        {"==", ConditionCompare::Equal}, {"!=", ConditionCompare::NotEqual}, {"<=", ConditionCompare::LessEqual},
+        {">=", ConditionCompare::GreaterEqual}, {"<", ConditionCompare::Less}, {">", ConditionCompare::Greater}
+    };
+    const char* cursor = text;
+
+    if((cursor[0] == 'V' || cursor[0] == 'v') && isxdigit(cursor[1])) {
+        condition.target = ConditionTarget::Register;
+        condition.index = static_cast<unsigned char>(strtoul(std::string(cursor + 1, 1).c_str(), nullptr, 16));
+        cursor += 2;
+    }
+    else if(strncmp(cursor, "PC", 2) == 0) {
+        condition.target = ConditionTarget::ProgramCounter;
+        cursor += 2;
+    }
+    else if(strncmp(cursor, "SP", 2) == 0) {
+        condition.target = ConditionTarget::StackPointer;
+        cursor += 2;
+    }
+    else if(strncmp(cursor, "DT", 2) == 0) {
+        condition.target = ConditionTarget::DelayTimer;
+        cursor += 2;
+    }
+    else if(strncmp(cursor, "ST", 2) == 0) {
+        condition.target = ConditionTarget::SoundTimer;
+        cursor += 2;
+    }
+    else if(cursor[0] == 'I') {
+        condition.target = ConditionTarget::Index;
+        cursor += 1;
+    }
+    else
+        return -1;
+
+    const auto compare = std::find_if(std::begin(compares), std::end(compares),
+                                      [cursor](const auto& entry) { return strncmp(cursor, entry.name, strlen(entry.name)) == 0; });
+    if(compare == std::end(compares))
+        return -1;
+    cursor += strlen(compare->name);
+
+    char* end {};
+    condition.compare = compare->compare;
+    condition.value = strtoul(cursor, &end, 0);
+    if(end == cursor || *end != '\0')
+        return -1;
+
+    condition.text = text;
+
+    return 0;
+}
+
+bool Debugger::testCondition(const Chip8& chip8, const Condition& condition) {
+    unsigned int value {};
+
+    switch(condition.target) {
+        case ConditionTarget::Register:         value = chip8.v[condition.index]; break;
+        case ConditionTarget::Index:            value = chip8.I; break;
+        case ConditionTarget::ProgramCounter:   value = chip8.PC; break;
+        case ConditionTarget::StackPointer:     value = chip8.SP; break;
+        case ConditionTarget::DelayTimer:       value = chip8.delay_timer; break;
+        case ConditionTarget::SoundTimer:       value = chip8.sound_timer; break;
+    }
+
+    switch(condition.compare) {
+        case ConditionCompare::Equal:           return value == condition.value;
+        case ConditionCompare::NotEqual:        return value != condition.value;
+        case ConditionCompare::Less:            return value < condition.value;
+        case ConditionCompare::LessEqual:       return value <= condition.value;
+        case ConditionCompare::Greater:         return value > condition.value;
+        case ConditionCompare::GreaterEqual:    return value >= condition.value;
+    }
+
+    return false;
+}
+
+// Cores keep running their own loops unless something could stop the machine
+void Debugger::updateArmed() {
+    const bool anyAttribute = std::any_of(attributes.begin(), attributes.end(), [](unsigned char bits) { return bits != 0; });
+
+    armed = anyAttribute || !conditions.empty() || pauseRequested || stepsRemaining != 0;
+
+    return;
+}
+
+void Debugger::resume(unsigned long long steps) {
+    stepsRemaining = steps;
+    stoppedMachine = nullptr;
+    resumed.notify_one();
+
+    return;
+}
+
+// One command line, returns the reply. Runs on the server thread with mutex held, so the
+// emulation thread is either between slices or parked in runSlice
+std::string Debugger::execute(const char* line) {
+    char command[16] {}, first[64] {}, second[64] {}, third[64] {};
+    const int fields = sscanf(line, "%15s %63s %63s %63s", command, first, second, third);
+    char reply[DEBUG_MAX_LINE];
+
+    if(fields <= 0)
+        return "error empty command";
+
+    const unsigned int address = strtoul(first, nullptr, 0) & (CHIP_8_MEM_SIZE - 1);
+
+    if(strcmp(command, "break") == 0 && fields >= 2) {
+        Condition condition {};
+        if(fields >= 3 && parseCondition(second, condition))
+            return "error bad condition";
+
+        attributes[address] |= DEBUG_BREAK;
+        breakConditions.erase(address);
+        if(fields >= 3)
+            breakConditions[address] = condition;
+
+        snprintf(reply, sizeof(reply), "ok break 0x%03X", address);
+        return reply;
+    }
+
+    if(strcmp(command, "delete") == 0 && fields >= 2) {
+        attributes[address] &= ~DEBUG_BREAK;
+        breakConditions.erase(address);
+        return "ok";
+    }
+
+    if((strcmp(command, "watch") == 0 || strcmp(command, "unwatch") == 0) && fields >= 2) {
+        const bool adding = command[0] == 'w';
+        const char* kind = adding ? first : "rw";
+        const char* start = adding ? second : first;
+        const char* length = adding ? third : second;
+
+        if(adding && fields < 3)
+            return "error missing address";
+
+        unsigned char bits {};
+        if(strchr(kind, 'r') != nullptr)
+            bits |= DEBUG_WATCH_READ;
+        if(strchr(kind, 'w') != nullptr)
+            bits |= DEBUG_WATCH_WRITE;
+        if(bits == 0)
+            return "error watch kind is r, w or rw";
+
+        const unsigned int from = strtoul(start, nullptr, 0) & (CHIP_8_MEM_SIZE - 1);
+        const unsigned int count = std::clamp<unsigned long>(*length ? strtoul(length, nullptr, 0) : 1, 1, CHIP_8_MEM_SIZE);
+        for(unsigned int offset = 0; offset < count; offset++) {
+            if(adding)
+                attributes[(from + offset) & (CHIP_8_MEM_SIZE - 1)] |= bits;
+            else
+                attributes[(from + offset) & (CHIP_8_MEM_SIZE - 1)] &= ~bits;
+        }
+
+        return "ok";
+    }
+
+    if(strcmp(command, "when") == 0 && fields >= 2) {
+        Condition condition {};
+        if(parseCondition(first, condition))
+            return "error bad condition";
+
+        conditions.push_back(condition);
+        return "ok";
+    }
+
+    if(strcmp(command, "clear") == 0) {
+        conditions.clear();
+        return "ok";
+    }
+
+    if(strcmp(command, "pause") == 0) {
+        if(stoppedMachine != nullptr)
+            return "error already stopped";
+
+        pauseRequested = true;
+        return "ok";
+    }
+
+    if(strcmp(command, "continue") == 0 || strcmp(command, "step") == 0) {
+        if(stoppedMachine == nullptr)
+            return "error running";
+
+        resume(command[0] == 's' ? std::max(1UL, strtoul(first, nullptr, 0)) : 0);
+        return "ok";
+    }
+
+    if(strcmp(command, "regs") == 0) {
+        if(stoppedMachine == nullptr)
+            return "error running";
+
+        return "ok " + describeRegisters(*stoppedMachine);
+    }
+
+    if(strcmp(command, "mem") == 0 && fields >= 2) {
+        if(stoppedMachine == nullptr)
+            return "error running";
+
+        const unsigned int count = std::clamp<unsigned long>(fields >= 3 ? strtoul(second, nullptr, 0) : 16, 1, 64);
+        std::string text = "ok";
+        for(unsigned int offset = 0; offset < count; offset++) {
+            snprintf(reply, sizeof(reply), " %02X", stoppedMachine->memory[(address + offset) & (CHIP_8_MEM_SIZE - 1)]);
+            text += reply;
+        }
+
+        return text;
+    }
+
+    if(strcmp(command, "list") == 0) {
+        std::string text = "ok";
+        for(unsigned int addr = 0; addr < CHIP_8_MEM_SIZE; addr++) {
+            if(attributes[addr] == 0)
+                continue;
+
+            auto condition = breakConditions.find(addr);
+            snprintf(reply, sizeof(reply), " 0x%03X:%s%s%s%s%s", addr,
+                     (attributes[addr] & DEBUG_BREAK) ? "b" : "",
+                     (attributes[addr] & DEBUG_WATCH_READ) ? "r" : "",
+                     (attributes[addr] & DEBUG_WATCH_WRITE) ? "w" : "",
+                     (condition != breakConditions.end()) ? "," : "",
+                     (condition != breakConditions.end()) ? condition->second.text.c_str() : "");
+            text += reply;
+        }
+
+        for(const Condition& condition : conditions)
+            text += " when:" + condition.text;
+
+        return text;
+    }
+
+    if(strcmp(command, "detach") == 0) {
+        attributes.fill(0);
+        breakConditions.clear();
+        conditions.clear();
+        pauseRequested = false;
+        if(stoppedMachine != nullptr)
+            resume(0);
+
+        return "ok";
+    }
+
+    return "error unknown command";
+}
+
+void Debugger::send(const std::string& line) {
+#ifndef _WIN32
+    std::lock_guard<std::mutex> lock(sendMutex);
+    if(clientSocket < 0)
+        return;
+
+    const std::string text = line + "\n";
+    size_t sent {};
+    while(sent < text.size()) {
+        ssize_t written = ::send(clientSocket, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if(written <= 0)
+            break;
+        sent += written;
+    }
+#endif
+
+    return;
+}
+
+// Accepts a client, runs its commands, and lets the machine go again when it disconnects
+void Debugger::serve() {
+#ifndef _WIN32
+    while(!stopping) {
+        int client = accept(listenSocket, nullptr, nullptr);
+        if(client < 0)
+            break;
+
+        {
+            std::lock_guard<std::mutex> lock(sendMutex);
+            clientSocket = client;
+        }
+        LOG_INFO("Debugger attached on %s", socketPath.c_str());
+
+        std::string pending {};
+        char buffer[DEBUG_MAX_LINE];
+        ssize_t received {};
+
+        while((received = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+            pending.append(buffer, received);
+
+            size_t newline {};
+            while((newline = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, newline);
+                pending.erase(0, newline + 1);
+                if(!line.empty() && line.back() == '\r')
+                    line.pop_back();
+
+                std::string reply {};
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    reply = execute(line.c_str());
+                    updateArmed();
+                }
+                send(reply);
+            }
+
+            // Nobody sends commands this long, drop it rather than buffer forever
+            if(pending.size() > DEBUG_MAX_LINE)
+                pending.clear();
+        }
+
+        // A vanished client mustn't leave the machine stopped with nobody to resume it
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            execute("detach");
+            updateArmed();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sendMutex);
+            clientSocket = -1;
+        }
+        close(client);
+        LOG_INFO("Debugger detached");
+    }
+#endif
+
+    return;
+}
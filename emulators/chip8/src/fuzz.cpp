@@ -0,0 +1,409 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "block_engine.h"
+#include "chip8.h"
+#include "cpu_core.h"
+#include "hash.h"
+#include "options.h"
+#include "scheduler.h"
+#include "snapshot.h"
+
+#define FUZZ_COVERAGE_SIZE      4096    // One byte per PC/opcode edge bucket
+#define FUZZ_MAX_FRAMES         16
+#define FUZZ_MAX_CYCLES         32      // Per frame, short runs keep the exec rate up
+#define FUZZ_HEADER_SIZE        3       // Flags, frames, cycles per frame
+#define FUZZ_MAX_INPUT          (FUZZ_HEADER_SIZE + FUZZ_MAX_FRAMES * 2 + ROM_MEM_SIZE)
+
+#define FUZZ_FLAG_QUIRKS        0x03    // QuirkProfile to run with
+
+// Input layout: flags, frame count - 1, cycles per frame - 1 (both wrap), one little-endian key mask per
+// frame, then the ROM. Anything missing is zero, so every byte string is a valid input
+// "--compare" also runs every input on the block engine and aborts if it ends up anywhere
+// else. Compiling blocks costs far more than interpreting a few hundred instructions, so
+// it's a separate mode rather than an input bit
+
+// Edge counters, libFuzzer picks this section up as extra feedback and clears it between runs
+#ifdef CHIP8_LIBFUZZER
+__attribute__((section("__libfuzzer_extra_counters")))
+#endif
+static unsigned char coverage[FUZZ_COVERAGE_SIZE];
+
+// The interpreter loop with an edge counter bumped before every instruction
+// A location is the PC mixed with the opcode there, so rewritten code counts as new code
+class CoverageCore : public CpuCore {
+    public:
+        unsigned int run(Chip8& chip8, unsigned int cycleBudget) {
+            chip8.beginSlice();
+
+            for(unsigned int cycle = 0; cycle < cycleBudget; cycle++) {
+                const unsigned short pc = chip8.getProgramCounter();
+                const unsigned short opcode = GET_OPCODE(chip8.getMachineCode(pc),
+                                                         chip8.getMachineCode((pc + 1) & (CHIP_8_MEM_SIZE - 1)));
+                const unsigned int location = (pc ^ ((opcode * 40503U) >> 4)) & (FUZZ_COVERAGE_SIZE - 1);
+
+                coverage[location ^ previous]++;
+                previous = location >> 1;
+
+                chip8.readNextInstruction();
+
+                if(chip8.isIdle())
+                    cycle += chip8.skipIdleCycles(cycleBudget - cycle - 1);
+            }
+
+            return cycleBudget;
+        };
+
+        void reset() {
+            previous = 0;
+            return;
+        };
+
+    private:
+        unsigned int previous {};
+};
+
+// Machines are built once, every input starts from the same power on snapshot
+// Restoring only copies the pages the last input dirtied, nothing is allocated per run
+class FuzzTarget {
+    public:
+        FuzzTarget() {
+            powerOn = machine.takeSnapshot();
+            comparePowerOn = compareMachine.takeSnapshot();
+        };
+
+        void run(const unsigned char* data, size_t size) {
+            unsigned char header[FUZZ_HEADER_SIZE] {};
+            memcpy(header, data, std::min<size_t>(size, FUZZ_HEADER_SIZE));
+
+            const QuirkProfile profile = static_cast<QuirkProfile>(header[0] & FUZZ_FLAG_QUIRKS);
+            const unsigned int frames = header[1] % FUZZ_MAX_FRAMES + 1;
+            const unsigned int cyclesPerFrame = header[2] % FUZZ_MAX_CYCLES + 1;
+
+            unsigned short keys[FUZZ_MAX_FRAMES] {};
+            size_t offset = FUZZ_HEADER_SIZE;
+            for(unsigned int frame = 0; frame < frames && offset + 1 < size; frame++, offset += 2)
+                keys[frame] = data[offset] | (data[offset + 1] << 8);
+            offset = std::min<size_t>(size, FUZZ_HEADER_SIZE + frames * 2);
+
+            const size_t romSize = std::min<size_t>(size - offset, ROM_MEM_SIZE);
+
+            coverageCore.reset();
+            load(machine, powerOn, data + offset, romSize, profile);
+            if(compareEngines)
+                load(compareMachine, comparePowerOn, data + offset, romSize, profile);
+
+            FrameScheduler scheduler(cyclesPerFrame, true);
+            for(unsigned int frame = 0; frame < frames; frame++) {
+                machine.setKeyMask(keys[frame]);
+                scheduler.runFrame(machine, coverageCore);
+
+                if(compareEngines) {
+                    compareMachine.setKeyMask(keys[frame]);
+                    scheduler.runFrame(compareMachine, blockCore);
+                }
+            }
+
+            // Both engines promise identical results, a difference is as much a bug as a crash
+            if(compareEngines && machine.getStateHash() != compareMachine.getStateHash()) {
+                fprintf(stderr, "Block engine diverged from the interpreter\n");
+                abort();
+            }
+
+            return;
+        };
+
+        void setCompareEngines(bool compare) {
+            compareEngines = compare;
+            return;
+        };
+
+    private:
+        static void load(Chip8& chip8, const Snapshot& powerOn, const unsigned char* rom, size_t size, QuirkProfile profile) {
+            chip8.restoreSnapshot(powerOn);
+            if(size != 0)
+                chip8.writeMemory(rom, size, ROM_MEM_START);
+
+            // Switching profiles drops every cached decode, only pay for that when it changes
+            if(chip8.getQuirkProfile() != profile)
+                chip8.setQuirkProfile(profile);
+
+            return;
+        };
+
+        Chip8 machine {};
+        Chip8 compareMachine {};
+        Snapshot powerOn {};
+        Snapshot comparePowerOn {};
+        CoverageCore coverageCore {};
+        BlockCore blockCore {};
+        bool compareEngines {};
+};
+
+static FuzzTarget& getTarget() {
+    static FuzzTarget target {};
+    return target;
+}
+
+// libFuzzer hands over its own command line, it only warns about flags it doesn't know
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+    for(int index = 1; index < *argc; index++) {
+        if(strcmp((*argv)[index], "--compare") == 0)
+            getTarget().setCompareEngines(true);
+    }
+
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size) {
+    getTarget().run(data, size);
+    return 0;
+}
+
+#ifndef CHIP8_LIBFUZZER
+// Without libFuzzer: a small coverage guided loop over the same bitmap, so the target is
+// usable with any compiler. Inputs that reach new edge buckets join the corpus
+
+typedef struct {
+    unsigned long long runs { 1000000 };
+    unsigned long long seed { DEFAULT_RANDOM_SEED };
+    const char* corpusDir {};
+    bool compareEngines {};
+    std::vector<std::vector<unsigned char>> corpus {};
+}FuzzOptions;
+
+// What the crash handler writes out, the input currently running
+static const unsigned char* currentInput {};
+static size_t currentSize {};
+
+// Sanitizers exit on an error by default, make them abort so onCrash sees it
+// Only read when the build has sanitizers, harmless otherwise
+extern "C" const char* __asan_default_options() {
+    return "abort_on_error=1";
+}
+
+extern "C" const char* __ubsan_default_options() {
+    return "abort_on_error=1:halt_on_error=1:print_stacktrace=1";
+}
+
+static void onCrash(int signal) {
+    int file = open("crash-input", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(file >= 0) {
+        if(write(file, currentInput, currentSize) < 0) {}
+        close(file);
+    }
+
+    const char message[] = "Crashed, the input was written to crash-input\n";
+    if(write(STDERR_FILENO, message, sizeof(message) - 1) < 0) {}
+
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+// ROM files get a header in front, 8 frames of 32 instructions with no keys held
+static void addInput(const std::filesystem::path& path, std::vector<std::vector<unsigned char>>& corpus) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<unsigned char> input {};
+
+    if(path.extension() == ".ch8") {
+        input = {0, 7, 31};
+        input.resize(FUZZ_HEADER_SIZE + 8 * 2);
+    }
+
+    input.insert(input.end(), std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    input.resize(std::min<size_t>(input.size(), FUZZ_MAX_INPUT));
+    corpus.push_back(std::move(input));
+
+    return;
+}
+
+static void addInputs(const std::string& path, std::vector<std::vector<unsigned char>>& corpus) {
+    if(!std::filesystem::is_directory(path)) {
+        addInput(path, corpus);
+        return;
+    }
+
+    std::vector<std::filesystem::path> found {};
+    for(const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+        if(entry.is_regular_file())
+            found.push_back(entry.path());
+    }
+
+    std::sort(found.begin(), found.end());
+    for(const auto &entry : found)
+        addInput(entry, corpus);
+
+    return;
+}
+
+static char parseOptions(int argc, char* argv[], FuzzOptions& options) {
+    for(int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+
+        if(strncmp(arg, "--runs=", 7) == 0) {
+            if(parseNumber(arg + 7, options.runs))
+                return -1;
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0) {
+            if(parseNumber(arg + 7, options.seed, 0))
+                return -1;
+        }
+        else if(strncmp(arg, "--corpus=", 9) == 0)
+            options.corpusDir = arg + 9;
+        else if(strcmp(arg, "--compare") == 0)
+            options.compareEngines = true;
+        else if(strncmp(arg, "--", 2) == 0)
+            return -1;
+        else
+            addInputs(arg, options.corpus);
+    }
+
+    if(options.corpusDir != nullptr && std::filesystem::is_directory(options.corpusDir))
+        addInputs(options.corpusDir, options.corpus);
+
+    return 0;
+}
+
+// A handful of byte level mutations, opcode sized writes keep ROMs looking like code
+static void mutate(std::vector<unsigned char>& input, const std::vector<std::vector<unsigned char>>& corpus, std::mt19937_64& random) {
+    const unsigned int count = 1 + random() % 4;
+
+    for(unsigned int step = 0; step < count; step++) {
+        const size_t position = input.empty() ? 0 : random() % input.size();
+
+        switch(random() % 6) {
+            case 0:
+                if(!input.empty())
+                    input[position] ^= 1 << (random() % 8);
+                break;
+            case 1:
+                if(!input.empty())
+                    input[position] = static_cast<unsigned char>(random());
+                break;
+            case 2:
+                if(input.size() < FUZZ_MAX_INPUT)
+                    input.insert(input.begin() + position, static_cast<unsigned char>(random()));
+                break;
+            case 3:
+                if(!input.empty())
+                    input.erase(input.begin() + position);
+                break;
+            case 4: {
+                // Two random bytes at an even ROM offset, one whole opcode. Grows the ROM by at
+                // most one opcode, long inputs make every reset more expensive
+                const size_t rom = FUZZ_HEADER_SIZE + FUZZ_MAX_FRAMES * 2;
+                const size_t romLength = (input.size() > rom) ? input.size() - rom : 0;
+                const size_t at = rom + (random() % (romLength / 2 + 1)) * 2;
+                if(at + 2 <= FUZZ_MAX_INPUT) {
+                    input.resize(std::max(input.size(), at + 2));
+                    input[at] = static_cast<unsigned char>(random());
+                    input[at + 1] = static_cast<unsigned char>(random());
+                }
+                break;
+            }
+            default: {
+                // Splice a run of bytes from another corpus entry
+                const std::vector<unsigned char>& other = corpus[random() % corpus.size()];
+                if(other.empty())
+                    break;
+
+                const size_t from = random() % other.size();
+                const size_t length = std::min<size_t>(1 + random() % 64, other.size() - from);
+                input.resize(std::max(input.size(), position + length));
+                std::copy(other.begin() + from, other.begin() + from + length, input.begin() + position);
+                break;
+            }
+        }
+    }
+
+    return;
+}
+
+int main(int argc, char* argv[]) {
+    FuzzOptions options {};
+
+    if(parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s [--runs=N] [--seed=N] [--corpus=DIR] [--compare] [inputs, ROMs or directories]...\n", argv[0]);
+        return -1;
+    }
+
+    if(options.corpus.empty())
+        options.corpus.push_back({});
+
+    getTarget().setCompareEngines(options.compareEngines);
+
+    std::signal(SIGSEGV, onCrash);
+    std::signal(SIGABRT, onCrash);
+    std::signal(SIGFPE, onCrash);
+    std::signal(SIGILL, onCrash);
+
+    // Hit count classes each bucket has reached so far, as AFL does. A run that reaches a new
+    // class anywhere is kept, so loops running longer count as progress too
+    std::vector<unsigned char> seen(FUZZ_COVERAGE_SIZE);
+    const size_t seeds = options.corpus.size();
+    std::mt19937_64 random(options.seed);
+    std::vector<unsigned char> input {};
+    input.reserve(FUZZ_MAX_INPUT);
+    size_t edges {};
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(unsigned long long run = 0; run < options.runs; run++) {
+        // Seeds run as they are first, then mutated copies
+        input = options.corpus[run < seeds ? run : random() % options.corpus.size()];
+        if(run >= seeds)
+            mutate(input, options.corpus, random);
+
+        memset(coverage, 0, sizeof(coverage));
+        currentInput = input.data();
+        currentSize = input.size();
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+
+        // Most buckets stay zero, skip them eight at a time
+        bool discovered = false;
+        for(size_t bucket = 0; bucket < FUZZ_COVERAGE_SIZE; bucket += 8) {
+            unsigned long long counters;
+            memcpy(&counters, coverage + bucket, sizeof(counters));
+            if(counters == 0)
+                continue;
+
+            for(size_t index = bucket; index < bucket + 8; index++) {
+                const unsigned char hits = coverage[index];
+                const unsigned char countClass = (hits == 0) ? 0 : 1 << std::min(7, 31 - __builtin_clz(hits));
+                if(countClass & ~seen[index]) {
+                    edges += (seen[index] == 0);
+                    seen[index] |= countClass;
+                    discovered = true;
+                }
+            }
+        }
+
+        if(!discovered || run < seeds)
+            continue;
+
+        options.corpus.push_back(input);
+        if(options.corpusDir != nullptr) {
+            std::filesystem::create_directories(options.corpusDir);
+            char name[32];
+            snprintf(name, sizeof(name), "/%016llX", fnv1aHash(input.data(), input.size()));
+            std::ofstream(std::string(options.corpusDir) + name, std::ios::binary).write(reinterpret_cast<const char*>(input.data()), input.size());
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(stderr, "%llu runs in %.3f s (%.0f execs/s), %zu edge buckets, corpus of %zu\n",
+            options.runs, seconds, options.runs / seconds, edges, options.corpus.size());
+
+    return 0;
+}
+#endif
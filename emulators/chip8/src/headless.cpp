@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "aot.h"
+#include "block_engine.h"
+#include "chip8.h"
+#include "cpu_core.h"
+#include "debugger.h"
+#include "options.h"
+#include "rom.h"
+#include "scheduler.h"
+
+#define HEADLESS_DEFAULT_FRAMES 600
+
+typedef struct {
+    unsigned long long frameBudget { HEADLESS_DEFAULT_FRAMES };
+    unsigned int cyclesPerFrame { DEFAULT_CYCLES_PER_FRAME };
+    unsigned long long seed { DEFAULT_RANDOM_SEED };
+    unsigned short keyMask {};
+    bool useBlockCore {};
+    bool overrideQuirks {};
+    QuirkProfile quirkProfile {};
+    const char* screenPath {};
+    const char* aotDir {};
+    const char* debugPath {};
+    const char* rom {};
+}HeadlessOptions;
+
+static char parseOptions(int argc, char* argv[], HeadlessOptions& options) {
+    for(int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+
+        if(strncmp(arg, "--frames=", 9) == 0) {
+            if(parseNumber(arg + 9, options.frameBudget))
+                return -1;
+        }
+        else if(strncmp(arg, "--cycles-per-frame=", 19) == 0) {
+            if(parseNumber(arg + 19, options.cyclesPerFrame) || options.cyclesPerFrame == 0)
+                return -1;
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0) {
+            if(parseNumber(arg + 7, options.seed, 0))
+                return -1;
+        }
+        else if(strncmp(arg, "--keys=", 7) == 0) {
+            if(parseNumber(arg + 7, options.keyMask, 0))
+                return -1;
+        }
+        else if(strcmp(arg, "--engine=block") == 0)
+            options.useBlockCore = true;
+        else if(strcmp(arg, "--engine=interp") == 0)
+            options.useBlockCore = false;
+        else if(strncmp(arg, "--quirks=", 9) == 0) {
+            if(parseQuirkProfile(arg + 9, options.quirkProfile))
+                return -1;
+            options.overrideQuirks = true;
+        }
+        else if(strncmp(arg, "--screen=", 9) == 0)
+            options.screenPath = arg + 9;
+        else if(strncmp(arg, "--aot=", 6) == 0)
+            options.aotDir = arg + 6;
+        else if(strncmp(arg, "--debug=", 8) == 0)
+            options.debugPath = arg + 8;
+        else if(strncmp(arg, "--", 2) == 0 || options.rom != nullptr)
+            return -1;
+        else
+            options.rom = arg;
+    }
+
+    return (options.rom == nullptr) ? -1 : 0;
+}
+
+// Plain PBM, a pixel is set if it's lit on any plane
+static char writeScreen(const char* path, const Chip8& chip8) {
+    const pixels::PackedBuffer& planes = chip8.getPixels();
+    const int width = pixels::getWidth(chip8.isHires());
+    const int height = pixels::getHeight(chip8.isHires());
+
+    FILE* file = fopen(path, "w");
+    if(file == nullptr)
+        return -1;
+
+    fprintf(file, "P1\n%d %d\n", width, height);
+    for(int row = 0; row < height; row++) {
+        for(int column = 0; column < width; column++) {
+            const int word = row * pixels::ROW_WORDS + column / pixels::PACKED_ROW_BITS;
+            const int bit = pixels::PACKED_ROW_BITS - 1 - column % pixels::PACKED_ROW_BITS;
+            bool lit = false;
+
+            for(const pixels::PackedPlane& plane : planes)
+                lit |= (plane[word] >> bit) & 1;
+
+            fputc(lit ? '1' : '0', file);
+        }
+        fputc('\n', file);
+    }
+
+    return fclose(file) ? -1 : 0;
+}
+
+// One ROM, no window, no audio device, no thread pool: runs and prints the final state
+int main(int argc, char* argv[]) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    HeadlessOptions options {};
+
+    if(parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s <ROM path> [--frames=N] [--cycles-per-frame=N] [--seed=N] [--keys=MASK] [--quirks=default|chip8|schip|xochip] [--engine=interp|block] [--aot=DIR] [--screen=FILE] [--debug=PATH]\n", argv[0]);
+        return -1;
+    }
+
+    // Outlives the core, native bodies live in its modules
+    std::unique_ptr<AotLibrary> aotLibrary {};
+    std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+    std::unique_ptr<CpuCore> cpuCore = std::make_unique<InterpreterCore>();
+    MappedRomManager romManager;
+    Debugger debugger;
+
+    if(options.useBlockCore)
+        cpuCore = std::make_unique<BlockCore>();
+
+    if(romManager.loadRom(options.rom, *chip8)) {
+        fprintf(stderr, "Could not load ROM %s\n", options.rom);
+        return -1;
+    }
+
+    // Recompiled ROMs run on the block engine with native bodies, others on the plain block engine
+    if(options.aotDir != nullptr) {
+        std::unique_ptr<BlockCore> blockCore = std::make_unique<BlockCore>();
+        aotLibrary = std::make_unique<AotLibrary>(options.aotDir);
+        blockCore->setNativeModule(aotLibrary->find(RomCache::acquire(options.rom)->getHash()));
+        cpuCore = std::move(blockCore);
+    }
+
+    if(options.overrideQuirks)
+        chip8->setQuirkProfile(options.quirkProfile);
+    chip8->seedRandom(options.seed);
+    chip8->setKeyMask(options.keyMask);
+
+    if(options.debugPath != nullptr && debugger.listen(options.debugPath)) {
+        fprintf(stderr, "Could not open debugger socket %s\n", options.debugPath);
+        return -1;
+    }
+
+    const double startup = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    FrameScheduler scheduler(options.cyclesPerFrame, true);
+    unsigned long long cycles {};
+    for(unsigned long long frame = 0; frame < options.frameBudget; frame++)
+        cycles += scheduler.runFrame(*chip8, *cpuCore);
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() - startup;
+
+    if(options.screenPath != nullptr && writeScreen(options.screenPath, *chip8)) {
+        fprintf(stderr, "Could not write screen %s\n", options.screenPath);
+        return -1;
+    }
+
+    printf("%016llX %llu frames %llu cycles\n", chip8->getStateHash(), options.frameBudget, chip8->getCycleCount());
+    fprintf(stderr, "Ready in %.0f us, %llu instructions in %.3f s\n", startup * 1e6, cycles, seconds);
+
+    return 0;
+}
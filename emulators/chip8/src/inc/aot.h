@@ -0,0 +1,90 @@
+#ifndef AOT_H
+#define AOT_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "chip8.h"
+
+#define AOT_ABI_VERSION     4
+#define AOT_ENTRY_POINT     "chip8AotModule"    // extern "C", returns the module's AotModule
+#define AOT_LOOP_IDLE       0x10000             // Added to the index of the jump an AotLoop stopped idle at
+
+// Ahead of time recompiled block bodies, built by Chip8Aot into one shared object per ROM
+// BlockCore still forms the blocks and runs their exits, a native body only replaces the
+// handler calls in between. A body is used only if memory still holds the exact opcodes it
+// was compiled from, so rewritten code and addresses Chip8Aot never saw stay on the handlers
+
+// Does what calling each handler in body would do, counting instructions skips stepped over
+// Stops at control flow a skip didn't step over and returns its index, or the body's length
+typedef unsigned int(*AotBody)(Chip8& chip8, const Opcodes::Instruction* body, unsigned int& skipped);
+
+// Blocks that jump back to their own start also get a loop, which closes up to passes loops
+// itself, counting their cycles and probing them like BlockCore would. The pass after that,
+// or one that goes anywhere else, returns like AotBody does. A loop left idle returns
+// AOT_LOOP_IDLE plus the jump's index, the body's length for the block's exit
+typedef unsigned int(*AotLoop)(Chip8& chip8, const Opcodes::Instruction* body, unsigned int passes, unsigned int& skipped);
+
+typedef struct {
+    unsigned short start;
+    unsigned short length;          // Body instructions, the exit isn't included
+    const unsigned short* opcodes;  // What the body was compiled from
+    AotBody run;
+    AotLoop loop;                   // nullptr unless the block jumps back to its start
+}AotBlock;
+
+typedef struct {
+    unsigned int abiVersion;
+    unsigned int chip8Size;         // Catches modules built against a different Chip8 layout
+    unsigned long long romHash;
+    unsigned int blockCount;
+    const AotBlock* blocks;         // Sorted by start
+}AotModule;
+
+// What generated code may touch directly, everything else goes through the handlers
+class AotAccess {
+    public:
+        static unsigned char* registers(Chip8& chip8) { return chip8.v; };
+        static unsigned short& indexRegister(Chip8& chip8) { return chip8.I; };
+        static unsigned short& delayTimer(Chip8& chip8) { return chip8.delay_timer; };
+        static unsigned short& soundTimer(Chip8& chip8) { return chip8.sound_timer; };
+
+        // The jump back to head after a pass that ran cycles, true once the machine is idle
+        // polling is the pass having run nothing but skips, see BlockCore::findPolling
+        static bool closeLoop(Chip8& chip8, unsigned short head, unsigned int cycles, bool polling) {
+            chip8.cycleCount += cycles;
+            chip8.probeLoop(head);
+            if(polling)
+                chip8.idlePeriod = cycles;
+
+            return chip8.idlePeriod != 0;
+        };
+};
+
+// Opens "<directory>/<ROM hash>.so" the first time a ROM asks, safe to share between threads
+class AotLibrary {
+    public:
+        AotLibrary(std::string_view directory) : directory(directory) {};
+        ~AotLibrary();
+
+        AotLibrary(const AotLibrary&) = delete;
+        AotLibrary& operator=(const AotLibrary&) = delete;
+
+        // nullptr if there's no usable module for the ROM
+        const AotModule* find(unsigned long long romHash);
+
+        static std::string getModuleName(unsigned long long romHash);
+
+    private:
+        typedef struct {
+            void* handle;
+            const AotModule* module;
+        }LoadedModule;
+
+        std::string directory;
+        std::mutex mutex {};
+        std::map<unsigned long long, LoadedModule> modules {};
+};
+
+#endif
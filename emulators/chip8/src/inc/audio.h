@@ -0,0 +1,110 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include "chip8.h"
+#include "sdl_error.h"
+#include "spsc_ring.h"
+#include "tone.h"
+
+#define AUDIO_DEVICE_SAMPLES    512     // Samples SDL asks for per callback
+#define AUDIO_RING_SAMPLES      8192
+#define AUDIO_MAX_QUEUED_FRAMES 4       // Latency cap, turbo runs drop frames instead of piling them up
+
+// The emulation thread generates each frame's samples into a lock-free ring and SDL's audio
+// thread drains it from the callback. Neither side ever takes a lock or waits on the other:
+// a full ring drops the frame, an empty one plays silence
+// Headless runs work with SDL_AUDIODRIVER=dummy or disk
+class Audio {
+    public:
+        Audio() {
+            if(SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+                SDL_ERROR_COUT("SDL audio init has failed!");
+                return;
+            }
+            initialized = true;
+
+            SDL_AudioSpec desired {};
+            desired.freq = AUDIO_SAMPLE_RATE;
+            desired.format = AUDIO_S16SYS;
+            desired.channels = 1;
+            desired.samples = AUDIO_DEVICE_SAMPLES;
+            desired.callback = fillCallback;
+            desired.userdata = this;
+
+            // No allowed changes, SDL converts if the hardware wants something else
+            audioDevice = SDL_OpenAudioDevice(NULL, 0, &desired, NULL, 0);
+            if(audioDevice == 0) {
+                SDL_ERROR_COUT("Audio device could not be opened!");
+                return;
+            }
+
+            SDL_PauseAudioDevice(audioDevice, 0);
+        };
+        ~Audio() {
+            if(audioDevice != 0)
+                SDL_CloseAudioDevice(audioDevice);
+            audioDevice = 0;
+
+            if(initialized)
+                SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        };
+
+        Audio(const Audio&) = delete;
+        Audio& operator=(const Audio&) = delete;
+
+        // Emulation thread, once per frame after the timers ticked
+        void queueFrame(const Chip8& chip8) {
+            if(audioDevice == 0)
+                return;
+
+            const size_t count = tone.generateFrame(chip8, frameSamples.data());
+
+            // Running ahead of the device (turbo), keep latency bounded
+            if(ring.size() + count > AUDIO_MAX_QUEUED_FRAMES * AUDIO_FRAME_SAMPLES) {
+                droppedFrames++;
+                return;
+            }
+
+            ring.push(frameSamples.data(), count);
+
+            return;
+        };
+
+        bool isOpen() const {
+            return audioDevice != 0;
+        };
+
+        unsigned long long getDroppedFrames() const {
+            return droppedFrames;
+        };
+
+    private:
+        // Runs on SDL's audio thread
+        static void SDLCALL fillCallback(void* userdata, Uint8* stream, int length) {
+            Audio* audio = static_cast<Audio*>(userdata);
+            int16_t* samples = reinterpret_cast<int16_t*>(stream);
+            const size_t count = length / sizeof(int16_t);
+
+            // Underrun, pad with silence rather than wait on the emulator
+            const size_t read = audio->ring.pop(samples, count);
+            std::fill(samples + read, samples + count, 0);
+
+            return;
+        };
+
+        static_assert(AUDIO_MAX_QUEUED_FRAMES * AUDIO_FRAME_SAMPLES <= AUDIO_RING_SAMPLES, "Ring can't hold the latency cap");
+
+        SDL_AudioDeviceID audioDevice {};
+        bool initialized {};
+
+        ToneGenerator tone {};
+        std::array<int16_t, AUDIO_FRAME_SAMPLES> frameSamples {};
+        SpscRing<int16_t, AUDIO_RING_SAMPLES> ring {};
+        unsigned long long droppedFrames {};
+};
+
+#endif
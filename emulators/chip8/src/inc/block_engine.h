@@ -0,0 +1,183 @@
+#ifndef BLOCK_ENGINE_H
+#define BLOCK_ENGINE_H
+
+#include <array>
+#include <memory>
+#include <vector>
+#include "aot.h"
+#include "cpu_core.h"
+
+#define BLOCK_MAX_INSTRUCTIONS  64
+#define BLOCK_NOT_POLLING       0xFFFF  // pollSkips of anything that isn't a jump back to the block's start
+
+// Splits ROM code into basic blocks and runs them as direct-threaded code
+// Blocks end on anything that changes control flow or writes memory, control flow behind a skip
+// leaves the block early instead of ending it
+// Bodies jump straight from one instruction's code to the next, with no fetch, decode or PC
+// update in between. Native bodies from a Chip8Aot module go further by dropping the dispatch too
+class BlockCore : public CpuCore {
+    public:
+        BlockCore() {};
+        ~BlockCore() {};
+
+        unsigned int run(Chip8& chip8, unsigned int cycleBudget);
+
+        // Bodies from a Chip8Aot module replace handler calls wherever the opcodes still match
+        // Set it before the first run, blocks compiled earlier keep their handlers
+        void setNativeModule(const AotModule* module) {
+            nativeModule = module;
+        };
+
+        // Chip8Aot forms its blocks with compileBlock so they line up with the ones run here
+        friend class AotCompiler;
+
+    private:
+        // Jumps, calls, returns and skips are resolved inline, everything else goes through its handler
+        // Skips stay together, isSkip tells them apart from the rest by range
+        enum class ExitKind : unsigned char {
+            Fallthrough,
+            Jump,
+            Call,
+            Return,
+            SkipEqualImmediate,
+            SkipNotEqualImmediate,
+            SkipEqualRegister,
+            SkipNotEqualRegister,
+            SkipKeyPressed,
+            SkipKeyReleased,
+            Handler
+        };
+
+        // Body instructions whose behaviour is fixed once the block's quirk profile is known run
+        // inline, the rest call their handler
+        enum class BodyKind : unsigned char {
+            LoadImmediate,      // 6XNN
+            AddImmediate,       // 7XNN
+            LoadIndex,          // ANNN
+            Copy,               // 8XY0
+            Or,                 // 8XY1
+            And,                // 8XY2
+            Xor,                // 8XY3
+            Add,                // 8XY4
+            Subtract,           // 8XY5
+            ShiftRight,         // 8XY6
+            SubtractReverse,    // 8XY7
+            ShiftLeft,          // 8XYE
+            LoadDelay,          // FX07
+            SetDelay,           // FX15
+            SetSound,           // FX18
+            AddIndex,           // FX1E
+            FontIndex,          // FX29
+            SkipEqualImmediate,     // Skips decide whether the next body instruction runs,
+            SkipNotEqualImmediate,  // same order as their ExitKind
+            SkipEqualRegister,
+            SkipNotEqualRegister,
+            SkipKeyPressed,
+            SkipKeyReleased,
+            LeaveJump,          // Control flow behind a skip, the block stops here if the skip isn't taken
+            LeaveCall,
+            LeaveReturn,
+            LeaveHandler,
+            Handler
+        };
+
+        struct Block;
+
+        typedef struct {
+            BodyKind kind {};
+            ExitKind control {};        // Leave kinds only, how to run it
+            unsigned short addr {};     // Leave kinds only, where it sits
+            unsigned short count {};    // Leave kinds only, instructions up to and including it
+            Block* successor {};        // Leave kinds only, where it went last
+            unsigned short pollSkips {BLOCK_NOT_POLLING};  // Leave kinds only, see Block::pollSkips
+        }BodyStep;
+
+        // One body instruction as threaded code, operands already pulled out of the opcode
+        // Built the first time the block runs, see runBody
+        typedef struct {
+            const void* label;          // Where its code starts in runBody
+            unsigned char slot;         // The same as an index into runBody's label table
+            unsigned char x;
+            unsigned char y;
+            unsigned short operand;     // nn or nnn
+            unsigned short index;       // Into body and steps
+        }ThreadedStep;
+
+        typedef struct {
+            unsigned short start;
+            unsigned short end;
+        }CodeRange;
+
+        // Straight-line instructions followed by at most one control flow instruction
+        // Nothing in body reads PC, so PC is only set once before the exit
+        // Unconditional jumps are followed at compile time, so a block can span several ranges
+        // Skips stay in the body as a condition on the next instruction. When that one is control
+        // flow the block leaves through it, and carries on past it when the skip is taken
+        typedef struct Block {
+            unsigned short start;
+            unsigned short exitAddr;
+            unsigned int length;
+            std::vector<CodeRange> ranges;
+            ExitKind exitKind;
+            bool writesMemory;
+            std::vector<Opcodes::Instruction> body;
+            std::vector<BodyStep> steps;        // One per body instruction
+            std::vector<ThreadedStep> threaded; // Body plus a final step that ends it, empty until first run
+            Quirks quirks;                      // Profile the block was compiled for
+            Opcodes::Instruction exit;
+            AotBody native;         // Recompiled body, nullptr runs the handlers
+            AotLoop nativeLoop;     // Recompiled passes of a block that loops on itself, see runLoop
+
+            // Body instructions in front of the exit jump that aren't skips. When exactly that many got
+            // skipped the loop back to start ran nothing but tests, and will keep doing so all slice
+            unsigned short pollSkips;
+            unsigned int(*runner)(Chip8& chip8, Block& block, Block**& successor, unsigned int budget);     // See runBlock
+
+            // Blocks control went to last, [1] only used by skips that were taken
+            struct Block* successor[2];
+        }Block;
+
+        static bool endsBlock(unsigned short opcode);
+        static bool writesMemory(unsigned short opcode);
+        static bool waitsForKey(unsigned short opcode);
+        static ExitKind classifyExit(unsigned short opcode, unsigned short exitAddr);
+        static BodyKind classifyBody(unsigned short opcode);
+        static BodyKind classifyLeave(ExitKind kind);
+        static bool isLeave(BodyKind kind);
+        static bool isSkip(ExitKind kind);
+        static bool isSkip(BodyKind kind);
+        static void findPolling(Block& block);
+        static bool testSkip(const Chip8& chip8, ExitKind kind, const Opcodes::Instruction& instruction);
+        static size_t runBody(Chip8& chip8, Block& block, unsigned int& skipped);
+        static void threadBody(Block& block, const void* const* labels);
+        static size_t runNative(Chip8& chip8, const Block& block, unsigned int& skipped);
+        static size_t finishNative(Chip8& chip8, const Block& block, size_t stop, unsigned int skipped);
+        static void runControl(Chip8& chip8, ExitKind kind, const Opcodes::Instruction& instruction, unsigned short addr);
+
+        // Runs the whole block, returns how many instructions actually ran and where to cache the next block
+        // budget is never less than the block's length
+        typedef unsigned int(*BlockRunner)(Chip8& chip8, Block& block, Block**& successor, unsigned int budget);
+        template<ExitKind Exit>
+        static unsigned int runBlock(Chip8& chip8, Block& block, Block**& successor, unsigned int budget);
+        template<ExitKind Exit>
+        static unsigned int runLoop(Chip8& chip8, Block& block, Block**& successor, unsigned int budget);
+        template<ExitKind Exit>
+        static unsigned int finishBlock(Chip8& chip8, Block& block, size_t stop, unsigned int skipped, Block**& successor);
+        static BlockRunner selectRunner(ExitKind exit, bool loops);
+
+        Block* findBlock(Chip8& chip8, unsigned short addr);
+        Block* compileBlock(Chip8& chip8, unsigned short addr);
+        void dropDirtyBlocks(Chip8& chip8);
+        static void markCode(Chip8& chip8, const Block& block);
+        const AotBlock* findNative(const Block& block) const;
+#ifdef CHIP8_PROFILE
+        static void profileBlock(const Chip8& chip8, const Block& block);
+#endif
+
+        std::array<std::unique_ptr<Block>, ROM_MEM_SIZE> blocks {};
+        std::vector<unsigned short> compiledStarts {};
+        unsigned int seenGeneration {};
+        const AotModule* nativeModule {};
+};
+
+#endif
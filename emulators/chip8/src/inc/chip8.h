@@ -1,9 +1,19 @@
 #ifndef CHIP_8_H
 #define CHIP_8_H
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bitset>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
-#include "display.h"
+#include <memory>
+#include "hash.h"
+#include "logger.h"
+#include "pixels.h"
+#include "profiler.h"
+#include "snapshot.h"
 #include "opcode.h"
 
 #define CHIP_8_MEM_SIZE     0x1000
@@ -14,6 +24,19 @@
 #define REGISTER_COUNT      0x10
 #define STACK_SIZE          12
 #define KEY_SIZE            0x10
+#define KEY_WAIT_NONE       0xFF    // FX0A hasn't latched a key yet
+#define LOOP_PROBE_NONE     0xFFFF  // No backward jump seen this slice
+#define LOOP_PROBE_MAX_GAP  64      // Most loop closes between two register compares
+#define DEFAULT_RANDOM_SEED 0x43484950383231ULL  // Fixed so runs are reproducible unless seeded
+
+#define FONT_START              0x00
+#define FONT_CHAR_SIZE          5
+#define HIRES_FONT_START        0x50    // Right after the small font
+#define HIRES_FONT_CHAR_SIZE    10
+
+// XO-CHIP audio, without F002 the pattern is a plain square wave buzzer
+#define AUDIO_PATTERN_SIZE      16
+#define DEFAULT_AUDIO_PITCH     64      // 4000 pattern bits per second
 
 #define OVERFLOW_OCCURED        0x01
 #define OVERFLOW_DID_NOT_OCCUR  0x00
@@ -25,7 +48,11 @@
 #define ADDR_BOUNDARY_DETECT(addr)          (addr >= 0 && addr < CHIP_8_MEM_SIZE)
 #define REGISTER_BOUNDARY_DETECT(register)  (register >= 0 && register < REGISTER_COUNT)
 #define MEMORY_SIZE_DETECT(size)            (size <= 0 && size > ROM_MEM_SIZE)
-#define KEY_BOUNDARY_CHECK(key)             (key <= 0 && key > KEY_SIZE)
+#define KEY_BOUNDARY_CHECK(key)             (key >= 0 && key < KEY_SIZE)
+
+static_assert(SNAPSHOT_PAGE_SIZE * SNAPSHOT_PAGE_COUNT == CHIP_8_MEM_SIZE, "Snapshot pages must cover memory");
+static_assert(SNAPSHOT_REGISTER_COUNT == REGISTER_COUNT && SNAPSHOT_STACK_SIZE == STACK_SIZE &&
+              SNAPSHOT_AUDIO_PATTERN_SIZE == AUDIO_PATTERN_SIZE, "Snapshot layout out of date");
 
 const unsigned char FontSet[] {
     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -46,17 +73,60 @@ const unsigned char FontSet[] {
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+// SUPER-CHIP digits, A-F as XO-CHIP added them
+const unsigned char HiresFontSet[] {
+    0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+    0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+    0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+    0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+static_assert(FONT_START + sizeof(FontSet) <= HIRES_FONT_START, "Fonts overlap");
+static_assert(HIRES_FONT_START + sizeof(HiresFontSet) <= CHIP_8_RESERVED_MEM, "Fonts must fit in reserved memory");
+
 class Chip8 {
     public:
         Chip8() {
-            writeMemory(&FontSet, sizeof(FontSet), CHIP_8_MEM_START);
+            writeMemory(&FontSet, sizeof(FontSet), FONT_START);
+            writeMemory(&HiresFontSet, sizeof(HiresFontSet), HIRES_FONT_START);
         };
 
         ~Chip8() {};
 
         void readNextInstruction() {
-            // Did not use PC++ on both to ease future development
-            opcodes.executeOpcode(GET_OPCODE(memory[PC], memory[PC+1]), *this);
+            cycleCount++;
+            printDebug();
+
+            // Fonts/reserved space and the last byte are never cached, decode them directly
+            // The last byte's opcode takes its low byte from address 0
+            if(PC < ROM_MEM_START || PC >= CHIP_8_MEM_SIZE - 1) {
+                const unsigned short opcode = GET_OPCODE(memory[PC], memory[(PC + 1) & (CHIP_8_MEM_SIZE - 1)]);
+                PROFILE_INSTRUCTION(PC, opcode);
+
+                // Did not use PC++ on both to ease future development
+                opcodes.executeOpcode(opcode, *this);
+                return;
+            }
+
+            Opcodes::Instruction& instruction = decodeCache[PC - ROM_MEM_START];
+            if(instruction.handler == nullptr)
+                instruction = Opcodes::decodeInstruction(GET_OPCODE(memory[PC], memory[PC+1]), quirkProfile);
+
+            PROFILE_INSTRUCTION(PC, instruction.opcode);
+            addProgramCounter(2);
+            instruction.handler(instruction, *this);
         };
 
         // Are C-style arrays the best choice here? 
@@ -67,29 +137,33 @@ class Chip8 {
             
             const unsigned char* byteData = static_cast<const unsigned char*>(data);
             std::copy(byteData, byteData + size, memory + offset);
+            onMemoryWrite(offset, size);
 
             return 0;
         };
 
         // Is this the best format for default variables?
+        // Debug level, one record per 16 byte row
         void printMemory(size_t offset = 0, size_t size = CHIP_8_MEM_SIZE) const {
-            // TODO: Range Checking
-            // TODO: Replace this with better logging system
+            size = std::min<size_t>(size, CHIP_8_MEM_SIZE);
+
             while(offset < size) {
-                if(offset % 16 == 0)
-                    printf("\n0x%04X: ", static_cast<unsigned int>(offset));
-                printf("%02X ", memory[offset]);
-                offset++;
-            }
+                char row[LOG_TEXT_SIZE] {};
+                size_t rowStart = offset;
+
+                // "XX XX ... XX", exactly fills the record's text for a full row
+                for(size_t column = 0, position = 0; offset < size && column < 16; column++, offset++)
+                    position += snprintf(row + position, sizeof(row) - position, column ? " %02X" : "%02X", memory[offset]);
 
-            printf("\n");   // Makes output clearer
+                LOG_DEBUG("0x%04X: %s", rowStart, row);
+            }
 
             return;
         };
 
-        void printDebug(void) {
-            printf("Last used opcode: %02X%02X ", memory[PC], memory[PC+1]);
-            printf("PC: %04X    SP: %02X    I: %04X\n", PC, SP, I);
+        // Trace level, every instruction the interpreter is about to run
+        void printDebug(void) const {
+            LOG_TRACE("Opcode: %02X%02X PC: %04X    SP: %02X    I: %04X", memory[PC], memory[(PC + 1) & (CHIP_8_MEM_SIZE - 1)], PC, SP, I);
             return;
         };
 
@@ -98,6 +172,10 @@ class Chip8 {
             return (ADDR_BOUNDARY_DETECT(addr) ? memory[addr] : -1);
         };
 
+        unsigned short getProgramCounter() const {
+            return PC;
+        };
+
         // TODO: Don't all these access functions defeat the purpose of OOP? Alternative structure?
         char setProgramCounter(unsigned short addr) {
             if(!(ADDR_BOUNDARY_DETECT(addr)))
@@ -143,27 +221,331 @@ class Chip8 {
             return 0;
         };
 
+        // Presses exactly one key, releasing the others
         char setKey(unsigned short key) {
             if(!KEY_BOUNDARY_CHECK(key))
                 return -1;
 
-            key_pressed = key;
+            keyMask.store(1 << key, std::memory_order_relaxed);
             
             return 0;
         };
 
-        const pixels::PixelBuffer& getPixels() const {
+        // Bit n set means key n is held
+        // Safe to call from an input thread, though frontends sample once per frame to stay reproducible
+        void setKeyMask(unsigned short mask) {
+            keyMask.store(mask, std::memory_order_relaxed);
+            return;
+        };
+
+        unsigned short getKeyMask() const {
+            return keyMask.load(std::memory_order_relaxed);
+        };
+
+        // FX0A is holding the machine until a key is pressed and released
+        bool isWaitingForKey() const {
+            return keyWaiting;
+        };
+
+        // Keys and timers only change between CPU slices, so a machine that came back to the
+        // same state is going to repeat itself until the slice ends. FX0A waiting for a key and
+        // 00FD are the one instruction cases, loops are found by probeLoop on backward jumps
+        bool isIdle() const {
+            return idlePeriod != 0;
+        };
+
+        // Lets whole idle iterations that fit in remaining cycles pass without running them
+        // Returns how many cycles were skipped, the leftover partial iteration still has to run
+        unsigned int skipIdleCycles(unsigned int remaining) {
+            unsigned int skipped = remaining - remaining % idlePeriod;
+
+            cycleCount += skipped;
+            idlePeriod = 0;
+            PROFILE_IDLE(skipped);
+
+            return skipped;
+        };
+
+        // CPU cores call this before running a slice, inputs may have changed since the last one
+        void beginSlice() {
+            loopProbe.head = LOOP_PROBE_NONE;
+            idlePeriod = 0;
+
+            return;
+        };
+
+        // Backward jump to head, marks the machine idle when nothing changed since the last time
+        // the loop got here this slice
+        void probeLoop(unsigned short head) {
+            // Memory and display writes are counted rather than compared, so a loop that stores
+            // anything never counts as idle even if it keeps writing the same bytes. Drawing loops
+            // stop here without touching the registers
+            if(loopProbe.head != head || loopProbe.writes != writeCount) {
+                loopProbe.head = head;
+                loopProbe.cycle = cycleCount;
+                loopProbe.writes = writeCount;
+                loopProbe.complete = false;
+                loopProbe.gap = 1;
+                loopProbe.countdown = 1;
+
+                return;
+            }
+
+            // A loop that keeps changing registers is compared less and less often, any two
+            // matching passes are a whole number of periods apart so detection stays exact
+            if(--loopProbe.countdown == 0)
+                compareLoopProbe();
+
+            return;
+        };
+
+        // Every machine owns its RNG so a run is reproducible from its seed
+        void seedRandom(unsigned long long seed) {
+            randomState = seed;
+            return;
+        };
+
+        // Picks the opcode variants, cached decodes and compiled blocks are thrown away
+        void setQuirkProfile(QuirkProfile profile) {
+            quirkProfile = profile;
+
+            for(Opcodes::Instruction& instruction : decodeCache)
+                instruction.handler = nullptr;
+            dirtyCode |= codeBytes;
+            codeGeneration++;
+
+            return;
+        };
+
+        QuirkProfile getQuirkProfile() const {
+            return quirkProfile;
+        };
+
+        // Instructions executed since power on, used to timestamp input
+        unsigned long long getCycleCount() const {
+            return cycleCount;
+        };
+
+        // Called at 60 Hz by the frame scheduler
+        void tickTimers() {
+            if(delay_timer > 0)
+                delay_timer--;
+
+            // The buzzer sounds for every frame that ends with the timer still running
+            beeping = sound_timer > 0;
+            if(sound_timer > 0)
+                sound_timer--;
+
+            return;
+        };
+
+        // Whether the buzzer was on over the last frame
+        bool isBeeping() const {
+            return beeping;
+        };
+
+        const unsigned char* getAudioPattern() const {
+            return audioPattern;
+        };
+
+        unsigned char getAudioPitch() const {
+            return audioPitch;
+        };
+
+        const pixels::PackedBuffer& getPixels() const {
             return pixels;
         };
+
+        // 128x64 after 00FF, 64x32 after 00FE and at power on
+        bool isHires() const {
+            return hires;
+        };
+
+        // True if a draw or clear touched the display since the last call
+        bool takeDisplayDirty() {
+            bool dirty = displayDirty;
+            displayDirty = false;
+
+            return dirty;
+        };
+
+        // FNV-1a over everything that makes up the machine state
+        // Used by the batch runner to compare runs
+        unsigned long long getStateHash() const {
+            unsigned long long hash { FNV_OFFSET_BASIS };
+            auto hashBytes = [&hash](const void* data, size_t size) {
+                hash = fnv1aHash(data, size, hash);
+            };
+
+            hashBytes(memory, sizeof(memory));
+            hashBytes(v, sizeof(v));
+            hashBytes(stack, sizeof(stack));
+            hashBytes(&PC, sizeof(PC));
+            hashBytes(&SP, sizeof(SP));
+            hashBytes(&I, sizeof(I));
+            hashBytes(&delay_timer, sizeof(delay_timer));
+            hashBytes(&sound_timer, sizeof(sound_timer));
+            hashBytes(&randomState, sizeof(randomState));
+            hashBytes(&pixels, sizeof(pixels));
+            hashBytes(&hires, sizeof(hires));
+            hashBytes(&planeMask, sizeof(planeMask));
+            hashBytes(audioPattern, sizeof(audioPattern));
+            hashBytes(&audioPitch, sizeof(audioPitch));
+            hashBytes(&keyWaiting, sizeof(keyWaiting));
+            hashBytes(&keyWaitIgnored, sizeof(keyWaitIgnored));
+            hashBytes(&keyWaitKey, sizeof(keyWaitKey));
+
+            return hash;
+        };
         
+        // Registers and display only, cheap enough to check every frame during replay
+        unsigned long long getFrameHash() const {
+            unsigned long long hash { FNV_OFFSET_BASIS };
+            auto hashBytes = [&hash](const void* data, size_t size) {
+                hash = fnv1aHash(data, size, hash);
+            };
+
+            hashBytes(v, sizeof(v));
+            hashBytes(stack, sizeof(stack));
+            hashBytes(&PC, sizeof(PC));
+            hashBytes(&SP, sizeof(SP));
+            hashBytes(&I, sizeof(I));
+            hashBytes(&delay_timer, sizeof(delay_timer));
+            hashBytes(&sound_timer, sizeof(sound_timer));
+            hashBytes(&randomState, sizeof(randomState));
+            hashBytes(&pixels, sizeof(pixels));
+            hashBytes(&hires, sizeof(hires));
+            hashBytes(&planeMask, sizeof(planeMask));
+
+            return hash;
+        };
+
+        // Copy-on-write capture: pages untouched since the last snapshot/restore are shared
+        Snapshot takeSnapshot();
+
+        // Only copies pages that differ from the snapshot or were written since the last sync
+        void restoreSnapshot(const Snapshot& snapshot);
+
         // Using friend so opcodes can access memory/stack/regis
         friend class Opcodes;
+        template<QuirkProfile PROFILE> friend class OpcodeCore;
+        friend class BlockCore;
+        template<unsigned int VECTOR_BYTES> friend class WideKernel;
+        friend class WideEngine;
+        friend class TraceCore;
+        friend class AotAccess;
+        friend class Debugger;
 
     private:
+        // Every store into memory ends here: drops cached decodes overlapping [offset, offset + size)
+        // and marks the touched snapshot pages. The decode entry at offset - 1 reads the first
+        // written byte as its low byte, so it goes too
+        void onMemoryWrite(size_t offset, size_t size) {
+            // Stores at I wrap to the start of memory, the wrapped part is its own range
+            if(offset < CHIP_8_MEM_SIZE && offset + size > CHIP_8_MEM_SIZE) {
+                onMemoryWrite(0, offset + size - CHIP_8_MEM_SIZE);
+                size = CHIP_8_MEM_SIZE - offset;
+            }
+
+            writeCount++;
+
+            size_t first = (offset > ROM_MEM_START) ? offset - 1 : ROM_MEM_START;
+            size_t last = std::min<size_t>(offset + size, CHIP_8_MEM_SIZE);
+
+            if(size != 0 && offset < CHIP_8_MEM_SIZE) {
+                for(size_t page = offset / SNAPSHOT_PAGE_SIZE; page <= (last - 1) / SNAPSHOT_PAGE_SIZE; page++)
+                    dirtyPages |= 1 << page;
+
+                writtenStart = std::min<size_t>(writtenStart, offset);
+                writtenEnd = std::max<size_t>(writtenEnd, last);
+            }
+
+            for(size_t addr = first; addr < last; addr++)
+                decodeCache[addr - ROM_MEM_START].handler = nullptr;
+
+            // Only BlockCore marks code bytes, so interpreter runs skip the second pass
+            if(codeBytes.none())
+                return;
+
+            // Let compiled blocks covering this byte know they are stale
+            // Blocks mark both bytes of every instruction, so unlike the decode cache they don't need
+            // the byte in front of the store, a store right behind a block leaves it alone
+            for(size_t addr = offset; addr < last; addr++) {
+                if(codeBytes[addr]) {
+                    dirtyCode.set(addr);
+                    codeGeneration++;
+                }
+            }
+        };
+
+        // Same loop head and no writes since the last probe, the registers decide
+        // Inline so Chip8Aot modules closing loops themselves can probe them too
+        void compareLoopProbe() {
+            LoopProbe& probe = loopProbe;
+
+            if(probe.complete && probe.I == I && probe.SP == SP &&
+               probe.delay_timer == delay_timer && probe.sound_timer == sound_timer &&
+               probe.randomState == randomState && probe.planeMask == planeMask && probe.audioPitch == audioPitch &&
+               memcmp(probe.v, v, sizeof(v)) == 0 && memcmp(probe.stack, stack, sizeof(stack)) == 0) {
+                idlePeriod = static_cast<unsigned int>(cycleCount - probe.cycle);
+                probe.cycle = cycleCount;
+                probe.countdown = probe.gap;
+
+                return;
+            }
+
+            // The first capture is compared on the very next pass, only later mismatches back off
+            if(probe.complete)
+                probe.gap = std::min<unsigned char>(probe.gap * 2, LOOP_PROBE_MAX_GAP);
+            probe.countdown = probe.gap;
+            probe.cycle = cycleCount;
+            probe.complete = true;
+            memcpy(probe.v, v, sizeof(v));
+            memcpy(probe.stack, stack, sizeof(stack));
+            probe.I = I;
+            probe.SP = SP;
+            probe.delay_timer = delay_timer;
+            probe.sound_timer = sound_timer;
+            probe.randomState = randomState;
+            probe.planeMask = planeMask;
+            probe.audioPitch = audioPitch;
+
+            return;
+        };
+
+        // Range of memory stored to since the last call, start == end if nothing was
+        void takeWrittenRange(unsigned short& start, unsigned short& end) {
+            start = (writtenStart < writtenEnd) ? writtenStart : 0;
+            end = (writtenStart < writtenEnd) ? writtenEnd : 0;
+
+            writtenStart = CHIP_8_MEM_SIZE;
+            writtenEnd = 0;
+
+            return;
+        };
+
+        // Anything a loop could change that the loop probe doesn't compare goes through here
+        void markDisplayWrite() {
+            displayDirty = true;
+            writeCount++;
+
+            return;
+        };
+
+        // SplitMix64, any seed (including 0) gives a full period
+        unsigned char nextRandom() {
+            unsigned long long z = (randomState += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+            return static_cast<unsigned char>((z ^ (z >> 31)) >> 56);
+        };
+
         Opcodes opcodes;
-        unsigned char memory[CHIP_8_MEM_SIZE];
-        unsigned char v[REGISTER_COUNT];
-        unsigned short stack[STACK_SIZE];
+        QuirkProfile quirkProfile {QuirkProfile::Default};
+        unsigned char memory[CHIP_8_MEM_SIZE] {};
+        unsigned char v[REGISTER_COUNT] {};
+        unsigned short stack[STACK_SIZE] {};
 
         unsigned short PC {ROM_MEM_START}; // Have PC start on ROM
         unsigned char SP {};
@@ -172,9 +554,63 @@ class Chip8 {
         unsigned short delay_timer {};
         unsigned short sound_timer {};
 
-        unsigned char key_pressed {};
+        std::atomic<unsigned short> keyMask {};
+        unsigned long long randomState {DEFAULT_RANDOM_SEED};
+        unsigned long long cycleCount {};
+
+        pixels::PackedBuffer pixels {};
+        bool hires {};
+        unsigned char planeMask {1};    // Bit n set if drawing touches plane n
+        bool displayDirty {true};
 
-        pixels::PixelBuffer pixels {};
+        unsigned char audioPattern[AUDIO_PATTERN_SIZE] {
+            0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,     // 500 Hz square wave at the default pitch
+            0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0
+        };
+        unsigned char audioPitch {DEFAULT_AUDIO_PITCH};
+        bool beeping {};
+
+        // FX0A: keys held when the wait began only count once released, the latched key completes on release
+        bool keyWaiting {};
+        unsigned short keyWaitIgnored {};
+        unsigned char keyWaitKey {KEY_WAIT_NONE};
+
+        // Machine state as of the last backward jump, see probeLoop
+        typedef struct {
+            unsigned short head {LOOP_PROBE_NONE};
+            unsigned long long cycle {};
+            unsigned long long writes {};
+            bool complete {};   // Registers below were captured too
+            unsigned char gap {};       // Loop closes between compares, doubles every mismatch
+            unsigned char countdown {};
+            unsigned char v[REGISTER_COUNT] {};
+            unsigned short stack[STACK_SIZE] {};
+            unsigned short I {};
+            unsigned char SP {};
+            unsigned short delay_timer {};
+            unsigned short sound_timer {};
+            unsigned long long randomState {};
+            unsigned char planeMask {};
+            unsigned char audioPitch {};
+        }LoopProbe;
+
+        LoopProbe loopProbe {};
+        unsigned long long writeCount {};   // Memory, display and audio pattern writes
+        unsigned short writtenStart {CHIP_8_MEM_SIZE};  // Only WideEngine reads these
+        unsigned short writtenEnd {};
+        unsigned int idlePeriod {};         // Cycles per idle iteration, 0 while doing real work
+
+        // One predecoded entry per ROM address, filled lazily on first execution
+        std::array<Opcodes::Instruction, ROM_MEM_SIZE> decodeCache {};
+
+        // Bytes owned by BlockCore blocks, and the ones written since it last looked
+        std::bitset<CHIP_8_MEM_SIZE> codeBytes {};
+        std::bitset<CHIP_8_MEM_SIZE> dirtyCode {};
+        unsigned int codeGeneration {};
+
+        // Pages as of the last snapshot/restore, plus which pages were written since
+        std::array<std::shared_ptr<const MemoryPage>, SNAPSHOT_PAGE_COUNT> basePages {};
+        unsigned short dirtyPages {};
 };
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef CPU_CORE_H
+#define CPU_CORE_H
+
+#include "chip8.h"
+#include "debugger.h"
+
+// Same abstract class approach as RomManager so engines can be picked at startup
+class CpuCore {
+    public:
+        CpuCore() {};
+        virtual ~CpuCore() {};
+
+        // Runs exactly cycleBudget instructions unless the machine stops early
+        // Idle iterations (FX0A, 00FD, loops that changed nothing) are counted but not run
+        // Returns how many instructions were executed
+        virtual unsigned int run(Chip8& chip8, unsigned int cycleBudget) = 0;
+};
+
+// Plain fetch/decode/execute through Chip8's predecode cache
+class InterpreterCore : public CpuCore {
+    public:
+        InterpreterCore() {};
+        ~InterpreterCore() {};
+
+        unsigned int run(Chip8& chip8, unsigned int cycleBudget) {
+            if(Debugger::isArmed())
+                return Debugger::getActive()->runSlice(chip8, cycleBudget);
+
+            chip8.beginSlice();
+
+            for(unsigned int cycle = 0; cycle < cycleBudget; cycle++) {
+                chip8.readNextInstruction();
+
+                if(chip8.isIdle())
+                    cycle += chip8.skipIdleCycles(cycleBudget - cycle - 1);
+            }
+
+            return cycleBudget;
+        };
+};
+
+#endif
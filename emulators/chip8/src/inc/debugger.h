@@ -0,0 +1,151 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+
+// Per address attribute bits
+#define DEBUG_BREAK             0x01    // Stop before the instruction at this address runs
+#define DEBUG_WATCH_READ        0x02    // Stop before an instruction reads this byte through I
+#define DEBUG_WATCH_WRITE       0x04    // Stop before an instruction stores to this byte
+
+#define DEBUG_MAX_LINE          256
+#define DEBUG_STOPPED_POLL_MS   16      // How often a stopped emulation thread calls the stopped callback
+
+// Breakpoints, watchpoints and register conditions, driven over a local socket
+// Cores only look at isArmed() once per slice. While nothing is set it stays false and they run
+// exactly as they would without a debugger. Once armed they hand the slice to runSlice, which
+// checks a 4 KB attribute bitmap before every instruction and stops the emulation thread in place
+//
+// The protocol is one text command per line, every command gets one "ok ..." or "error ..." line
+// back. "stopped ..." lines arrive on their own whenever the machine stops
+//   break ADDR [COND]          delete ADDR
+//   watch r|w|rw ADDR [LEN]    unwatch ADDR [LEN]
+//   when COND                  clear               (conditions checked before every instruction)
+//   pause    continue    step [N]    regs    mem ADDR LEN    list    detach
+// COND is a register (V0-VF, I, PC, SP, DT, ST), a comparison (== != < <= > >=) and a number
+class Debugger {
+    public:
+        Debugger() {};
+        ~Debugger();
+
+        Debugger(const Debugger&) = delete;
+        Debugger& operator=(const Debugger&) = delete;
+
+        // Serves one client at a time on a Unix domain socket, -1 if it couldn't be opened
+        char listen(const char* path);
+
+        // Runs the slice one instruction at a time, blocking whenever the machine stops
+        unsigned int runSlice(Chip8& chip8, unsigned int cycleBudget) {
+            return runSlice(chip8, cycleBudget, [](Chip8& machine) { machine.readNextInstruction(); });
+        };
+
+        // Same, with step running each instruction so TraceCore can record it
+        // Ends the slice early if the stopped callback gave up a stop
+        template<typename Step>
+        unsigned int runSlice(Chip8& chip8, unsigned int cycleBudget, Step step) {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            // No idle skipping here, every iteration of a loop has to pass the checks
+            chip8.beginSlice();
+
+            for(unsigned int cycle = 0; cycle < cycleBudget; cycle++) {
+                if(waitWhileStopped(chip8, lock))
+                    return cycle;
+
+                step(chip8);
+            }
+
+            return cycleBudget;
+        };
+
+        // Called on the emulation thread every DEBUG_STOPPED_POLL_MS while the machine is stopped,
+        // a frontend pumps its window events here. Returning false resumes and ends the slice
+        void setStoppedCallback(std::function<bool()> callback) {
+            stoppedCallback = std::move(callback);
+
+            return;
+        };
+
+        static bool isArmed() {
+            return armed.load(std::memory_order_relaxed);
+        };
+
+        static Debugger* getActive() {
+            return active;
+        };
+
+    private:
+        enum class ConditionTarget {
+            Register,   // V0-VF, index is the register
+            Index,
+            ProgramCounter,
+            StackPointer,
+            DelayTimer,
+            SoundTimer
+        };
+
+        enum class ConditionCompare {
+            Equal,
+            NotEqual,
+            Less,
+            LessEqual,
+            Greater,
+            GreaterEqual
+        };
+
+        typedef struct {
+            ConditionTarget target;
+            unsigned char index;
+            ConditionCompare compare;
+            unsigned int value;
+            std::string text;
+        }Condition;
+
+        char waitWhileStopped(Chip8& chip8, std::unique_lock<std::mutex>& lock);
+        void serve();
+        std::string execute(const char* line);
+        void send(const std::string& line);
+        void updateArmed();
+        void resume(unsigned long long steps);
+
+        std::string findStopReason(const Chip8& chip8);
+        std::string describeRegisters(const Chip8& chip8) const;
+
+        static void findAccess(const Chip8& chip8, unsigned short opcode, unsigned int& reads, unsigned int& writes);
+        static char parseCondition(const char* text, Condition& condition);
+        static bool testCondition(const Chip8& chip8, const Condition& condition);
+
+        // One Debugger per process, the cores find it through here
+        static inline std::atomic<bool> armed {};
+        static inline Debugger* active {};
+
+        std::mutex mutex {};                    // Held by the emulation thread for a whole armed slice
+        std::condition_variable resumed {};
+        std::mutex sendMutex {};
+
+        std::array<unsigned char, CHIP_8_MEM_SIZE> attributes {};
+        std::map<unsigned short, Condition> breakConditions {};     // Breakpoints that only stop if this holds
+        std::vector<Condition> conditions {};
+
+        Chip8* stoppedMachine {};               // Set while the emulation thread is parked in runSlice
+        std::function<bool()> stoppedCallback {};
+        bool pauseRequested {};
+        unsigned long long stepsRemaining {};   // 0 when not stepping
+
+        std::thread server {};
+        std::atomic<bool> stopping {};
+        int listenSocket {-1};
+        int clientSocket {-1};
+        std::string socketPath {};
+};
+
+#endif
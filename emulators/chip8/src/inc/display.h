@@ -4,24 +4,16 @@
 #include <SDL2/SDL.h>
 #include <array>
 #include <iostream>
-
-#define SDL_ERROR_COUT(message) std::cout << message << " Error: " << SDL_GetError() << std::endl
-
-namespace pixels {
-    constexpr int DISPLAY_WIDTH = 64;
-    constexpr int DISPLAY_HEIGHT = 32;
-    constexpr int WHITE_PIXEL = 0xFFFFFFFF;
-    constexpr int BLACK_PIXEL = 0xFF000000;
-
-    using Pixel = uint32_t;
-    using PixelRow = std::array<Pixel, DISPLAY_WIDTH>;
-    using PixelBuffer = std::array<PixelRow, DISPLAY_HEIGHT>;
-}
+#include "pixel_expand.h"
+#include "pixels.h"
+#include "sdl_error.h"
 
 // TODO: Find a way to make this a singleton
 class Display {
     public:
-        Display() {
+        // scale > 1 upscales on the CPU into a bigger texture (nearest neighbour, no GPU filtering)
+        // vsync caps presents to the refresh rate, turbo runs turn it off so presenting never stalls the CPU
+        explicit Display(int scale = 1, bool vsync = true) : textureScale(scale) {
             int error;
             
             // TODO: Handle errors
@@ -37,17 +29,13 @@ class Display {
                 SDL_ERROR_COUT("Window could not be created!");
             }
 
-            emulatorRenderer = SDL_CreateRenderer(emulatorWindow, -1, SDL_RENDERER_ACCELERATED);
+            emulatorRenderer = SDL_CreateRenderer(emulatorWindow, -1,
+                                                SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
             if(emulatorRenderer == NULL) {
                 SDL_ERROR_COUT("Renderer could not be created!");
             }
 
-            emulatorTexture = SDL_CreateTexture(emulatorRenderer, SDL_PIXELFORMAT_ABGR8888,
-                                                SDL_TEXTUREACCESS_STREAMING,
-                                                pixels::DISPLAY_WIDTH, pixels::DISPLAY_HEIGHT);
-            if(emulatorTexture == NULL) {
-                SDL_ERROR_COUT("Texture could not be created!");
-            }
+            createTexture(false);
 
             SDL_SetWindowFullscreen(emulatorWindow, SDL_WINDOW_FULLSCREEN_DESKTOP);
         };
@@ -64,9 +52,29 @@ class Display {
             SDL_Quit();
         };
 
-        void renderDisplay(const pixels::PixelBuffer& pixels) {
-            SDL_UpdateTexture(emulatorTexture, NULL, &pixels, pixels::DISPLAY_WIDTH * sizeof(uint32_t));
-            
+        // Only re-uploads when a draw or clear happened since the last call
+        // The texture follows the machine's resolution and is only recreated when that changes
+        void renderDisplay(const pixels::PackedBuffer& packedPixels, bool hires, bool dirty = true) {
+            if(hires != textureHires || emulatorTexture == NULL) {
+                if(createTexture(hires))
+                    return;
+                dirty = true;
+            }
+
+            if(dirty) {
+                void* texturePixels {};
+                int pitch {};
+
+                // ARGB only exists here, the machine keeps one bit per pixel
+                if(SDL_LockTexture(emulatorTexture, NULL, &texturePixels, &pitch) != 0) {
+                    SDL_ERROR_COUT("SDL_LockTexture failed!");
+                    return;
+                }
+
+                pixels::expandPackedRows(packedPixels, hires, texturePixels, pitch, textureScale);
+                SDL_UnlockTexture(emulatorTexture);
+            }
+
             if (SDL_RenderClear(emulatorRenderer) != 0)
             {
                 SDL_ERROR_COUT("SDL_RenderClear failed!");
@@ -84,16 +92,15 @@ class Display {
             return;
         };
 
-        char keyPress(const char key) const {
-            const uint8* keys_press {};
-
-            keys_pressed = SDL_GetKeyboardState(NULL);
-            return keys_pressed[keys[key]]; // Maps 0-15 to SDL scancodes
+        // All 16 keys at once, bit n set if key n is held
+        // Kept up to date from key events while polling, the keyboard itself is never queried
+        unsigned short keyMask() const {
+            return pressedKeys;
         };
 
         char closeDisplayCheck() {
             while (SDL_PollEvent(&event)) {
-                if (event.type == SDL_QUIT) {
+                if (handleEvent()) {
                     return 0;   // Close Window
                 }
             }
@@ -101,9 +108,55 @@ class Display {
             return 1;   // Keep Window open
         };
 
+        // Sleeps on the event queue for up to timeoutMs, used while FX0A has the machine parked
+        char waitForInput(int timeoutMs) {
+            if (SDL_WaitEventTimeout(&event, timeoutMs) && handleEvent()) {
+                return 0;   // Close Window
+            }
+
+            return closeDisplayCheck();
+        };
+
     private:
+        // True when the window was closed
+        bool handleEvent() {
+            if (event.type == SDL_QUIT)
+                return true;
+
+            if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+                for(unsigned char key = 0; key < 16; key++) {
+                    if(keys[key] != event.key.keysym.scancode)
+                        continue;
+
+                    if(event.type == SDL_KEYDOWN)
+                        pressedKeys |= 1 << key;
+                    else
+                        pressedKeys &= ~(1 << key);
+                }
+            }
+
+            return false;
+        };
+
+        char createTexture(bool hires) {
+            if(emulatorTexture != NULL)
+                SDL_DestroyTexture(emulatorTexture);
+
+            emulatorTexture = SDL_CreateTexture(emulatorRenderer, SDL_PIXELFORMAT_ABGR8888,
+                                                SDL_TEXTUREACCESS_STREAMING,
+                                                pixels::getWidth(hires) * textureScale,
+                                                pixels::getHeight(hires) * textureScale);
+            textureHires = hires;
+            if(emulatorTexture == NULL) {
+                SDL_ERROR_COUT("Texture could not be created!");
+                return -1;
+            }
+
+            return 0;
+        };
+
         // TODO: Maybe not the best way to store them?
-        const char keys[] = {
+        static constexpr SDL_Scancode keys[] = {
             SDL_SCANCODE_1,
             SDL_SCANCODE_2,
             SDL_SCANCODE_3,
@@ -126,6 +179,10 @@ class Display {
         SDL_Renderer* emulatorRenderer {};
         SDL_Texture* emulatorTexture {};
         SDL_Event event {};
+        unsigned short pressedKeys {};
+
+        int textureScale {1};
+        bool textureHires {};
 };
 
 #endif
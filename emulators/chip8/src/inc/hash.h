@@ -0,0 +1,22 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+
+#define FNV_OFFSET_BASIS    0xCBF29CE484222325ULL
+#define FNV_PRIME           0x100000001B3ULL
+
+// FNV-1a, used for state hashes and ROM identity. Not meant to be cryptographic
+// Pass the previous result as hash to keep hashing more data into it
+inline unsigned long long fnv1aHash(const void* data, size_t size, unsigned long long hash = FNV_OFFSET_BASIS) {
+    const unsigned char* byteData = static_cast<const unsigned char*>(data);
+
+    for(size_t index = 0; index < size; index++) {
+        hash ^= byteData[index];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string_view>
+#include <vector>
+#include "chip8.h"
+#include "cpu_core.h"
+
+#define JOURNAL_NO_EVENT    ~0ULL
+
+// Key mask change, applied before the instruction at that cycle runs
+typedef struct {
+    unsigned long long cycle;
+    unsigned short keyMask;
+}InputEvent;
+
+// Everything needed to rerun a session bit for bit: the seed, the input deltas and
+// one register/display hash per frame to check the rerun against
+class InputJournal {
+    public:
+        InputJournal() {};
+        ~InputJournal() {};
+
+        // Call once the ROM is loaded and the machine seeded
+        void begin(const Chip8& chip8, unsigned long long seed, unsigned int cyclesPerFrame) {
+            this->seed = seed;
+            this->cyclesPerFrame = cyclesPerFrame;
+            quirkProfile = chip8.getQuirkProfile();
+            initialHash = chip8.getStateHash();
+            events.clear();
+            frameHashes.clear();
+            lastMask = chip8.getKeyMask();
+
+            return;
+        };
+
+        // Only changes are stored, holding a key for a minute costs one entry
+        void recordInput(unsigned long long cycle, unsigned short keyMask) {
+            if(keyMask == lastMask)
+                return;
+
+            events.push_back({cycle, keyMask});
+            lastMask = keyMask;
+
+            return;
+        };
+
+        void recordFrame(const Chip8& chip8) {
+            frameHashes.push_back(chip8.getFrameHash());
+            return;
+        };
+
+        // Binary format: header, varint cycle deltas with 16 bit masks, then 64 bit frame hashes
+        char save(std::string_view filename) const;
+        static char load(std::string_view filename, InputJournal& journal);
+
+        unsigned long long getSeed() const { return seed; };
+        unsigned int getCyclesPerFrame() const { return cyclesPerFrame; };
+        QuirkProfile getQuirkProfile() const { return quirkProfile; };
+        unsigned long long getInitialHash() const { return initialHash; };
+        const std::vector<InputEvent>& getEvents() const { return events; };
+        const std::vector<unsigned long long>& getFrameHashes() const { return frameHashes; };
+
+    private:
+        unsigned long long seed {};
+        unsigned int cyclesPerFrame {};
+        QuirkProfile quirkProfile {};
+        unsigned long long initialHash {};
+        unsigned short lastMask {};
+
+        std::vector<InputEvent> events {};
+        std::vector<unsigned long long> frameHashes {};
+};
+
+// Feeds a journal back into a machine, splitting CPU slices at input events so a key
+// lands on exactly the instruction it did when recorded
+class JournalPlayer {
+    public:
+        JournalPlayer(const InputJournal& journal) : journal(journal) {};
+        ~JournalPlayer() {};
+
+        // Same frame structure as FrameScheduler::runFrame
+        unsigned int runFrame(Chip8& chip8, CpuCore& cpuCore) {
+            unsigned int executed {};
+            unsigned int cyclesPerFrame = journal.getCyclesPerFrame();
+
+            while(executed < cyclesPerFrame) {
+                applyDue(chip8);
+
+                unsigned long long slice = cyclesPerFrame - executed;
+                unsigned long long next = nextEventCycle();
+                if(next != JOURNAL_NO_EVENT)
+                    slice = std::min(slice, next - chip8.getCycleCount());
+
+                executed += cpuCore.run(chip8, static_cast<unsigned int>(slice));
+            }
+
+            chip8.tickTimers();
+            frame++;
+
+            return executed;
+        };
+
+        // Compares the machine against the hash recorded for the frame just run
+        bool frameMatches(const Chip8& chip8) const {
+            const std::vector<unsigned long long>& hashes = journal.getFrameHashes();
+            return frame == 0 || frame > hashes.size() || hashes[frame - 1] == chip8.getFrameHash();
+        };
+
+        bool finished() const {
+            return frame >= journal.getFrameHashes().size() && nextEvent >= journal.getEvents().size();
+        };
+
+        unsigned long long getFrame() const { return frame; };
+
+    private:
+        void applyDue(Chip8& chip8) {
+            const std::vector<InputEvent>& events = journal.getEvents();
+
+            while(nextEvent < events.size() && events[nextEvent].cycle <= chip8.getCycleCount())
+                chip8.setKeyMask(events[nextEvent++].keyMask);
+
+            return;
+        };
+
+        unsigned long long nextEventCycle() const {
+            const std::vector<InputEvent>& events = journal.getEvents();
+            return nextEvent < events.size() ? events[nextEvent].cycle : JOURNAL_NO_EVENT;
+        };
+
+        const InputJournal& journal;
+        size_t nextEvent {};
+        unsigned long long frame {};
+};
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include "spsc_ring.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define LOG_LEVEL_TRACE     0
+#define LOG_LEVEL_DEBUG     1
+#define LOG_LEVEL_INFO      2
+#define LOG_LEVEL_WARN      3
+#define LOG_LEVEL_ERROR     4
+#define LOG_LEVEL_OFF       5
+
+// Records below this level are compiled out, their arguments are never evaluated
+// Set with -DCHIP8_LOG_LEVEL=TRACE|DEBUG|INFO|WARN|ERROR|OFF
+#ifndef CHIP8_LOG_LEVEL
+#define CHIP8_LOG_LEVEL     LOG_LEVEL_INFO
+#endif
+
+#define LOG_MAX_ARGS        6
+#define LOG_TEXT_SIZE       48      // Copied string arguments share this, longer ones are cut short
+#define LOG_RING_RECORDS    4096    // Per thread
+
+#define LOG_AT(level, ...)  do { if constexpr((level) >= CHIP8_LOG_LEVEL) logger::write((level), __VA_ARGS__); } while(0)
+#define LOG_TRACE(...)      LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...)      LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)       LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...)       LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...)      LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// printf style logging that never formats or does IO on the calling thread
+// A call packs its format pointer and raw arguments into a fixed size record and pushes it
+// into the thread's own lock-free ring, a background thread formats and writes them out
+// A full ring drops the record instead of waiting, so logging can't change emulation timing
+namespace logger {
+    enum class ArgType : unsigned char {
+        Signed,
+        Unsigned,
+        Double,
+        String,     // Copied into the record's text, value is the offset
+        Pointer
+    };
+
+    typedef union {
+        long long i;
+        unsigned long long u;
+        double d;
+        const void* p;
+    }Arg;
+
+    // Formats are only queued as pointers, so they must be string literals
+    typedef struct {
+        const char* format;
+        long long timestamp;    // readClock ticks
+        unsigned char level;
+        unsigned char argCount;
+        unsigned char textUsed;
+        ArgType types[LOG_MAX_ARGS];
+        Arg args[LOG_MAX_ARGS];
+        char text[LOG_TEXT_SIZE];
+    }Record;
+
+    typedef struct {
+        SpscRing<Record, LOG_RING_RECORDS> records;
+        std::atomic<unsigned long long> dropped;
+        std::atomic<bool> retired;      // Owning thread exited, goes away once drained
+        unsigned int thread;
+        unsigned long long reportedDrops;   // Writer thread only
+    }ThreadRing;
+
+    // Hands a thread its ring on first use and retires it when the thread exits
+    class ThreadLog {
+        public:
+            ThreadLog();
+            ~ThreadLog();
+
+            ThreadLog(const ThreadLog&) = delete;
+            ThreadLog& operator=(const ThreadLog&) = delete;
+
+            std::shared_ptr<ThreadRing> ring {};
+    };
+
+    // Function local so only code that actually logs carries the thread_local and its init
+    inline ThreadLog& getThreadLog() {
+        static thread_local ThreadLog threadLog {};
+        return threadLog;
+    }
+
+    // The TSC where there is one, a clock call would cost more than the rest of the record
+    // The writer thread works out how fast it ticks
+    inline long long readClock() {
+#if defined(__x86_64__) || defined(__i386__)
+        return static_cast<long long>(__rdtsc());
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    inline void encodeArg(Record& record, unsigned char index, const char* value) {
+        record.types[index] = ArgType::String;
+
+        // Text is full, the last string's terminator doubles as an empty string
+        if(record.textUsed >= LOG_TEXT_SIZE) {
+            record.args[index].u = LOG_TEXT_SIZE - 1;
+            return;
+        }
+
+        size_t length {};
+        while(value[length] != '\0' && record.textUsed + length + 1 < LOG_TEXT_SIZE)
+            length++;
+
+        record.args[index].u = record.textUsed;
+        std::char_traits<char>::copy(record.text + record.textUsed, value, length);
+        record.textUsed += length;
+        record.text[record.textUsed++] = '\0';
+
+        return;
+    }
+
+    inline void encodeArg(Record& record, unsigned char index, const std::string& value) {
+        encodeArg(record, index, value.c_str());
+        return;
+    }
+
+    template<typename T>
+    inline void encodeArg(Record& record, unsigned char index, T value) {
+        if constexpr(std::is_same_v<T, char*>) {
+            encodeArg(record, index, static_cast<const char*>(value));
+        }
+        else if constexpr(std::is_enum_v<T>) {
+            encodeArg(record, index, static_cast<std::underlying_type_t<T>>(value));
+        }
+        else if constexpr(std::is_floating_point_v<T>) {
+            record.types[index] = ArgType::Double;
+            record.args[index].d = value;
+        }
+        else if constexpr(std::is_pointer_v<T>) {
+            record.types[index] = ArgType::Pointer;
+            record.args[index].p = value;
+        }
+        else if constexpr(std::is_signed_v<T>) {
+            record.types[index] = ArgType::Signed;
+            record.args[index].i = value;
+        }
+        else {
+            static_assert(std::is_integral_v<T>, "Unsupported log argument");
+            record.types[index] = ArgType::Unsigned;
+            record.args[index].u = value;
+        }
+
+        return;
+    }
+
+    template<typename... Args>
+    inline void write(unsigned char level, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+
+        // First use registers the ring, do it before taking the timestamp
+        ThreadRing& ring = *getThreadLog().ring;
+
+        Record record;
+        record.format = format;
+        record.timestamp = readClock();
+        record.level = level;
+        record.argCount = sizeof...(Args);
+        record.textUsed = 0;
+
+        unsigned char index {};
+        (encodeArg(record, index++, args), ...);
+
+        if(ring.records.push(&record, 1) == 0)
+            ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        return;
+    }
+
+    // Sends records to a file instead of stderr, returns -1 if it can't be opened
+    char setOutput(const char* path);
+
+    // Blocks until everything logged before the call has been written
+    void flush();
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <cstddef>
+#include <vector>
+
+#define LZ_MIN_MATCH        4
+#define LZ_MAX_OFFSET       0xFFFF
+#define LZ_HASH_BITS        12
+
+// LZ4 style block compression, no external dependency and no framing
+// Sequences are a token (literal length << 4 | match length - 4), the literals, a 16 bit
+// offset and the match. Either length of 15 continues in 255 byte steps. The last sequence
+// is literals only
+// Traces are mostly the same handful of records repeating, this gets them to a fraction
+// at memcpy-like speeds
+
+// Appends the compressed form of data to output
+void lzCompress(const unsigned char* data, size_t size, std::vector<unsigned char>& output);
+
+// Decodes exactly size bytes into output, -1 if data is malformed or doesn't produce size bytes
+char lzDecompress(const unsigned char* data, size_t dataSize, unsigned char* output, size_t size);
+
+#endif
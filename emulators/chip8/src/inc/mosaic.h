@@ -0,0 +1,211 @@
+#ifndef MOSAIC_H
+#define MOSAIC_H
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "pixel_expand.h"
+#include "pixels.h"
+#include "sdl_error.h"
+
+// Many machines in one window: every machine gets a tile of a single streaming texture atlas
+// Tiles are expanded on the CPU into a shadow copy of the atlas, then present() uploads the
+// span of changed tiles in each grid row, at most one SDL_UpdateTexture per row, and draws the
+// whole grid with one SDL_RenderCopy, so the SDL calls per frame grow with the rows, not the machines
+class MosaicDisplay {
+    public:
+        // Tiles are always high resolution sized, low resolution screens are drawn at twice the scale
+        static constexpr int TILE_WIDTH = pixels::HIRES_WIDTH;
+        static constexpr int TILE_HEIGHT = pixels::HIRES_HEIGHT;
+
+        explicit MosaicDisplay(unsigned int tileCount, int scale = 1, bool vsync = true)
+            : tileCount(std::max(1U, tileCount)), tileScale(std::max(1, scale)) {
+            // As square as possible, wide tiles already make the grid wider than it is tall
+            columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(this->tileCount))));
+            rows = static_cast<int>((this->tileCount + columns - 1) / columns);
+            atlasWidth = columns * TILE_WIDTH * tileScale;
+            atlasHeight = rows * TILE_HEIGHT * tileScale;
+
+            atlas.assign(static_cast<size_t>(atlasWidth) * atlasHeight, static_cast<pixels::Pixel>(pixels::BLACK_PIXEL));
+            tileDirty = std::make_unique<std::atomic<bool>[]>(this->tileCount);
+            tileHires = std::make_unique<bool[]>(this->tileCount);
+
+            if(SDL_Init(SDL_INIT_VIDEO) < 0) {
+                SDL_ERROR_COUT("SDL_Init has failed!");
+            }
+
+            mosaicWindow = SDL_CreateWindow("Chipacabra Mosaic", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                            atlasWidth, atlasHeight, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+            if(mosaicWindow == NULL) {
+                SDL_ERROR_COUT("Window could not be created!");
+            }
+
+            mosaicRenderer = SDL_CreateRenderer(mosaicWindow, -1,
+                                                SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
+            if(mosaicRenderer == NULL) {
+                SDL_ERROR_COUT("Renderer could not be created!");
+            }
+
+            // Keeps the grid's aspect when the window is resized, the renderer letterboxes the rest
+            SDL_RenderSetLogicalSize(mosaicRenderer, atlasWidth, atlasHeight);
+
+            atlasTexture = SDL_CreateTexture(mosaicRenderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING,
+                                             atlasWidth, atlasHeight);
+            if(atlasTexture == NULL) {
+                SDL_ERROR_COUT("Atlas texture could not be created!");
+            }
+
+            // Nothing has been uploaded yet, the first present sends the whole atlas
+            for(unsigned int tile = 0; tile < this->tileCount; tile++)
+                tileDirty[tile] = true;
+        };
+        ~MosaicDisplay() {
+            SDL_DestroyTexture(atlasTexture);
+            atlasTexture = NULL;
+
+            SDL_DestroyRenderer(mosaicRenderer);
+            mosaicRenderer = NULL;
+
+            SDL_DestroyWindow(mosaicWindow);
+            mosaicWindow = NULL;
+
+            SDL_Quit();
+        };
+
+        MosaicDisplay(const MosaicDisplay&) = delete;
+        MosaicDisplay& operator=(const MosaicDisplay&) = delete;
+
+        // Expands one machine's screen into its tile of the shadow atlas, nothing touches SDL here
+        // Different tiles may be updated from different threads at the same time
+        void updateTile(unsigned int tile, const pixels::PackedBuffer& packedPixels, bool hires, bool dirty) {
+            if(tile >= tileCount)
+                return;
+
+            if(hires != tileHires[tile]) {
+                tileHires[tile] = hires;
+                dirty = true;
+            }
+
+            if(!dirty)
+                return;
+
+            const int tileX = static_cast<int>(tile % columns) * TILE_WIDTH * tileScale;
+            const int tileY = static_cast<int>(tile / columns) * TILE_HEIGHT * tileScale;
+            pixels::Pixel* destination = atlas.data() + static_cast<size_t>(tileY) * atlasWidth + tileX;
+
+            pixels::expandPackedRows(packedPixels, hires, destination, atlasWidth * sizeof(pixels::Pixel),
+                                     hires ? tileScale : tileScale * 2);
+            tileDirty[tile].store(true, std::memory_order_release);
+
+            return;
+        };
+
+        // At most one upload per grid row, spanning its first to last dirty tile, then one copy for
+        // the whole grid. The shadow atlas holds every tile, so clean ones inside a span just resend
+        void present() {
+            uploadedTiles = 0;
+
+            for(int row = 0; row < rows; row++) {
+                int first = columns, last = -1;
+
+                for(int column = 0; column < columns; column++) {
+                    if(!takeTileDirty(row * columns + column))
+                        continue;
+
+                    first = std::min(first, column);
+                    last = column;
+                }
+
+                if(last >= 0 && uploadTiles(row, first, last - first + 1))
+                    return;
+            }
+
+            if (SDL_RenderClear(mosaicRenderer) != 0)
+            {
+                SDL_ERROR_COUT("SDL_RenderClear failed!");
+                return;
+            }
+
+            if (SDL_RenderCopy(mosaicRenderer, atlasTexture, NULL, NULL) != 0)
+            {
+                SDL_ERROR_COUT("SDL_RenderCopy failed!");
+                return;
+            }
+
+            SDL_RenderPresent(mosaicRenderer);
+
+            return;
+        };
+
+        char closeDisplayCheck() {
+            while (SDL_PollEvent(&event)) {
+                if (event.type == SDL_QUIT) {
+                    return 0;   // Close Window
+                }
+            }
+
+            return 1;   // Keep Window open
+        };
+
+        unsigned int getColumns() const {
+            return columns;
+        };
+
+        unsigned int getRows() const {
+            return rows;
+        };
+
+        // Tiles the last present() uploaded, clean ones inside a row's span included
+        unsigned int getUploadedTiles() const {
+            return uploadedTiles;
+        };
+
+    private:
+        bool takeTileDirty(int tile) {
+            if(static_cast<unsigned int>(tile) >= tileCount)
+                return false;
+
+            return tileDirty[tile].exchange(false, std::memory_order_acquire);
+        };
+
+        // Sends count tiles of one grid row starting at column, the texture keeps every other tile as it was
+        char uploadTiles(int row, int column, int count) {
+            SDL_Rect box {
+                column * TILE_WIDTH * tileScale,
+                row * TILE_HEIGHT * tileScale,
+                count * TILE_WIDTH * tileScale,
+                TILE_HEIGHT * tileScale
+            };
+            const pixels::Pixel* source = atlas.data() + static_cast<size_t>(box.y) * atlasWidth + box.x;
+
+            if(SDL_UpdateTexture(atlasTexture, &box, source, atlasWidth * sizeof(pixels::Pixel)) != 0) {
+                SDL_ERROR_COUT("SDL_UpdateTexture failed!");
+                return -1;
+            }
+            uploadedTiles += count;
+
+            return 0;
+        };
+
+        SDL_Window* mosaicWindow {};
+        SDL_Renderer* mosaicRenderer {};
+        SDL_Texture* atlasTexture {};
+        SDL_Event event {};
+
+        unsigned int tileCount {};
+        int tileScale {1};
+        int columns {1};
+        int rows {1};
+        int atlasWidth {};
+        int atlasHeight {};
+        unsigned int uploadedTiles {};
+
+        std::vector<pixels::Pixel> atlas {};                // CPU side copy of the texture, row pitch atlasWidth
+        std::unique_ptr<std::atomic<bool>[]> tileDirty {};  // Set by updateTile, cleared by present
+        std::unique_ptr<bool[]> tileHires {};               // Only touched by the tile's own updater
+};
+
+#endif
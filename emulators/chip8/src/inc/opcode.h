@@ -2,23 +2,33 @@
 #define OPCODE_H
 
 #include <array>
-#include "display.h"
+#include "pixels.h"
+#include "quirks.h"
 
 // Macros
 #define GET_OPCODE(highByte, lowByte)   ((highByte << 8) | lowByte)
 
-#define OPCODE_COUNT        35
+#define OPCODE_COUNT        49
 
 // Are defines more efficient for calling in embedded systems?
 // Opcode Masks
+#define OP_SCROLL_DOWN_MASK                 0x00C0
+#define OP_SCROLL_UP_MASK                   0x00D0
 #define OP_CLEAR_SCREEN_MASK                0x00E0
 #define OP_RETURN_FROM_SUB_MASK             0x00EE
+#define OP_SCROLL_RIGHT_MASK                0x00FB
+#define OP_SCROLL_LEFT_MASK                 0x00FC
+#define OP_EXIT_MASK                        0x00FD
+#define OP_LOW_RES_MASK                     0x00FE
+#define OP_HIGH_RES_MASK                    0x00FF
 #define OP_CALL_MCHN_CODE_MASK              0x0000
 #define OP_JUMP_ADDR_MASK                   0x1000
 #define OP_CALL_SUB_MASK                    0x2000
 #define OP_SE_VX_MASK                       0x3000
 #define OP_SNE_VX_MASK                      0x4000
 #define OP_SE_VX_VY_MASK                    0x5000
+#define OP_STORE_RANGE_MASK                 0x5002
+#define OP_LOAD_RANGE_MASK                  0x5003
 #define OP_LOAD_VX_MASK                     0x6000
 #define OP_ADD_VX_MASK                      0x7000
 #define OP_LOAD_VX_VY_MASK                  0x8000
@@ -37,30 +47,87 @@
 #define OP_DRAW_SPRITE_MASK                 0xD000
 #define OP_SE_KEY_MASK                      0xE09E
 #define OP_SNE_KEY_MASK                     0xE0A1
+#define OP_LOAD_I_LONG_MASK                 0xF000
+#define OP_SELECT_PLANES_MASK               0xF001
+#define OP_LOAD_AUDIO_PATTERN_MASK          0xF002
 #define OP_LOAD_VX_DELAY_MASK               0xF007
 #define OP_LOAD_VX_KEY_MASK                 0xF00A
 #define OP_LOAD_DELAY_TO_VX_MASK            0xF015
 #define OP_LOAD_SOUND_TO_VX_MASK            0xF018
 #define OP_LOAD_I_VX_MASK                   0xF01E
 #define OP_LOAD_I_SPRITE_ADDR_MASK          0xF029
+#define OP_LOAD_I_BIG_SPRITE_ADDR_MASK      0xF030
 #define OP_BCD_VX_MASK                      0xF033
+#define OP_LOAD_PITCH_MASK                  0xF03A
 #define OP_STORE_REGISTER_VALUES_MASK       0xF055
 #define OP_LOAD_REGISTER_VALUES_MASK        0xF065
 
 // Forward declaration used since I saw a cyclic reference in chip8.cpp
 class Chip8;
 
-// Is extern actually good code design if its a singleton?
-extern Display display;
-
 // Could've just used a switch statement but I like the cleaner/modular format
 // So tightly coupled to Chip8 class I wonder if it should be incorporated?
 class Opcodes {
     public:
+        struct Instruction;
+        typedef void(*OpcodeHandler)(const Instruction&, Chip8&);
+
+        // Opcode with its handler resolved and operands already extracted
+        struct Instruction {
+            OpcodeHandler handler;
+            unsigned short opcode;
+            unsigned short nnn;
+            unsigned char x;
+            unsigned char y;
+            unsigned char n;
+            unsigned char nn;
+        };
+
+        // Runs with the quirk profile of the machine it's given
         static void executeOpcode(unsigned short opcode, Chip8& chip8);
 
+        // The profile only picks which OpcodeCore's tables to read, handlers never look at it
+        static OpcodeHandler decodeOpcode(unsigned short opcode, QuirkProfile profile = QuirkProfile::Default);
+        static Instruction decodeInstruction(unsigned short opcode, QuirkProfile profile = QuirkProfile::Default);
+
+        // Bytes FX33/FX55/5XY2 store starting at I (wrapping past the end of memory), 0 for everything else
+        static unsigned short storeLength(unsigned short opcode, QuirkProfile profile) {
+            if((opcode & 0xF0FF) == OP_BCD_VX_MASK)
+                return 3;
+            if((opcode & 0xF0FF) == OP_STORE_REGISTER_VALUES_MASK)
+                return ((opcode >> 8) & 0xF) + 1;
+            if((opcode & 0xF00F) == OP_STORE_RANGE_MASK && getQuirks(profile).xoExtensions)
+                return rangeLength(opcode);
+
+            return 0;
+        };
+
+        // 5XY2/5XY3, the only 5 family opcodes that aren't a skip
+        static bool isRegisterRange(unsigned short opcode) {
+            return (opcode & 0xF00E) == OP_STORE_RANGE_MASK;
+        };
+
+        // Registers 5XY2/5XY3 move, Vx to Vy counting either up or down
+        static unsigned short rangeLength(unsigned short opcode) {
+            const int x = (opcode >> 8) & 0xF;
+            const int y = (opcode >> 4) & 0xF;
+
+            return static_cast<unsigned short>((x <= y ? y - x : x - y) + 1);
+        };
+};
+
+// Handlers and decode tables, instantiated once per quirk profile
+// Quirks are compile time constants in here, so variants cost nothing at runtime
+template<QuirkProfile PROFILE>
+class OpcodeCore {
+    public:
+        typedef Opcodes::Instruction Instruction;
+        typedef Opcodes::OpcodeHandler OpcodeHandler;
+
+        static OpcodeHandler decodeOpcode(unsigned short opcode);
+
     private:
-        typedef void(*OpcodeHandler)(unsigned short, Chip8&);
+        constexpr static Quirks quirks = getQuirks(PROFILE);
 
         typedef struct {
             unsigned short mask;
@@ -68,83 +135,146 @@ class Opcodes {
             OpcodeHandler opcodeHandler;
         }OpcodeMapping;
 
+        // Top nibble selects a family, (opcode & mask) indexes into its handlers
+        typedef struct {
+            const OpcodeHandler* handlers;
+            unsigned short mask;
+        }OpcodeFamily;
+
+        template<size_t N>
+        using FamilyTable = std::array<OpcodeHandler, N>;
+
         // Opcode handlers (there's a lot)
         // TODO: Should this functionality be moved to the implementation file outside of a class?
-        static void opClearScreen(unsigned short opcode, Chip8& chip8);
-        static void opReturnFromSub(unsigned short opcode, Chip8& chip8);
-        static void opCallMchnCode(unsigned short opcode, Chip8& chip8);
-        static void opJumpAddr(unsigned short opcode, Chip8& chip8);
-        static void opCallSub(unsigned short opcode, Chip8& chip8);
-        static void opSEVx(unsigned short opcode, Chip8& chip8);
-        static void opSNEVx(unsigned short opcode, Chip8& chip8);
-        static void opSEVxVy(unsigned short opcode, Chip8& chip8);
-        static void opLoadVx(unsigned short opcode, Chip8& chip8);
-        static void opAddVx(unsigned short opcode, Chip8& chip8);
-        static void opLoadVxVy(unsigned short opcode, Chip8& chip8);
-        static void opLoadORVxVy(unsigned short opcode, Chip8& chip8);
-        static void opLoadANDVxVy(unsigned short opcode, Chip8& chip8);
-        static void opLoadXORVxVy(unsigned short opcode, Chip8& chip8);
-        static void opLoadADDVxVy(unsigned short opcode, Chip8& chip8);
-        static void opLoadSUBVxVy(unsigned short opcode, Chip8& chip8);
-        static void opLoadShiftRightVx(unsigned short opcode, Chip8& chip8);
-        static void opLoadSUBVyVx(unsigned short opcode, Chip8& chip8);
-        static void opLoadShiftLeftVx(unsigned short opcode, Chip8& chip8);
-        static void opSNEVxVy(unsigned short opcode, Chip8& chip8);
-        static void opLoadI(unsigned short opcode, Chip8& chip8);
-        static void opJumpAddrV0(unsigned short opcode, Chip8& chip8);
-        static void opLoadVxRand(unsigned short opcode, Chip8& chip8);
-        static void opDrawSprite(unsigned short opcode, Chip8& chip8);
-        static void opSEKey(unsigned short opcode, Chip8& chip8);
-        static void opSNEKey(unsigned short opcode, Chip8& chip8);
-        static void opLoadVxDelay(unsigned short opcode, Chip8& chip8);
-        static void opLoadVxKey(unsigned short opcode, Chip8& chip8);
-        static void opLoadDelayToVx(unsigned short opcode, Chip8& chip8);
-        static void opLoadSoundToVx(unsigned short opcode, Chip8& chip8);
-        static void opLoadIVx(unsigned short opcode, Chip8& chip8);
-        static void opLoadISpriteAddr(unsigned short opcode, Chip8& chip8);
-        static void opLoadBCDVx(unsigned short opcode, Chip8& chip8);
-        static void opStoreRegisterValues(unsigned short opcode, Chip8& chip8);
-        static void opLoadRegisterValues(unsigned short opcode, Chip8& chip8);
+        static void opScrollDown(const Instruction& instruction, Chip8& chip8);
+        static void opScrollUp(const Instruction& instruction, Chip8& chip8);
+        static void opClearScreen(const Instruction& instruction, Chip8& chip8);
+        static void opReturnFromSub(const Instruction& instruction, Chip8& chip8);
+        static void opScrollRight(const Instruction& instruction, Chip8& chip8);
+        static void opScrollLeft(const Instruction& instruction, Chip8& chip8);
+        static void opExit(const Instruction& instruction, Chip8& chip8);
+        static void opLowRes(const Instruction& instruction, Chip8& chip8);
+        static void opHighRes(const Instruction& instruction, Chip8& chip8);
+        static void opCallMchnCode(const Instruction& instruction, Chip8& chip8);
+        static void opJumpAddr(const Instruction& instruction, Chip8& chip8);
+        static void opCallSub(const Instruction& instruction, Chip8& chip8);
+        static void opSEVx(const Instruction& instruction, Chip8& chip8);
+        static void opSNEVx(const Instruction& instruction, Chip8& chip8);
+        static void opSEVxVy(const Instruction& instruction, Chip8& chip8);
+        static void opStoreRange(const Instruction& instruction, Chip8& chip8);
+        static void opLoadRange(const Instruction& instruction, Chip8& chip8);
+        static void opLoadVx(const Instruction& instruction, Chip8& chip8);
+        static void opAddVx(const Instruction& instruction, Chip8& chip8);
+        static void opLoadVxVy(const Instruction& instruction, Chip8& chip8);
+        static void opLoadORVxVy(const Instruction& instruction, Chip8& chip8);
+        static void opLoadANDVxVy(const Instruction& instruction, Chip8& chip8);
+        static void opLoadXORVxVy(const Instruction& instruction, Chip8& chip8);
+        static void opLoadADDVxVy(const Instruction& instruction, Chip8& chip8);
+        static void opLoadSUBVxVy(const Instruction& instruction, Chip8& chip8);
+        static void opLoadShiftRightVx(const Instruction& instruction, Chip8& chip8);
+        static void opLoadSUBVyVx(const Instruction& instruction, Chip8& chip8);
+        static void opLoadShiftLeftVx(const Instruction& instruction, Chip8& chip8);
+        static void opSNEVxVy(const Instruction& instruction, Chip8& chip8);
+        static void opLoadI(const Instruction& instruction, Chip8& chip8);
+        static void opJumpAddrV0(const Instruction& instruction, Chip8& chip8);
+        static void opLoadVxRand(const Instruction& instruction, Chip8& chip8);
+        static void opDrawSprite(const Instruction& instruction, Chip8& chip8);
+        static void opSEKey(const Instruction& instruction, Chip8& chip8);
+        static void opSNEKey(const Instruction& instruction, Chip8& chip8);
+        static void opLoadILong(const Instruction& instruction, Chip8& chip8);
+        static void opSelectPlanes(const Instruction& instruction, Chip8& chip8);
+        static void opLoadAudioPattern(const Instruction& instruction, Chip8& chip8);
+        static void opLoadVxDelay(const Instruction& instruction, Chip8& chip8);
+        static void opLoadVxKey(const Instruction& instruction, Chip8& chip8);
+        static void opLoadDelayToVx(const Instruction& instruction, Chip8& chip8);
+        static void opLoadSoundToVx(const Instruction& instruction, Chip8& chip8);
+        static void opLoadIVx(const Instruction& instruction, Chip8& chip8);
+        static void opLoadISpriteAddr(const Instruction& instruction, Chip8& chip8);
+        static void opLoadIBigSpriteAddr(const Instruction& instruction, Chip8& chip8);
+        static void opLoadBCDVx(const Instruction& instruction, Chip8& chip8);
+        static void opLoadPitch(const Instruction& instruction, Chip8& chip8);
+        static void opStoreRegisterValues(const Instruction& instruction, Chip8& chip8);
+        static void opLoadRegisterValues(const Instruction& instruction, Chip8& chip8);
+        static void opUnknown(const Instruction& instruction, Chip8& chip8);
 
         // Constant at compile time since it won't change
-        constexpr static std::array<OpcodeMapping, 34> opcodeLookup {{
-            {0xFFFF, OP_CLEAR_SCREEN_MASK, &Opcodes::opClearScreen},
-            {0xFFFF, OP_RETURN_FROM_SUB_MASK, &Opcodes::opReturnFromSub},
-            //{0xF000, OP_CALL_MCHN_CODE_MASK, &Opcodes::opCallMchnCode},
-            {0xF000, OP_JUMP_ADDR_MASK, &Opcodes::opJumpAddr},
-            {0xF000, OP_CALL_SUB_MASK, &Opcodes::opCallSub},
-            {0xF000, OP_SE_VX_MASK, &Opcodes::opSEVx},
-            {0xF000, OP_SNE_VX_MASK, &Opcodes::opSNEVx},
-            {0xF000, OP_SE_VX_VY_MASK, &Opcodes::opSEVxVy},
-            {0xF000, OP_LOAD_VX_MASK, &Opcodes::opLoadVx},
-            {0xF000, OP_ADD_VX_MASK, &Opcodes::opAddVx},
-            {0xF00F, OP_LOAD_VX_VY_MASK, &Opcodes::opLoadVxVy},
-            {0xF00F, OP_LOAD_OR_VX_VY_MASK, &Opcodes::opLoadORVxVy},
-            {0xF00F, OP_LOAD_AND_VX_VY_MASK, &Opcodes::opLoadANDVxVy},
-            {0xF00F, OP_LOAD_XOR_VX_VY_MASK, &Opcodes::opLoadXORVxVy},
-            {0xF00F, OP_LOAD_ADD_VX_VY_MASK, &Opcodes::opLoadADDVxVy},
-            {0xF00F, OP_LOAD_SUB_VX_VY_MASK, &Opcodes::opLoadSUBVxVy},
-            {0xF00F, OP_LOAD_SHIFT_RIGHT_VX_MASK, &Opcodes::opLoadShiftRightVx},
-            {0xF00F, OP_LOAD_SUB_VY_VX_MASK, &Opcodes::opLoadSUBVyVx},
-            {0xF00F, OP_LOAD_SHIFT_LEFT_VX_MASK, &Opcodes::opLoadShiftLeftVx},
-            {0xF000, OP_SNE_VX_VY_MASK, &Opcodes::opSNEVxVy},
-            {0xF000, OP_LOAD_I_MASK, &Opcodes::opLoadI},
-            {0xF000, OP_JUMP_ADDR_V0_MASK, &Opcodes::opJumpAddrV0},
-            {0xF000, OP_LOAD_VX_RAND_MASK, &Opcodes::opLoadVxRand},
-            {0XF000, OP_DRAW_SPRITE_MASK, &Opcodes::opDrawSprite},
-            {0xF0FF, OP_SE_KEY_MASK, &Opcodes::opSEKey},
-            {0xF0FF, OP_SNE_KEY_MASK, &Opcodes::opSNEKey},
-            {0xF0FF, OP_LOAD_VX_DELAY_MASK, &Opcodes::opLoadVxDelay},
-            {0xF0FF, OP_LOAD_VX_KEY_MASK, &Opcodes::opLoadVxKey},
-            {0xF0FF, OP_LOAD_DELAY_TO_VX_MASK, &Opcodes::opLoadDelayToVx},
-            {0xF0FF, OP_LOAD_SOUND_TO_VX_MASK, &Opcodes::opLoadSoundToVx},
-            {0xF0FF, OP_LOAD_I_VX_MASK, &Opcodes::opLoadIVx},
-            {0xF0FF, OP_LOAD_I_SPRITE_ADDR_MASK, &Opcodes::opLoadISpriteAddr},
-            {0xF0FF, OP_BCD_VX_MASK, &Opcodes::opLoadBCDVx},
-            {0xF0FF, OP_STORE_REGISTER_VALUES_MASK, &Opcodes::opStoreRegisterValues},
-            {0xF0FF, OP_LOAD_REGISTER_VALUES_MASK, &Opcodes::opLoadRegisterValues}
+        // Source of truth for the decode tables below, not scanned at runtime
+        constexpr static std::array<OpcodeMapping, 48> opcodeLookup {{
+            {0xFFF0, OP_SCROLL_DOWN_MASK, &OpcodeCore::opScrollDown},
+            {0xFFF0, OP_SCROLL_UP_MASK, &OpcodeCore::opScrollUp},
+            {0xFFFF, OP_CLEAR_SCREEN_MASK, &OpcodeCore::opClearScreen},
+            {0xFFFF, OP_RETURN_FROM_SUB_MASK, &OpcodeCore::opReturnFromSub},
+            {0xFFFF, OP_SCROLL_RIGHT_MASK, &OpcodeCore::opScrollRight},
+            {0xFFFF, OP_SCROLL_LEFT_MASK, &OpcodeCore::opScrollLeft},
+            {0xFFFF, OP_EXIT_MASK, &OpcodeCore::opExit},
+            {0xFFFF, OP_LOW_RES_MASK, &OpcodeCore::opLowRes},
+            {0xFFFF, OP_HIGH_RES_MASK, &OpcodeCore::opHighRes},
+            //{0xF000, OP_CALL_MCHN_CODE_MASK, &OpcodeCore::opCallMchnCode},
+            {0xF000, OP_JUMP_ADDR_MASK, &OpcodeCore::opJumpAddr},
+            {0xF000, OP_CALL_SUB_MASK, &OpcodeCore::opCallSub},
+            {0xF000, OP_SE_VX_MASK, &OpcodeCore::opSEVx},
+            {0xF000, OP_SNE_VX_MASK, &OpcodeCore::opSNEVx},
+            {0xF00F, OP_STORE_RANGE_MASK, &OpcodeCore::opStoreRange},
+            {0xF00F, OP_LOAD_RANGE_MASK, &OpcodeCore::opLoadRange},
+            {0xF000, OP_SE_VX_VY_MASK, &OpcodeCore::opSEVxVy},
+            {0xF000, OP_LOAD_VX_MASK, &OpcodeCore::opLoadVx},
+            {0xF000, OP_ADD_VX_MASK, &OpcodeCore::opAddVx},
+            {0xF00F, OP_LOAD_VX_VY_MASK, &OpcodeCore::opLoadVxVy},
+            {0xF00F, OP_LOAD_OR_VX_VY_MASK, &OpcodeCore::opLoadORVxVy},
+            {0xF00F, OP_LOAD_AND_VX_VY_MASK, &OpcodeCore::opLoadANDVxVy},
+            {0xF00F, OP_LOAD_XOR_VX_VY_MASK, &OpcodeCore::opLoadXORVxVy},
+            {0xF00F, OP_LOAD_ADD_VX_VY_MASK, &OpcodeCore::opLoadADDVxVy},
+            {0xF00F, OP_LOAD_SUB_VX_VY_MASK, &OpcodeCore::opLoadSUBVxVy},
+            {0xF00F, OP_LOAD_SHIFT_RIGHT_VX_MASK, &OpcodeCore::opLoadShiftRightVx},
+            {0xF00F, OP_LOAD_SUB_VY_VX_MASK, &OpcodeCore::opLoadSUBVyVx},
+            {0xF00F, OP_LOAD_SHIFT_LEFT_VX_MASK, &OpcodeCore::opLoadShiftLeftVx},
+            {0xF000, OP_SNE_VX_VY_MASK, &OpcodeCore::opSNEVxVy},
+            {0xF000, OP_LOAD_I_MASK, &OpcodeCore::opLoadI},
+            {0xF000, OP_JUMP_ADDR_V0_MASK, &OpcodeCore::opJumpAddrV0},
+            {0xF000, OP_LOAD_VX_RAND_MASK, &OpcodeCore::opLoadVxRand},
+            {0XF000, OP_DRAW_SPRITE_MASK, &OpcodeCore::opDrawSprite},
+            {0xF0FF, OP_SE_KEY_MASK, &OpcodeCore::opSEKey},
+            {0xF0FF, OP_SNE_KEY_MASK, &OpcodeCore::opSNEKey},
+            {0xFFFF, OP_LOAD_I_LONG_MASK, &OpcodeCore::opLoadILong},
+            {0xF0FF, OP_SELECT_PLANES_MASK, &OpcodeCore::opSelectPlanes},
+            {0xF0FF, OP_LOAD_AUDIO_PATTERN_MASK, &OpcodeCore::opLoadAudioPattern},
+            {0xF0FF, OP_LOAD_VX_DELAY_MASK, &OpcodeCore::opLoadVxDelay},
+            {0xF0FF, OP_LOAD_VX_KEY_MASK, &OpcodeCore::opLoadVxKey},
+            {0xF0FF, OP_LOAD_DELAY_TO_VX_MASK, &OpcodeCore::opLoadDelayToVx},
+            {0xF0FF, OP_LOAD_SOUND_TO_VX_MASK, &OpcodeCore::opLoadSoundToVx},
+            {0xF0FF, OP_LOAD_I_VX_MASK, &OpcodeCore::opLoadIVx},
+            {0xF0FF, OP_LOAD_I_SPRITE_ADDR_MASK, &OpcodeCore::opLoadISpriteAddr},
+            {0xF0FF, OP_LOAD_I_BIG_SPRITE_ADDR_MASK, &OpcodeCore::opLoadIBigSpriteAddr},
+            {0xF0FF, OP_BCD_VX_MASK, &OpcodeCore::opLoadBCDVx},
+            {0xF0FF, OP_LOAD_PITCH_MASK, &OpcodeCore::opLoadPitch},
+            {0xF0FF, OP_STORE_REGISTER_VALUES_MASK, &OpcodeCore::opStoreRegisterValues},
+            {0xF0FF, OP_LOAD_REGISTER_VALUES_MASK, &OpcodeCore::opLoadRegisterValues}
         }};
 
+        // opDrawSprite's path for plain CHIP-8 sprites
+        static void drawLoresSprite(const Instruction& instruction, Chip8& chip8);
+
+        // What a taken skip does, steps over all four bytes of F000 NNNN with quirks.xoExtensions
+        static void skipNext(Chip8& chip8);
+
+        // Handlers only the XO-CHIP profile decodes, elsewhere 5XY2/5XY3 stay 5XY0 like on the VIP
+        constexpr static bool isExtension(OpcodeHandler handler) {
+            return handler == &OpcodeCore::opStoreRange || handler == &OpcodeCore::opLoadRange || handler == &OpcodeCore::opLoadILong;
+        };
+
+        template<size_t N>
+        constexpr static FamilyTable<N> buildFamilyTable(unsigned short familyBase);
+        constexpr static FamilyTable<16> buildSingleLookup();
+
+        // Decode tables, built at compile time from opcodeLookup (see opcode.cpp)
+        static const FamilyTable<16> singleLookup;
+        static const FamilyTable<0x100> family0Lookup;
+        static const FamilyTable<0x10> family5Lookup;
+        static const FamilyTable<0x10> family8Lookup;
+        static const FamilyTable<0x100> familyELookup;
+        static const FamilyTable<0x100> familyFLookup;
+        static const std::array<OpcodeFamily, 16> familyLookup;
+
 };
 
 #endif
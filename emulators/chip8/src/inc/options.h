@@ -0,0 +1,29 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+
+// Parses the whole of text as an unsigned number that fits in T, -1 otherwise so the
+// caller can print its usage line. Base 0 also takes 0x and leading 0 prefixes
+template<typename T>
+inline char parseNumber(const char* text, T& value, int base = 10) {
+    char* end {};
+
+    // strtoull skips spaces and negates a leading minus, neither is a count
+    if(!isdigit(static_cast<unsigned char>(text[0])))
+        return -1;
+
+    errno = 0;
+    const unsigned long long parsed = strtoull(text, &end, base);
+    if(*end != '\0' || errno == ERANGE || parsed > static_cast<unsigned long long>(std::numeric_limits<T>::max()))
+        return -1;
+
+    value = static_cast<T>(parsed);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef PIXEL_EXPAND_H
+#define PIXEL_EXPAND_H
+
+#include "pixels.h"
+
+namespace pixels {
+    // Expands packed rows to ARGB at destination, each pixel becoming a scale x scale square
+    // Only the visible getWidth(hires) x getHeight(hires) area is written
+    // pitch is the destination row length in bytes, as handed out by SDL_LockTexture
+    // Picks AVX2, SSE2 or scalar code once at startup depending on the CPU
+    void expandPackedRows(const PackedBuffer& packed, bool hires, void* destination, int pitch, int scale);
+
+    // Scalar reference, also used when no vector unit is available
+    void expandPackedRowsScalar(const PackedBuffer& packed, bool hires, void* destination, int pitch, int scale);
+}
+
+#endif
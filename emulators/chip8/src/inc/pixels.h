@@ -0,0 +1,48 @@
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include <array>
+#include <cstdint>
+
+// Kept apart from display.h so the machine itself never needs SDL
+namespace pixels {
+    // Classic low resolution screen
+    constexpr int DISPLAY_WIDTH = 64;
+    constexpr int DISPLAY_HEIGHT = 32;
+
+    // SUPER-CHIP/XO-CHIP high resolution, the packed buffer is always this big
+    constexpr int HIRES_WIDTH = 128;
+    constexpr int HIRES_HEIGHT = 64;
+
+    // XO-CHIP draws into two bitplanes, plain CHIP-8 only ever touches the first
+    constexpr int PLANE_COUNT = 2;
+
+    constexpr int WHITE_PIXEL = 0xFFFFFFFF;
+    constexpr int BLACK_PIXEL = 0xFF000000;
+
+    using Pixel = uint32_t;
+    using PixelRow = std::array<Pixel, HIRES_WIDTH>;
+
+    // Colour for each (plane 1 bit << 1 | plane 0 bit), single plane programs only see the first two
+    constexpr Pixel PALETTE[1 << PLANE_COUNT] {
+        static_cast<Pixel>(BLACK_PIXEL), static_cast<Pixel>(WHITE_PIXEL), 0xFFAAAAAA, 0xFF555555
+    };
+
+    // Machine side display state: one bit per pixel, bit 63 is the leftmost column of a word
+    // A row is ROW_WORDS words with word 0 on the left. Low resolution only uses the first
+    // DISPLAY_HEIGHT rows and word 0 of each, so it's still one shift and XOR per sprite row
+    using PackedRow = uint64_t;
+    constexpr int PACKED_ROW_BITS = 64;
+    constexpr int ROW_WORDS = HIRES_WIDTH / PACKED_ROW_BITS;
+
+    using PackedPlane = std::array<PackedRow, HIRES_HEIGHT * ROW_WORDS>;
+    using PackedBuffer = std::array<PackedPlane, PLANE_COUNT>;
+
+    static_assert(DISPLAY_WIDTH == PACKED_ROW_BITS, "A low resolution row must be exactly one PackedRow");
+    static_assert(HIRES_WIDTH % PACKED_ROW_BITS == 0, "High resolution rows must be whole PackedRows");
+
+    constexpr int getWidth(bool hires) { return hires ? HIRES_WIDTH : DISPLAY_WIDTH; }
+    constexpr int getHeight(bool hires) { return hires ? HIRES_HEIGHT : DISPLAY_HEIGHT; }
+}
+
+#endif
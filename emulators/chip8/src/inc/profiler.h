@@ -0,0 +1,111 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#define PROFILE_ADDRESS_SPACE   0x1000
+#define PROFILE_OPCODE_CLASSES  46      // Every opcode the decoder knows, plus one for unknown ones
+#define PROFILE_FRAME_BUCKETS   16      // Instructions run per frame, bucket n holds [2^(n-1), 2^n)
+
+// Opt-in instrumentation, configure with -DCHIP8_PROFILE=ON
+// Without it the hooks are empty and the cores compile exactly as before
+#ifdef CHIP8_PROFILE
+#define PROFILE_INSTRUCTION(pc, opcode)     profiler::countInstruction(pc, opcode)
+#define PROFILE_DRAW(collided)              profiler::countDraw(collided)
+#define PROFILE_IDLE(cycles)                profiler::countIdle(cycles)
+#define PROFILE_FRAME()                     profiler::countFrame()
+#else
+#define PROFILE_INSTRUCTION(pc, opcode)     ((void)0)
+#define PROFILE_DRAW(collided)              ((void)0)
+#define PROFILE_IDLE(cycles)                ((void)0)
+#define PROFILE_FRAME()                     ((void)0)
+#endif
+
+namespace profiler {
+#ifdef CHIP8_PROFILE
+    typedef std::atomic<unsigned long long> Counter;
+
+    // Only the owning thread ever writes its counters, so a relaxed load and store is enough
+    // and compiles to a plain add. Atomic only so a dump from another thread reads whole values
+    inline void bump(Counter& counter, unsigned long long amount = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        return;
+    }
+
+    // One per thread that runs a machine, registers itself so dumps can find it
+    // Counters of threads that exit are folded into the process totals
+    class ThreadCounters {
+        public:
+            ThreadCounters();
+            ~ThreadCounters();
+
+            ThreadCounters(const ThreadCounters&) = delete;
+            ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+            Counter instructions {};
+            Counter idleCycles {};
+            Counter draws {};
+            Counter collisions {};
+            Counter frames {};
+            Counter frameMin {};
+            Counter frameMax {};
+            std::array<Counter, PROFILE_FRAME_BUCKETS> frameBuckets {};
+            std::array<Counter, PROFILE_OPCODE_CLASSES> opcodes {};
+            std::array<Counter, PROFILE_ADDRESS_SPACE> pcHits {};
+            std::array<std::atomic<unsigned char>, PROFILE_ADDRESS_SPACE> pcOpcode {};  // Last opcode class seen there
+
+            unsigned long long frameStart {};  // Instructions when the current frame began, owner only
+    };
+
+    // Function local for the same reason as logger::getThreadLog
+    inline ThreadCounters& getThreadCounters() {
+        static thread_local ThreadCounters threadCounters {};
+        return threadCounters;
+    }
+
+    // Opcode to class index, filled from the same masks as the decoder
+    extern const std::array<unsigned char, 0x10000> opcodeClasses;
+
+    inline void countInstruction(unsigned short pc, unsigned short opcode) {
+        ThreadCounters& counters = getThreadCounters();
+        const unsigned char opcodeClass = opcodeClasses[opcode];
+        pc &= PROFILE_ADDRESS_SPACE - 1;
+
+        bump(counters.instructions);
+        bump(counters.opcodes[opcodeClass]);
+        bump(counters.pcHits[pc]);
+        counters.pcOpcode[pc].store(opcodeClass, std::memory_order_relaxed);
+
+        return;
+    }
+
+    inline void countDraw(bool collided) {
+        ThreadCounters& counters = getThreadCounters();
+
+        bump(counters.draws);
+        if(collided)
+            bump(counters.collisions);
+
+        return;
+    }
+
+    inline void countIdle(unsigned long long cycles) {
+        bump(getThreadCounters().idleCycles, cycles);
+        return;
+    }
+
+    // End of a 60 Hz frame, also where a dump asked for by signal gets written
+    void countFrame();
+#endif
+
+    // Dumps to path on exit and on SIGUSR1, ".json" gets JSON and anything else folded stacks
+    // for flamegraph.pl/speedscope. Returns -1 if profiling was compiled out
+    char install(const char* path);
+
+    // Writes everything counted so far by every thread
+    char dump();
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef QUIRKS_H
+#define QUIRKS_H
+
+#include <string_view>
+
+// Interpreters that disagree on a handful of opcodes
+// Default is what this emulator always did, the others follow the machines they're named after
+enum class QuirkProfile : unsigned char {
+    Default,
+    Chip8,      // COSMAC VIP
+    SuperChip,  // SUPER-CHIP 1.1 on the HP48
+    XOChip,
+    Count
+};
+
+typedef struct {
+    bool shiftUsesVy;       // 8XY6/8XYE shift Vy into Vx instead of shifting Vx in place
+    bool jumpUsesVx;        // BXNN jumps to XNN + Vx instead of NNN + V0
+    bool incrementI;        // FX55/FX65 leave I one past the last register
+    bool wrapSprites;       // Sprites wrap around the screen edges instead of being clipped
+    bool logicResetsVF;     // 8XY1/8XY2/8XY3 clear VF
+    bool xoExtensions;      // F000 NNNN, 5XY2 and 5XY3 decode, skips step over all four bytes of F000 NNNN
+}Quirks;
+
+constexpr Quirks QuirkTable[static_cast<size_t>(QuirkProfile::Count)] {
+    {false, false, false, false, false, false},     // Default
+    {true,  false, true,  false, true,  false},     // Chip8
+    {false, true,  false, false, false, false},     // SuperChip
+    {true,  false, true,  true,  false, true }      // XOChip
+};
+
+constexpr const char* QuirkProfileNames[static_cast<size_t>(QuirkProfile::Count)] {
+    "default", "chip8", "schip", "xochip"
+};
+
+constexpr Quirks getQuirks(QuirkProfile profile) {
+    return QuirkTable[static_cast<size_t>(profile)];
+}
+
+// Parses one of QuirkProfileNames, -1 if the name is unknown
+inline char parseQuirkProfile(std::string_view name, QuirkProfile& profile) {
+    for(size_t index = 0; index < static_cast<size_t>(QuirkProfile::Count); index++) {
+        if(name == QuirkProfileNames[index]) {
+            profile = static_cast<QuirkProfile>(index);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+// Profile for a ROM by its content hash (RomImage::getHash), Default when it isn't listed
+QuirkProfile lookupQuirkProfile(unsigned long long romHash);
+
+#endif
@@ -1,7 +1,11 @@
 #ifndef ROM_H
 
 #define ROM_H
+#include <map>
+#include <memory>
+#include <shared_mutex>
 #include <sstream>
+#include <string>
 #include "chip8.h"
 
 // Is an abstact class the best way to implement embedded/desktop functionality?
@@ -9,7 +13,7 @@ class RomManager {
     public:
         RomManager() {};
         ~RomManager() {};
-        virtual char loadRom(std::string_view filename, Chip8& chip8) = 0; // Reads entire ROM into memory
+        virtual char loadRom(std::string_view filename, Chip8& chip8) = 0; // Reads entire ROM into memory, picks its quirk profile
 };  
 
 // Embedded/Desktop functionality classes
@@ -20,4 +24,46 @@ class FileRomManager : RomManager {
         char loadRom(std::string_view filename, Chip8& chip8);
 };
 
+// Read-only ROM file contents, mapped once and shared by every machine in the process
+class RomImage {
+    public:
+        RomImage(const unsigned char* data, size_t size, bool mapped);
+        ~RomImage();
+
+        RomImage(const RomImage&) = delete;
+        RomImage& operator=(const RomImage&) = delete;
+
+        const unsigned char* getData() const { return data; };
+        size_t getSize() const { return size; };
+        unsigned long long getHash() const { return hash; };
+
+    private:
+        const unsigned char* data {};
+        size_t size {};
+        unsigned long long hash {};
+        bool mapped {};
+};
+
+// Process wide cache of ROM images keyed by path, deduplicated by content hash
+class RomCache {
+    public:
+        // Maps the file on first use, later calls for the same path only take a read lock
+        static std::shared_ptr<const RomImage> acquire(std::string_view filename);
+
+    private:
+        static std::shared_ptr<const RomImage> mapFile(std::string_view filename);
+
+        static std::shared_mutex mutex;
+        static std::map<std::string, std::shared_ptr<const RomImage>, std::less<>> byPath;
+        static std::map<unsigned long long, std::weak_ptr<const RomImage>> byHash;
+};
+
+// Loads through RomCache, so bringing up many machines on one ROM is a single memcpy each
+class MappedRomManager : RomManager {
+    public:
+        MappedRomManager() {};
+        ~MappedRomManager() {};
+        char loadRom(std::string_view filename, Chip8& chip8);
+};
+
 #endif
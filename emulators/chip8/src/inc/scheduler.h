@@ -0,0 +1,90 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <chrono>
+#include <thread>
+#include "chip8.h"
+#include "cpu_core.h"
+#include "profiler.h"
+
+#define FRAMES_PER_SECOND           60
+#define DEFAULT_CYCLES_PER_FRAME    11      // ~660 instructions per second
+
+// Runs a fixed number of instructions per 60 Hz frame and ticks the timers in between
+// Pacing uses std::chrono so headless runners can share the same frame logic
+class FrameScheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        FrameScheduler(unsigned int cyclesPerFrame = DEFAULT_CYCLES_PER_FRAME, bool turbo = false)
+            : cyclesPerFrame(cyclesPerFrame), turbo(turbo) {
+            nextFrame = Clock::now();
+            nextPresent = nextFrame;
+        };
+
+        ~FrameScheduler() {};
+
+        // One emulated frame: the CPU slice followed by one timer tick
+        unsigned int runFrame(Chip8& chip8, CpuCore& cpuCore) {
+            unsigned int executed = cpuCore.run(chip8, cyclesPerFrame);
+            PROFILE_FRAME();
+
+            chip8.tickTimers();
+            frameCount++;
+
+            return executed;
+        };
+
+        // Frames are presented once per wall clock frame, turbo just skips presenting the rest
+        bool presentDue() {
+            if(!turbo)
+                return true;
+
+            Clock::time_point now = Clock::now();
+            if(now < nextPresent)
+                return false;
+
+            nextPresent = now + framePeriod;
+            return true;
+        };
+
+        // Sleeps until the next 60 Hz boundary, turbo never waits
+        void waitForNextFrame() {
+            if(turbo)
+                return;
+
+            nextFrame += framePeriod;
+
+            // Fell more than a frame behind (breakpoint, window drag), don't try to catch up
+            Clock::time_point now = Clock::now();
+            if(now > nextFrame + framePeriod)
+                nextFrame = now;
+
+            std::this_thread::sleep_until(nextFrame);
+        };
+
+        unsigned int getCyclesPerFrame() const {
+            return cyclesPerFrame;
+        };
+
+        unsigned long long getFrameCount() const {
+            return frameCount;
+        };
+
+        bool isTurbo() const {
+            return turbo;
+        };
+
+    private:
+        static constexpr Clock::duration framePeriod {
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / FRAMES_PER_SECOND))
+        };
+
+        unsigned int cyclesPerFrame {};
+        bool turbo {};
+        unsigned long long frameCount {};
+        Clock::time_point nextFrame {};
+        Clock::time_point nextPresent {};
+};
+
+#endif
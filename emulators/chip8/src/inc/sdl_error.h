@@ -0,0 +1,10 @@
+#ifndef SDL_ERROR_H
+#define SDL_ERROR_H
+
+#include <SDL2/SDL.h>
+#include "logger.h"
+
+// SDL_GetError's text is copied into the record, SDL reuses its buffer
+#define SDL_ERROR_COUT(message) LOG_ERROR("%s Error: %s", message, SDL_GetError())
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <array>
+#include <memory>
+#include <vector>
+#include "pixels.h"
+
+#define SNAPSHOT_PAGE_SIZE      0x100
+#define SNAPSHOT_PAGE_COUNT     16      // CHIP_8_MEM_SIZE / SNAPSHOT_PAGE_SIZE
+#define SNAPSHOT_REGISTER_COUNT 0x10
+#define SNAPSHOT_STACK_SIZE     12
+#define SNAPSHOT_AUDIO_PATTERN_SIZE 16
+
+using MemoryPage = std::array<unsigned char, SNAPSHOT_PAGE_SIZE>;
+
+// What changed between two snapshots
+typedef struct {
+    unsigned short changedPages;        // Bit n set if memory page n differs
+    unsigned short changedRegisters;    // Bit n set if Vn differs
+    bool programCounter;
+    bool stackPointer;
+    bool indexRegister;
+    bool timers;
+    bool stack;
+    bool display;
+    bool audio;
+}SnapshotDiff;
+
+// Full machine state. Memory is held as immutable shared 256 byte pages, so
+// snapshots taken from the same machine share every page neither side wrote
+class Snapshot {
+    public:
+        // Until it's filled in, every page is the shared zeroed one
+        Snapshot() { pages.fill(getZeroPage()); };
+        ~Snapshot() {};
+
+        // Flat little-endian image for storing snapshots outside the process
+        std::vector<unsigned char> serialize() const;
+        static char deserialize(const std::vector<unsigned char>& data, Snapshot& snapshot);
+
+        static SnapshotDiff diff(const Snapshot& first, const Snapshot& second);
+
+        const MemoryPage& getPage(unsigned char page) const { return *pages[page]; };
+        unsigned short getProgramCounter() const { return PC; };
+        unsigned long long getCycleCount() const { return cycleCount; };
+
+        // Chip8 fills and reads the fields directly
+        friend class Chip8;
+
+    private:
+        static const std::shared_ptr<const MemoryPage>& getZeroPage();
+
+        std::array<std::shared_ptr<const MemoryPage>, SNAPSHOT_PAGE_COUNT> pages {};
+        unsigned char v[SNAPSHOT_REGISTER_COUNT] {};
+        unsigned short stack[SNAPSHOT_STACK_SIZE] {};
+
+        unsigned short PC {};
+        unsigned char SP {};
+        unsigned short I {};
+
+        unsigned short delay_timer {};
+        unsigned short sound_timer {};
+
+        unsigned short keyMask {};
+        unsigned long long randomState {};
+        unsigned long long cycleCount {};
+
+        pixels::PackedBuffer pixels {};
+        bool hires {};
+        unsigned char planeMask {};
+
+        unsigned char audioPattern[SNAPSHOT_AUDIO_PATTERN_SIZE] {};
+        unsigned char audioPitch {};
+
+        bool keyWaiting {};
+        unsigned short keyWaitIgnored {};
+        unsigned char keyWaitKey {};
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+#define CACHE_LINE_SIZE     64
+
+// Single producer/single consumer ring, neither side ever locks or waits
+// The producer only writes head and the consumer only writes tail, each on its own cache line
+template<typename T, size_t CAPACITY>
+class SpscRing {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::atomic<size_t>::is_always_lock_free, "Ring indices must be lock free");
+
+    public:
+        SpscRing() {};
+        ~SpscRing() {};
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        // Producer side, copies as much as fits and returns how many were taken
+        size_t push(const T* values, size_t count) {
+            const size_t head = this->head.load(std::memory_order_relaxed);
+
+            // Only go to the consumer's cache line when the last known tail says it's full
+            if(CAPACITY - (head - cachedTail) < count)
+                cachedTail = this->tail.load(std::memory_order_acquire);
+            const size_t space = CAPACITY - (head - cachedTail);
+
+            if(count > space)
+                count = space;
+
+            for(size_t index = 0; index < count; index++)
+                buffer[(head + index) & (CAPACITY - 1)] = values[index];
+
+            this->head.store(head + count, std::memory_order_release);
+
+            return count;
+        };
+
+        // Consumer side, returns how many were copied out
+        size_t pop(T* values, size_t count) {
+            const size_t tail = this->tail.load(std::memory_order_relaxed);
+
+            if(cachedHead - tail < count)
+                cachedHead = this->head.load(std::memory_order_acquire);
+            const size_t used = cachedHead - tail;
+
+            if(count > used)
+                count = used;
+
+            for(size_t index = 0; index < count; index++)
+                values[index] = buffer[(tail + index) & (CAPACITY - 1)];
+
+            this->tail.store(tail + count, std::memory_order_release);
+
+            return count;
+        };
+
+        // Only a hint, the other side may move on right after
+        size_t size() const {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        };
+
+        static constexpr size_t capacity() {
+            return CAPACITY;
+        };
+
+    private:
+        // Both indices only ever grow, wrapping is done when indexing buffer
+        // Each side keeps a private copy of the other's index next to its own
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> head {};
+        size_t cachedTail {};
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail {};
+        size_t cachedHead {};
+        alignas(CACHE_LINE_SIZE) T buffer[CAPACITY] {};
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool: each worker owns a deque, pops its own work from the back
+// and steals from the front of the others when it runs dry
+class WorkStealingPool {
+    public:
+        using Task = std::function<void()>;
+
+        explicit WorkStealingPool(unsigned int threadCount) {
+            if(threadCount == 0)
+                threadCount = 1;
+
+            for(unsigned int index = 0; index < threadCount; index++)
+                queues.push_back(std::make_unique<WorkQueue>());
+
+            for(unsigned int index = 0; index < threadCount; index++)
+                workers.emplace_back(&WorkStealingPool::workerLoop, this, index);
+        };
+
+        ~WorkStealingPool() {
+            {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                stopping = true;
+            }
+            idleCondition.notify_all();
+
+            for(auto &worker : workers)
+                worker.join();
+        };
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        // Spreads tasks round robin, stealing evens things out later
+        void submit(Task task) {
+            WorkQueue& queue = *queues[nextQueue++ % queues.size()];
+
+            pending++;
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(std::move(task));
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(idleMutex);
+            }
+            idleCondition.notify_one();
+        };
+
+        // Blocks until every submitted task has finished
+        void wait() {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            doneCondition.wait(lock, [this] { return pending == 0; });
+        };
+
+        unsigned int getThreadCount() const {
+            return workers.size();
+        };
+
+    private:
+        typedef struct {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        }WorkQueue;
+
+        bool popTask(unsigned int self, Task& task) {
+            {
+                WorkQueue& own = *queues[self];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if(!own.tasks.empty()) {
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+
+            for(size_t offset = 1; offset < queues.size(); offset++) {
+                WorkQueue& victim = *queues[(self + offset) % queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if(!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        void workerLoop(unsigned int self) {
+            Task task {};
+
+            while(true) {
+                if(popTask(self, task)) {
+                    task();
+                    task = nullptr;
+
+                    if(--pending == 0) {
+                        std::lock_guard<std::mutex> lock(idleMutex);
+                        doneCondition.notify_all();
+                    }
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(idleMutex);
+                if(stopping)
+                    return;
+
+                // pending also counts running tasks, recheck the queues after a short sleep
+                idleCondition.wait_for(lock, std::chrono::milliseconds(1));
+            }
+        };
+
+        std::vector<std::unique_ptr<WorkQueue>> queues {};
+        std::vector<std::thread> workers {};
+        std::atomic<unsigned int> nextQueue {};
+        std::atomic<unsigned int> pending {};
+
+        std::mutex idleMutex {};
+        std::condition_variable idleCondition {};
+        std::condition_variable doneCondition {};
+        bool stopping {};
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TONE_H
+#define TONE_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "chip8.h"
+#include "scheduler.h"
+
+#define AUDIO_SAMPLE_RATE       44100
+#define AUDIO_AMPLITUDE         4000
+#define AUDIO_FRAME_SAMPLES     (AUDIO_SAMPLE_RATE / FRAMES_PER_SECOND + 1)    // Most samples one frame can produce
+#define AUDIO_PATTERN_BITS      (AUDIO_PATTERN_SIZE * 8)
+
+// Turns the buzzer into 16-bit mono samples, one 60 Hz frame at a time
+// The plain CHIP-8 beep is just the default pattern, so XO-CHIP patterns take the same path
+// No SDL in here so headless runners can produce the same samples
+class ToneGenerator {
+    public:
+        ToneGenerator() {};
+        ~ToneGenerator() {};
+
+        // Fills samples (at least AUDIO_FRAME_SAMPLES long) and returns how many were written
+        // Silent unless the buzzer was on over the frame that just ran
+        size_t generateFrame(const Chip8& chip8, int16_t* samples) {
+            // 44100 doesn't divide by 60, carry the leftover into the next frame
+            sampleRemainder += AUDIO_SAMPLE_RATE;
+            const size_t count = sampleRemainder / FRAMES_PER_SECOND;
+            sampleRemainder %= FRAMES_PER_SECOND;
+
+            if(!chip8.isBeeping()) {
+                for(size_t index = 0; index < count; index++)
+                    samples[index] = 0;
+
+                return count;
+            }
+
+            // XO-CHIP plays the pattern at 4000*2^((pitch-64)/48) bits per second
+            const double bitRate = 4000.0 * std::exp2((chip8.getAudioPitch() - DEFAULT_AUDIO_PITCH) / 48.0);
+            const double step = bitRate / AUDIO_SAMPLE_RATE;
+            const unsigned char* pattern = chip8.getAudioPattern();
+
+            for(size_t index = 0; index < count; index++) {
+                const unsigned int bit = static_cast<unsigned int>(phase);
+
+                samples[index] = ((pattern[bit >> 3] >> (7 - (bit & 7))) & 1) ? AUDIO_AMPLITUDE : -AUDIO_AMPLITUDE;
+
+                // Even the highest pitch moves less than a whole pattern per sample
+                phase += step;
+                if(phase >= AUDIO_PATTERN_BITS)
+                    phase -= AUDIO_PATTERN_BITS;
+            }
+
+            return count;
+        };
+
+    private:
+        double phase {};            // Position in the pattern, in bits
+        unsigned int sampleRemainder {};
+};
+
+#endif
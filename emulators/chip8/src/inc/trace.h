@@ -0,0 +1,195 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+#include "cpu_core.h"
+
+#define TRACE_BLOCK_BYTES       0x10000     // Raw record bytes per block before it's handed off
+#define TRACE_QUEUED_BLOCKS     8           // The emulator waits past this, traces are never lossy
+#define TRACE_MAX_WRITE         REGISTER_COUNT  // FX55 is the widest store an instruction makes
+
+// Changed register mask, one bit per register and stack slot
+#define TRACE_REGISTER_I        16
+#define TRACE_REGISTER_SP       17
+#define TRACE_REGISTER_DT       18
+#define TRACE_REGISTER_ST       19
+#define TRACE_REGISTER_STACK    20
+#define TRACE_ALL_REGISTERS     0xFFFFFFFFU
+
+static_assert(TRACE_REGISTER_STACK + STACK_SIZE <= 32, "Registers must fit the change mask");
+
+// What a trace keeps of the machine, as it was after the instruction ran
+typedef struct {
+    unsigned char v[REGISTER_COUNT];
+    unsigned short stack[STACK_SIZE];
+    unsigned short I;
+    unsigned char SP;
+    unsigned short delay_timer;
+    unsigned short sound_timer;
+}TraceRegisters;
+
+// One executed instruction
+// cycle is the machine's cycle count after it ran, so skipped idle cycles show up as a gap
+typedef struct {
+    unsigned long long cycle;
+    unsigned short PC;
+    unsigned short opcode;
+    TraceRegisters registers;
+    unsigned short writeAddress;
+    unsigned char writeLength;      // 0 if the instruction stored nothing
+    unsigned char writeData[TRACE_MAX_WRITE];   // From writeAddress on, wrapping past the end of memory
+}TraceEntry;
+
+// Delta encodes entries into blocks and appends them to a file from a background thread
+// File: "C8TR" magic, 16 bit version, then blocks of
+//   raw size (4), stored size (4), entry count (4), flags (1), cycle before the block (8), data
+// Each entry is a flags byte, the opcode and only what changed since the previous entry
+// The first entry of every block carries every register, so blocks decode on their own
+class TraceWriter {
+    public:
+        TraceWriter() {};
+        ~TraceWriter();
+
+        TraceWriter(const TraceWriter&) = delete;
+        TraceWriter& operator=(const TraceWriter&) = delete;
+
+        // compress runs each block through lzCompress before it's written
+        char open(std::string_view filename, bool compress);
+
+        // Emulation thread only
+        void record(const TraceEntry& entry);
+
+        // Writes the last partial block and waits for the file to be complete
+        char close();
+
+    private:
+        void encode(const TraceEntry& entry);
+        void submitBlock();
+        void run();
+
+        FILE* file {};
+        bool compress {};
+        bool failed {};     // Writer thread only until close joins it
+
+        // Encoder state, emulation thread only
+        std::vector<unsigned char> block {};
+        unsigned int blockEntries {};
+        unsigned long long blockCycle {};
+        TraceEntry previous {};
+        bool keyframe {true};
+
+        // Filled blocks on their way to the writer thread, and emptied ones coming back
+        typedef struct {
+            std::vector<unsigned char> data;
+            unsigned int entries;
+            unsigned long long cycle;
+        }PendingBlock;
+
+        std::mutex mutex {};
+        std::condition_variable queued {};
+        std::condition_variable drained {};
+        std::deque<PendingBlock> pending {};
+        std::vector<std::vector<unsigned char>> spareBuffers {};
+        bool stopping {};
+        std::thread writer {};
+};
+
+// Reads a trace back one block at a time, memory use doesn't grow with the trace
+class TraceReader {
+    public:
+        TraceReader() {};
+        ~TraceReader();
+
+        TraceReader(const TraceReader&) = delete;
+        TraceReader& operator=(const TraceReader&) = delete;
+
+        char open(std::string_view filename);
+
+        // False at the end of the trace or if it's damaged, hasError tells which
+        bool next(TraceEntry& entry);
+
+        bool hasError() const { return error; };
+
+    private:
+        char readBlock();
+        bool decode(TraceEntry& entry);
+
+        FILE* file {};
+        bool error {};
+
+        std::vector<unsigned char> stored {};
+        std::vector<unsigned char> block {};
+        size_t offset {};
+        unsigned int remaining {};
+        TraceEntry previous {};
+        bool keyframe {};
+};
+
+// Runs like InterpreterCore and records every instruction
+// Steps one instruction at a time whatever core was picked, a block can't say what each
+// of its instructions changed. Both cores end in the same state, so traces still compare
+class TraceCore : public CpuCore {
+    public:
+        TraceCore(TraceWriter& writer) : writer(writer) {};
+        ~TraceCore() {};
+
+        unsigned int run(Chip8& chip8, unsigned int cycleBudget) {
+            // Breakpoints still stop a traced machine, the debugger hands each instruction back to step
+            if(Debugger::isArmed())
+                return Debugger::getActive()->runSlice(chip8, cycleBudget, [this](Chip8& machine) { step(machine); });
+
+            chip8.beginSlice();
+
+            for(unsigned int cycle = 0; cycle < cycleBudget; cycle++) {
+                step(chip8);
+
+                if(chip8.isIdle())
+                    cycle += chip8.skipIdleCycles(cycleBudget - cycle - 1);
+            }
+
+            return cycleBudget;
+        };
+
+    private:
+        void step(Chip8& chip8) {
+            TraceEntry entry;
+
+            entry.PC = chip8.PC;
+            entry.opcode = GET_OPCODE(chip8.memory[chip8.PC], chip8.memory[(chip8.PC + 1) & (CHIP_8_MEM_SIZE - 1)]);
+
+            // Taken from the instruction rather than the written range, a store that wraps past
+            // the end of memory is one entry at I instead of everything in between
+            entry.writeAddress = chip8.I & (CHIP_8_MEM_SIZE - 1);
+            entry.writeLength = static_cast<unsigned char>(Opcodes::storeLength(entry.opcode, chip8.quirkProfile));
+
+            chip8.readNextInstruction();
+
+            entry.cycle = chip8.cycleCount;
+            memcpy(entry.registers.v, chip8.v, sizeof(chip8.v));
+            memcpy(entry.registers.stack, chip8.stack, sizeof(chip8.stack));
+            entry.registers.I = chip8.I;
+            entry.registers.SP = chip8.SP;
+            entry.registers.delay_timer = chip8.delay_timer;
+            entry.registers.sound_timer = chip8.sound_timer;
+
+            for(unsigned char index = 0; index < entry.writeLength; index++)
+                entry.writeData[index] = chip8.memory[(entry.writeAddress + index) & (CHIP_8_MEM_SIZE - 1)];
+
+            writer.record(entry);
+
+            return;
+        };
+
+        TraceWriter& writer;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef WIDE_ENGINE_H
+#define WIDE_ENGINE_H
+
+#include <array>
+#include <bitset>
+#include "chip8.h"
+
+#define WIDE_MAX_LANES      32
+#define WIDE_CHURN_WINDOW   64      // Regroups between checks on whether the lockstep pays for itself
+#define WIDE_GROUP_STEPS    24      // Lane-instructions a regroup has to average, fewer and the lanes go solo
+#define WIDE_MIN_SOLO_RUNS  16      // Runs the lanes spend on their own machines before trying the lockstep again,
+#define WIDE_MAX_SOLO_RUNS  4096    // doubling every time it still doesn't pay
+
+// Runs up to 32 machines in lockstep: while PCs agree one decoded instruction updates
+// all lanes with AVX2 (or SSE2) vectors. Once a skip splits them, the lane furthest
+// behind and every lane at its PC go on as a group with the others masked off. Anything
+// touching memory, the display, the stack or keys goes through each lane's scalar
+// handlers, so results are bit-identical to running the machines one by one
+// A lane alone at its PC, or gone idle (FX0A, 00FD, loops that changed nothing), finishes
+// the run on its own machine like InterpreterCore. Idle ones start the next run that way too
+// Lanes that keep splitting up and regrouping cost more than they share, once that goes on for
+// WIDE_CHURN_WINDOW regroups every lane runs on its own machine for a while
+class WideEngine {
+    public:
+        // Machines keep their own memory, display, stack and RNG, the engine only owns registers
+        // Every lane must use the same quirk profile
+        WideEngine(Chip8* const* machines, unsigned int count);
+        ~WideEngine() {};
+
+        // Runs every lane exactly cycleBudget instructions
+        unsigned int run(unsigned int cycleBudget);
+
+        // Memory written from outside the engine (ROM loads, restoreSnapshot) must be followed by this
+        void resync();
+
+        void tickTimers() {
+            for(unsigned int lane = 0; lane < laneCount; lane++)
+                machines[lane]->tickTimers();
+
+            return;
+        };
+
+        unsigned int getLaneCount() const { return laneCount; };
+
+        // How many lane-instructions went through the vector path vs the scalar handlers
+        unsigned long long getVectorSteps() const { return vectorSteps; };
+        unsigned long long getScalarSteps() const { return scalarSteps; };
+        unsigned long long getIdleSteps() const { return idleSteps; };     // Scalar steps idle lanes skipped
+
+        template<unsigned int VECTOR_BYTES> friend class WideKernel;
+
+    private:
+        // What the vector path does with an instruction, Scalar hands it to each lane's Chip8
+        enum class WideOp : unsigned char {
+            Undecoded,
+            Scalar,
+            Jump,
+            SkipEqualImmediate,
+            SkipNotEqualImmediate,
+            SkipEqualRegister,
+            SkipNotEqualRegister,
+            LoadImmediate,
+            AddImmediate,
+            LoadRegister,
+            Or,
+            And,
+            Xor,
+            Add,
+            Subtract,
+            ShiftRight,
+            SubtractReversed,
+            ShiftLeft,
+            LoadI,
+            AddI,
+            LoadDelay,
+            SetDelay,
+            SetSound,
+            // Per lane, but without handing the whole register file to the lane's Chip8
+            Call,
+            Return,
+            SkipKey,
+            SkipNotKey,
+            Random,
+            Draw,
+            LoadRegisters
+        };
+
+        typedef struct {
+            WideOp op;
+            Opcodes::OpcodeHandler handler;
+            unsigned short opcode;
+            unsigned short nnn;
+            unsigned char x;
+            unsigned char y;
+            unsigned char n;
+            unsigned char nn;
+        }WideInstruction;
+
+        static WideInstruction decodeWide(unsigned short opcode, QuirkProfile profile);
+
+        void loadLanes();
+        void storeLane(unsigned int lane, unsigned int executed);
+        void storeLanes(unsigned int executed);
+        void runLeftovers();
+        void markStore(size_t start, size_t size);
+        bool checkChurn(unsigned int groupLanes, unsigned int steps);
+
+        std::array<Chip8*, WIDE_MAX_LANES> machines {};
+        unsigned int laneCount {};
+
+        // Structure of arrays register file, lane n of every row is machine n
+        alignas(32) unsigned char v[REGISTER_COUNT][WIDE_MAX_LANES] {};
+        alignas(32) unsigned short PC[WIDE_MAX_LANES] {};
+        alignas(32) unsigned short I[WIDE_MAX_LANES] {};
+        alignas(32) unsigned char SP[WIDE_MAX_LANES] {};
+        alignas(32) unsigned short delayTimer[WIDE_MAX_LANES] {};
+        alignas(32) unsigned short soundTimer[WIDE_MAX_LANES] {};
+        alignas(32) unsigned short keyMask[WIDE_MAX_LANES] {};
+
+        unsigned long long cycleBase[WIDE_MAX_LANES] {};    // Each machine's cycle count when the run started
+        unsigned int laneWrites[WIDE_MAX_LANES] {};         // Low bits of each machine's write count
+
+        // Loop probes, the wide version of Chip8::probeLoop. Registers are kept as rows like v so
+        // lanes doing real work are told apart with vector compares
+        typedef struct {
+            unsigned short I;
+            unsigned char SP;
+            unsigned short delayTimer;
+            unsigned short soundTimer;
+            unsigned long long randomState;
+            unsigned short stack[STACK_SIZE];
+            unsigned char planeMask;
+            unsigned char audioPitch;
+        }LaneProbe;
+
+        alignas(32) unsigned char probeV[REGISTER_COUNT][WIDE_MAX_LANES] {};
+        unsigned short probeHead[WIDE_MAX_LANES] {};
+        unsigned int probeCycle[WIDE_MAX_LANES] {};
+        unsigned int probeWrites[WIDE_MAX_LANES] {};
+        unsigned int probeComplete {};      // Lanes whose LaneProbe was captured too
+        std::array<LaneProbe, WIDE_MAX_LANES> laneProbes {};
+
+        // Lanes that left the lockstep this run, their machines hold their state from then on
+        unsigned int retiredLanes {};
+        unsigned int leftover[WIDE_MAX_LANES] {};   // Instructions their machines still have to run
+        unsigned int parkedLanes {};                // Went idle last run, these start the next one retired
+
+        // Lockstep payoff since the last check, and how long the lanes stay solo after one fails
+        unsigned int regroups {};
+        unsigned long long groupSteps {};
+        unsigned int soloRuns {};
+        unsigned int soloBackoff {WIDE_MIN_SOLO_RUNS};
+
+        // Addresses where the lanes may hold different bytes, instructions there always run scalar
+        std::bitset<CHIP_8_MEM_SIZE> divergent {};
+        std::array<WideInstruction, CHIP_8_MEM_SIZE> decodeCache {};
+
+        unsigned long long vectorSteps {};
+        unsigned long long scalarSteps {};
+        unsigned long long idleSteps {};
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "journal.h"
+#include <fstream>
+#include <string>
+
+#define JOURNAL_MAGIC       0x4A493843     // "C8IJ"
+#define JOURNAL_VERSION     2
+
+static void putValue(std::vector<unsigned char>& data, unsigned long long value, size_t size) {
+    for(size_t index = 0; index < size; index++)
+        data.push_back(static_cast<unsigned char>(value >> (index * 8)));
+
+    return;
+}
+
+// LEB128, cycle deltas between key changes are usually a few thousand
+static void putVarint(std::vector<unsigned char>& data, unsigned long long value) {
+    while(value >= 0x80) {
+        data.push_back(static_cast<unsigned char>(value) | 0x80);
+        value >>= 7;
+    }
+    data.push_back(static_cast<unsigned char>(value));
+
+    return;
+}
+
+static char getValue(const std::vector<unsigned char>& data, size_t& offset, size_t size, unsigned long long& value) {
+    if(data.size() - offset < size)
+        return -1;
+
+    value = 0;
+    for(size_t index = 0; index < size; index++)
+        value |= static_cast<unsigned long long>(data[offset + index]) << (index * 8);
+    offset += size;
+
+    return 0;
+}
+
+static char getVarint(const std::vector<unsigned char>& data, size_t& offset, unsigned long long& value) {
+    value = 0;
+
+    for(unsigned int shift = 0; shift < 64; shift += 7) {
+        if(offset >= data.size())
+            return -1;
+
+        unsigned char byte = data[offset++];
+        value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+        if(!(byte & 0x80))
+            return 0;
+    }
+
+    return -1;
+}
+
+char InputJournal::save(std::string_view filename) const {
+    std::vector<unsigned char> data {};
+    unsigned long long lastCycle {};
+
+    putValue(data, JOURNAL_MAGIC, 4);
+    putValue(data, JOURNAL_VERSION, 2);
+    putValue(data, cyclesPerFrame, 4);
+    putValue(data, static_cast<unsigned char>(quirkProfile), 1);
+    putValue(data, seed, 8);
+    putValue(data, initialHash, 8);
+
+    putValue(data, events.size(), 8);
+    for(const auto &event : events) {
+        putVarint(data, event.cycle - lastCycle);
+        putValue(data, event.keyMask, 2);
+        lastCycle = event.cycle;
+    }
+
+    putValue(data, frameHashes.size(), 8);
+    for(unsigned long long hash : frameHashes)
+        putValue(data, hash, 8);
+
+    std::ofstream file(std::string(filename), std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+        return -1;
+
+    if(!file.write(reinterpret_cast<const char*>(data.data()), data.size()))
+        return -1;
+
+    return 0;
+}
+
+char InputJournal::load(std::string_view filename, InputJournal& journal) {
+    std::ifstream file(std::string(filename), std::ios::binary);
+    if(!file.is_open())
+        return -1;
+
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t offset {};
+    unsigned long long magic {}, version {}, cyclesPerFrame {}, quirkProfile {}, count {}, value {};
+
+    if(getValue(data, offset, 4, magic) || magic != JOURNAL_MAGIC)
+        return -1;
+    if(getValue(data, offset, 2, version) || version != JOURNAL_VERSION)
+        return -1;
+    if(getValue(data, offset, 4, cyclesPerFrame) || cyclesPerFrame == 0)
+        return -1;
+    if(getValue(data, offset, 1, quirkProfile) || quirkProfile >= static_cast<unsigned long long>(QuirkProfile::Count))
+        return -1;
+    if(getValue(data, offset, 8, journal.seed) || getValue(data, offset, 8, journal.initialHash))
+        return -1;
+
+    journal.cyclesPerFrame = static_cast<unsigned int>(cyclesPerFrame);
+    journal.quirkProfile = static_cast<QuirkProfile>(quirkProfile);
+    journal.events.clear();
+    journal.frameHashes.clear();
+
+    // Every entry takes at least 3 bytes, reject counts the file can't hold before reserving
+    if(getValue(data, offset, 8, count) || count > (data.size() - offset) / 3)
+        return -1;
+
+    unsigned long long cycle {};
+    for(unsigned long long index = 0; index < count; index++) {
+        if(getVarint(data, offset, value))
+            return -1;
+        cycle += value;
+
+        if(getValue(data, offset, 2, value))
+            return -1;
+        journal.events.push_back({cycle, static_cast<unsigned short>(value)});
+    }
+
+    if(getValue(data, offset, 8, count) || count != (data.size() - offset) / 8 || (data.size() - offset) % 8)
+        return -1;
+
+    journal.frameHashes.reserve(count);
+    for(unsigned long long index = 0; index < count; index++) {
+        getValue(data, offset, 8, value);
+        journal.frameHashes.push_back(value);
+    }
+
+    journal.lastMask = journal.events.empty() ? 0 : journal.events.back().keyMask;
+
+    return 0;
+}
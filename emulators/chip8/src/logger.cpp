@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "logger.h"
+
+#define LOG_FLUSH_INTERVAL_MS   10      // How long the writer sleeps when every ring is empty
+#define LOG_BATCH_RECORDS       64
+#define LOG_CALIBRATION_MS      10      // How long the writer watches the clock before converting timestamps
+
+static const char* const levelNames[] { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+
+// Conversion spec lengths are rewritten so every integer goes through snprintf as 64 bits
+static bool isIntegerConversion(char conversion) {
+    return strchr("diouxXc", conversion) != nullptr;
+}
+
+static bool isFloatConversion(char conversion) {
+    return strchr("eEfFgGaA", conversion) != nullptr;
+}
+
+static void appendArg(std::string& line, const std::string& spec, const logger::Record& record, unsigned char index) {
+    const logger::Arg& arg = record.args[index];
+    const logger::ArgType type = record.types[index];
+    const char conversion = spec.back();
+    char buffer[64];
+    int length {};
+
+    if(conversion == 's') {
+        const char* text = (type == logger::ArgType::String) ? record.text + arg.u : "(?)";
+        length = snprintf(buffer, sizeof(buffer), spec.c_str(), text);
+    }
+    else if(conversion == 'p') {
+        length = snprintf(buffer, sizeof(buffer), spec.c_str(), arg.p);
+    }
+    else if(isFloatConversion(conversion)) {
+        double value = arg.d;
+        if(type == logger::ArgType::Signed)
+            value = static_cast<double>(arg.i);
+        else if(type == logger::ArgType::Unsigned)
+            value = static_cast<double>(arg.u);
+
+        length = snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+    }
+    else if(conversion == 'c') {
+        length = snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<int>(arg.i));
+    }
+    else {
+        const std::string wide = spec.substr(0, spec.size() - 1) + "ll" + conversion;
+        long long value = arg.i;
+        if(type == logger::ArgType::Double)
+            value = static_cast<long long>(arg.d);
+
+        length = snprintf(buffer, sizeof(buffer), wide.c_str(), value);
+    }
+
+    line.append(buffer, std::min<size_t>(std::max(length, 0), sizeof(buffer) - 1));
+
+    return;
+}
+
+// printf over the queued arguments, one conversion at a time
+static void formatRecord(std::string& line, const logger::Record& record, long long epoch, double ticksPerSecond) {
+    char prefix[48];
+    const double seconds = (record.timestamp - epoch) / ticksPerSecond;
+    snprintf(prefix, sizeof(prefix), "[%12.6f] %-5s ", seconds, levelNames[std::min<unsigned char>(record.level, LOG_LEVEL_ERROR)]);
+    line += prefix;
+
+    unsigned char argIndex {};
+    for(const char* cursor = record.format; *cursor != '\0'; cursor++) {
+        if(*cursor != '%') {
+            line += *cursor;
+            continue;
+        }
+
+        if(cursor[1] == '%') {
+            line += '%';
+            cursor++;
+            continue;
+        }
+
+        // Flags, width and precision are kept, length modifiers are dropped
+        std::string spec { '%' };
+        const char* end = cursor + 1;
+        while(*end != '\0' && strchr("-+ #0123456789.", *end) != nullptr)
+            spec += *end++;
+        while(*end != '\0' && strchr("hljztL", *end) != nullptr)
+            end++;
+
+        if(*end == '\0')
+            break;
+
+        spec += *end;
+        cursor = end;
+
+        if(argIndex >= record.argCount || !(isIntegerConversion(*end) || isFloatConversion(*end) || *end == 's' || *end == 'p')) {
+            line += spec;
+            continue;
+        }
+
+        appendArg(line, spec, record, argIndex++);
+    }
+
+    line += '\n';
+
+    return;
+}
+
+// Owns the rings and the thread that drains them
+class LogWriter {
+    public:
+        LogWriter() {
+            epoch = logger::readClock();
+            writer = std::thread(&LogWriter::run, this);
+        };
+
+        // Static destruction, whatever is still queued gets written before the thread ends
+        ~LogWriter() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            writer.join();
+
+            if(output != stderr)
+                fclose(output);
+            if(nextOutput != nullptr)
+                fclose(nextOutput);
+        };
+
+        std::shared_ptr<logger::ThreadRing> addRing() {
+            std::shared_ptr<logger::ThreadRing> ring = std::make_shared<logger::ThreadRing>();
+            std::lock_guard<std::mutex> lock(mutex);
+
+            ring->thread = nextThread++;
+            rings.push_back(ring);
+
+            return ring;
+        };
+
+        char setOutput(const char* path) {
+            FILE* file = fopen(path, "w");
+            if(file == nullptr)
+                return -1;
+
+            // The writer thread owns output, it swaps the file in at the start of its next pass
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(nextOutput != nullptr)
+                    fclose(nextOutput);
+                nextOutput = file;
+            }
+            flush();
+
+            return 0;
+        };
+
+        void flush() {
+            std::unique_lock<std::mutex> lock(mutex);
+            const unsigned long long request = ++flushRequested;
+
+            wake.notify_all();
+            flushed.wait(lock, [this, request] { return flushCompleted >= request; });
+
+            return;
+        };
+
+    private:
+        void run() {
+            calibrateClock();
+
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while(true) {
+                const bool stop = stopping;
+                const unsigned long long request = flushRequested;
+
+                if(nextOutput != nullptr) {
+                    if(output != stderr)
+                        fclose(output);
+                    output = nextOutput;
+                    nextOutput = nullptr;
+                }
+
+                std::vector<std::shared_ptr<logger::ThreadRing>> pending = rings;
+
+                // Rings are lock-free, only the list of them needs the mutex
+                lock.unlock();
+                const bool wrote = drain(pending);
+                lock.lock();
+
+                // Exited threads are dropped once everything they logged is out
+                rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<logger::ThreadRing>& ring) {
+                    return ring->retired.load(std::memory_order_acquire) && ring->records.size() == 0;
+                }), rings.end());
+
+                if(wrote)
+                    continue;
+
+                flushCompleted = request;
+                flushed.notify_all();
+
+                if(stop)
+                    break;
+
+                wake.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS), [this, request] {
+                    return stopping || flushRequested != request;
+                });
+            }
+
+            return;
+        };
+
+        // Records queue up meanwhile, nothing waits on this but the first write
+        void calibrateClock() {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            const long long startTicks = logger::readClock();
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOG_CALIBRATION_MS));
+
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            ticksPerSecond = (logger::readClock() - startTicks) / elapsed;
+
+            return;
+        };
+
+        // One pass over every ring, returns whether anything was written
+        bool drain(const std::vector<std::shared_ptr<logger::ThreadRing>>& pending) {
+            logger::Record records[LOG_BATCH_RECORDS];
+            std::string line {};
+            bool wrote {};
+
+            for(const std::shared_ptr<logger::ThreadRing>& ring : pending) {
+                const unsigned long long dropped = ring->dropped.load(std::memory_order_relaxed);
+                if(dropped != ring->reportedDrops) {
+                    fprintf(output, "[%12s] WARN  thread %u dropped %llu records, ring full\n", "", ring->thread, dropped - ring->reportedDrops);
+                    ring->reportedDrops = dropped;
+                    wrote = true;
+                }
+
+                size_t count {};
+                while((count = ring->records.pop(records, LOG_BATCH_RECORDS)) != 0) {
+                    for(size_t index = 0; index < count; index++) {
+                        line.clear();
+                        formatRecord(line, records[index], epoch, ticksPerSecond);
+                        fwrite(line.data(), 1, line.size(), output);
+                    }
+                    wrote = true;
+                }
+            }
+
+            if(wrote)
+                fflush(output);
+
+            return wrote;
+        };
+
+        std::mutex mutex {};
+        std::condition_variable wake {};
+        std::condition_variable flushed {};
+        std::vector<std::shared_ptr<logger::ThreadRing>> rings {};
+        unsigned int nextThread {};
+        unsigned long long flushRequested {};
+        unsigned long long flushCompleted {};
+        bool stopping {};
+        FILE* output {stderr};         // Writer thread only
+        FILE* nextOutput {};
+        long long epoch {};
+        double ticksPerSecond {};
+        std::thread writer {};
+};
+
+// Function local so the first thread to log starts the writer
+static LogWriter& getWriter() {
+    static LogWriter writer {};
+    return writer;
+}
+
+logger::ThreadLog::ThreadLog() {
+    ring = getWriter().addRing();
+}
+
+logger::ThreadLog::~ThreadLog() {
+    ring->retired.store(true, std::memory_order_release);
+}
+
+char logger::setOutput(const char* path) {
+    return getWriter().setOutput(path);
+}
+
+void logger::flush() {
+    getWriter().flush();
+    return;
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cstring>
+#include "lz.h"
+
+static unsigned int read32(const unsigned char* data) {
+    unsigned int value;
+    memcpy(&value, data, sizeof(value));
+
+    return value;
+}
+
+static unsigned int hashSequence(unsigned int sequence) {
+    return (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+static void putLength(std::vector<unsigned char>& output, size_t length) {
+    while(length >= 255) {
+        output.push_back(255);
+        length -= 255;
+    }
+    output.push_back(static_cast<unsigned char>(length));
+
+    return;
+}
+
+// Literals in [literal, literal + literalLength), then a match unless matchLength is 0
+static void putSequence(std::vector<unsigned char>& output, const unsigned char* literal, size_t literalLength,
+                        size_t offset, size_t matchLength) {
+    const size_t matchCode = matchLength ? matchLength - LZ_MIN_MATCH : 0;
+
+    output.push_back(static_cast<unsigned char>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+    if(literalLength >= 15)
+        putLength(output, literalLength - 15);
+
+    output.insert(output.end(), literal, literal + literalLength);
+
+    if(matchLength == 0)
+        return;
+
+    output.push_back(static_cast<unsigned char>(offset));
+    output.push_back(static_cast<unsigned char>(offset >> 8));
+    if(matchCode >= 15)
+        putLength(output, matchCode - 15);
+
+    return;
+}
+
+void lzCompress(const unsigned char* data, size_t size, std::vector<unsigned char>& output) {
+    // Positions are stored plus one so zero means empty
+    std::vector<unsigned int> table(1 << LZ_HASH_BITS, 0);
+    size_t anchor {};
+    size_t position {};
+
+    while(position + LZ_MIN_MATCH <= size) {
+        const unsigned int sequence = read32(data + position);
+        unsigned int& slot = table[hashSequence(sequence)];
+        const size_t candidate = slot;
+        slot = static_cast<unsigned int>(position + 1);
+
+        if(candidate == 0 || position + 1 - candidate > LZ_MAX_OFFSET || read32(data + candidate - 1) != sequence) {
+            position++;
+            continue;
+        }
+
+        size_t length = LZ_MIN_MATCH;
+        while(position + length < size && data[candidate - 1 + length] == data[position + length])
+            length++;
+
+        putSequence(output, data + anchor, position - anchor, position + 1 - candidate, length);
+        position += length;
+        anchor = position;
+    }
+
+    putSequence(output, data + anchor, size - anchor, 0, 0);
+
+    return;
+}
+
+static char getLength(const unsigned char*& data, const unsigned char* end, size_t& length) {
+    unsigned char byte;
+
+    do {
+        if(data >= end)
+            return -1;
+
+        byte = *data++;
+        length += byte;
+    } while(byte == 255);
+
+    return 0;
+}
+
+char lzDecompress(const unsigned char* data, size_t dataSize, unsigned char* output, size_t size) {
+    const unsigned char* end = data + dataSize;
+    size_t written {};
+
+    while(data < end) {
+        const unsigned char token = *data++;
+        size_t literalLength = token >> 4;
+
+        if(literalLength == 15 && getLength(data, end, literalLength))
+            return -1;
+        if(literalLength > static_cast<size_t>(end - data) || literalLength > size - written)
+            return -1;
+
+        memcpy(output + written, data, literalLength);
+        data += literalLength;
+        written += literalLength;
+
+        // Literals only, that was the last sequence
+        if(data == end)
+            break;
+
+        if(end - data < 2)
+            return -1;
+
+        const size_t offset = data[0] | (data[1] << 8);
+        size_t matchLength = token & 0x0F;
+        data += 2;
+
+        if(matchLength == 15 && getLength(data, end, matchLength))
+            return -1;
+        matchLength += LZ_MIN_MATCH;
+
+        if(offset == 0 || offset > written || matchLength > size - written)
+            return -1;
+
+        // Byte by byte on purpose, matches may overlap what they're copying
+        for(size_t index = 0; index < matchLength; index++, written++)
+            output[written] = output[written - offset];
+    }
+
+    return (written == size) ? 0 : -1;
+}
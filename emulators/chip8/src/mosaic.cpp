@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "aot.h"
+#include "block_engine.h"
+#include "chip8.h"
+#include "cpu_core.h"
+#include "logger.h"
+#include "mosaic.h"
+#include "options.h"
+#include "rom.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+
+typedef struct {
+    unsigned int instanceCount {};      // 0 runs every ROM once
+    int scale { 1 };
+    unsigned int cyclesPerFrame { DEFAULT_CYCLES_PER_FRAME };
+    unsigned int threadCount { std::thread::hardware_concurrency() };
+    unsigned long long seed { DEFAULT_RANDOM_SEED };
+    bool useBlockCore {};
+    bool turbo {};
+    bool overrideQuirks {};
+    QuirkProfile quirkProfile {};
+    std::unique_ptr<AotLibrary> aotLibrary {};
+    std::vector<std::string> roms {};
+}MosaicOptions;
+
+typedef struct {
+    std::string rom;
+    std::unique_ptr<Chip8> chip8;
+    std::unique_ptr<CpuCore> cpuCore;
+    FrameScheduler scheduler;           // Only runs frames, pacing is the window's scheduler
+    char error;
+}MosaicInstance;
+
+static void addRoms(const std::string& path, std::vector<std::string>& roms) {
+    if(!std::filesystem::is_directory(path)) {
+        roms.push_back(path);
+        return;
+    }
+
+    std::vector<std::string> found {};
+    for(const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+        if(entry.is_regular_file() && entry.path().extension() == ".ch8")
+            found.push_back(entry.path().string());
+    }
+
+    // Directory order is unspecified, keep the tile layout the same between runs
+    std::sort(found.begin(), found.end());
+    roms.insert(roms.end(), found.begin(), found.end());
+
+    return;
+}
+
+static char parseOptions(int argc, char* argv[], MosaicOptions& options) {
+    for(int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+
+        if(strncmp(arg, "--instances=", 12) == 0) {
+            if(parseNumber(arg + 12, options.instanceCount))
+                return -1;
+        }
+        else if(strncmp(arg, "--scale=", 8) == 0) {
+            if(parseNumber(arg + 8, options.scale) || options.scale == 0)
+                return -1;
+        }
+        else if(strncmp(arg, "--cycles-per-frame=", 19) == 0) {
+            if(parseNumber(arg + 19, options.cyclesPerFrame) || options.cyclesPerFrame == 0)
+                return -1;
+        }
+        else if(strncmp(arg, "--threads=", 10) == 0) {
+            if(parseNumber(arg + 10, options.threadCount))
+                return -1;
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0) {
+            if(parseNumber(arg + 7, options.seed, 0))
+                return -1;
+        }
+        else if(strcmp(arg, "--engine=block") == 0)
+            options.useBlockCore = true;
+        else if(strcmp(arg, "--engine=interp") == 0)
+            options.useBlockCore = false;
+        else if(strcmp(arg, "--turbo") == 0)
+            options.turbo = true;
+        else if(strncmp(arg, "--quirks=", 9) == 0) {
+            if(parseQuirkProfile(arg + 9, options.quirkProfile))
+                return -1;
+            options.overrideQuirks = true;
+        }
+        else if(strncmp(arg, "--aot=", 6) == 0)
+            options.aotLibrary = std::make_unique<AotLibrary>(arg + 6);
+        else if(strncmp(arg, "--", 2) == 0)
+            return -1;
+        else
+            addRoms(arg, options.roms);
+    }
+
+    if(options.instanceCount == 0)
+        options.instanceCount = options.roms.size();
+
+    return options.roms.empty() ? -1 : 0;
+}
+
+// Copies of a ROM get their own seed so they don't all show the same picture
+static void startInstance(const MosaicOptions& options, unsigned int index, MosaicInstance& instance) {
+    MappedRomManager romManager;
+
+    instance.rom = options.roms[index % options.roms.size()];
+    instance.chip8 = std::make_unique<Chip8>();
+    instance.scheduler = FrameScheduler(options.cyclesPerFrame, true);
+
+    if(options.useBlockCore || options.aotLibrary != nullptr)
+        instance.cpuCore = std::make_unique<BlockCore>();
+    else
+        instance.cpuCore = std::make_unique<InterpreterCore>();
+
+    instance.error = romManager.loadRom(instance.rom, *instance.chip8);
+    if(instance.error)
+        return;
+
+    if(options.aotLibrary != nullptr)
+        static_cast<BlockCore*>(instance.cpuCore.get())->setNativeModule(options.aotLibrary->find(RomCache::acquire(instance.rom)->getHash()));
+
+    if(options.overrideQuirks)
+        instance.chip8->setQuirkProfile(options.quirkProfile);
+    instance.chip8->seedRandom(options.seed + index);
+
+    return;
+}
+
+// Every machine in one window, one tile each. There's no keyboard input, all keys stay released
+int main(int argc, char* argv[]) {
+    MosaicOptions options {};
+
+    if(parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s [--instances=N] [--scale=N] [--cycles-per-frame=N] [--threads=N] [--seed=N] [--turbo] [--quirks=default|chip8|schip|xochip] [--engine=interp|block] [--aot=DIR] <ROM or directory>...\n", argv[0]);
+        return -1;
+    }
+
+    std::vector<MosaicInstance> instances(options.instanceCount);
+    for(unsigned int index = 0; index < options.instanceCount; index++) {
+        startInstance(options, index, instances[index]);
+        if(instances[index].error)
+            LOG_ERROR("Could not load ROM %s, its tile stays blank", instances[index].rom.c_str());
+    }
+
+    FrameScheduler scheduler(options.cyclesPerFrame, options.turbo);
+    MosaicDisplay display(options.instanceCount, options.scale, !scheduler.isTurbo());
+    WorkStealingPool pool(options.threadCount);
+
+    LOG_INFO("%u machines on a %ux%u grid", options.instanceCount, display.getColumns(), display.getRows());
+
+    // Machines run and expand their own tile on the pool, only the upload and present stay on this thread
+    bool running = true;
+    while(running) {
+        const bool present = scheduler.presentDue();
+
+        for(unsigned int index = 0; index < options.instanceCount; index++) {
+            MosaicInstance& instance = instances[index];
+            if(instance.error)
+                continue;
+
+            pool.submit([&display, &instance, index, present] {
+                instance.scheduler.runFrame(*instance.chip8, *instance.cpuCore);
+
+                // Dirty flags keep piling up on the machine until a frame is actually shown
+                if(present)
+                    display.updateTile(index, instance.chip8->getPixels(), instance.chip8->isHires(),
+                                       instance.chip8->takeDisplayDirty());
+            });
+        }
+        pool.wait();
+
+        if(present) {
+            running = display.closeDisplayCheck();
+            display.present();
+        }
+
+        scheduler.waitForNextFrame();
+    }
+
+    return 0;
+}
@@ -1,41 +1,335 @@
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include "opcode.h"
 #include "chip8.h"
 
 #define GET_VX_FROM_OP(opcode)      ((opcode & 0xF00) >> 8)
 #define GET_VY_FROM_OP(opcode)      ((opcode & 0x00F0) >> 4)
 
+#define SCROLL_COLUMNS              4
+
+// Display scrolling. Rows move as whole blocks of words and columns as word shifts
+// with a carry into the neighbouring word, never pixel by pixel
+
+static void scrollRowsDown(pixels::PackedPlane& plane, int height, int rows) {
+    rows = std::min(rows, height);
+
+    std::memmove(plane.data() + rows * pixels::ROW_WORDS, plane.data(),
+                 (height - rows) * pixels::ROW_WORDS * sizeof(pixels::PackedRow));
+    std::fill_n(plane.data(), rows * pixels::ROW_WORDS, 0);
+
+    return;
+}
+
+static void scrollRowsUp(pixels::PackedPlane& plane, int height, int rows) {
+    rows = std::min(rows, height);
+
+    std::memmove(plane.data(), plane.data() + rows * pixels::ROW_WORDS,
+                 (height - rows) * pixels::ROW_WORDS * sizeof(pixels::PackedRow));
+    std::fill_n(plane.data() + (height - rows) * pixels::ROW_WORDS, rows * pixels::ROW_WORDS, 0);
+
+    return;
+}
+
+static void scrollColumnsRight(pixels::PackedPlane& plane, bool hires, int columns) {
+    const int rowWords = pixels::getWidth(hires) / pixels::PACKED_ROW_BITS;
+
+    for(int row = 0; row < pixels::getHeight(hires); row++) {
+        pixels::PackedRow* words = &plane[row * pixels::ROW_WORDS];
+        pixels::PackedRow carry {};
+
+        for(int word = 0; word < rowWords; word++) {
+            pixels::PackedRow spill = words[word] << (pixels::PACKED_ROW_BITS - columns);
+            words[word] = (words[word] >> columns) | carry;
+            carry = spill;
+        }
+    }
+
+    return;
+}
+
+static void scrollColumnsLeft(pixels::PackedPlane& plane, bool hires, int columns) {
+    const int rowWords = pixels::getWidth(hires) / pixels::PACKED_ROW_BITS;
+
+    for(int row = 0; row < pixels::getHeight(hires); row++) {
+        pixels::PackedRow* words = &plane[row * pixels::ROW_WORDS];
+        pixels::PackedRow carry {};
+
+        for(int word = rowWords - 1; word >= 0; word--) {
+            pixels::PackedRow spill = words[word] >> (pixels::PACKED_ROW_BITS - columns);
+            words[word] = (words[word] << columns) | carry;
+            carry = spill;
+        }
+    }
+
+    return;
+}
+
+// Where DXYN lands on the packed display, worked out once for every plane it draws to
+typedef struct {
+    int y;
+    int height;
+    int rows;       // Rows to draw, already clipped unless sprites wrap
+    int word;       // Word holding the sprite's left edge
+    int shift;
+    int nextWord;   // Word the right part spills into, -1 when it's clipped
+}SpriteTarget;
+
+// XORs one plane's worth of sprite rows in, SPRITE_BYTES is 1 for DXYN and 2 for DXY0
+// Returns the bits that were already set
+template<int SPRITE_BYTES>
+static inline pixels::PackedRow drawSpriteRows(pixels::PackedPlane& screen, const unsigned char* memory,
+                                               unsigned short address, const SpriteTarget& target) {
+    constexpr int spriteWidth { SPRITE_BYTES * 8 };
+    const bool straddles { target.shift > pixels::PACKED_ROW_BITS - spriteWidth && target.nextWord >= 0 };
+    pixels::PackedRow collision {};
+
+    for(int yOffset = 0; yOffset < target.rows; yOffset++) {
+        pixels::PackedRow spriteBits {};
+        for(int byte = 0; byte < SPRITE_BYTES; byte++)
+            spriteBits = (spriteBits << 8) | memory[(address + yOffset * SPRITE_BYTES + byte) & (CHIP_8_MEM_SIZE - 1)];
+
+        pixels::PackedRow spriteRow = spriteBits << (pixels::PACKED_ROW_BITS - spriteWidth);
+
+        // Sprites are at most 16 rows, so a wrapped row only ever goes around once
+        int row { target.y + yOffset };
+        if(row >= target.height)
+            row -= target.height;
+
+        pixels::PackedRow* screenRow = &screen[row * pixels::ROW_WORDS];
+        collision |= screenRow[target.word] & (spriteRow >> target.shift);
+        screenRow[target.word] ^= spriteRow >> target.shift;
+
+        if(straddles) {
+            pixels::PackedRow spill = spriteRow << (pixels::PACKED_ROW_BITS - target.shift);
+            collision |= screenRow[target.nextWord] & spill;
+            screenRow[target.nextWord] ^= spill;
+        }
+    }
+
+    return collision;
+}
+
 // Opcode class functionality
 
-// Executes the opcodes
-void Opcodes::executeOpcode(unsigned short opcode, Chip8& chip8) {
-    // TODO: O(N) lookup -> Not efficient ; Hashmap implementation?
-    for(const auto &entry : opcodeLookup) {
-        if((opcode & entry.mask) == entry.opcode)
-        {
-            chip8.addProgramCounter(2);
-            entry.opcodeHandler(opcode, chip8);
-            break;
+// Fills a family table by matching every possible low index against opcodeLookup
+// Single opcode families pass N = 1 and get the handler for familyBase alone
+template<QuirkProfile PROFILE>
+template<size_t N>
+constexpr typename OpcodeCore<PROFILE>::template FamilyTable<N> OpcodeCore<PROFILE>::buildFamilyTable(unsigned short familyBase) {
+    FamilyTable<N> table {};
+
+    for(size_t index = 0; index < N; index++) {
+        unsigned short opcode = static_cast<unsigned short>(familyBase | index);
+        table[index] = &OpcodeCore::opUnknown;
+
+        for(const auto &entry : opcodeLookup) {
+            if(!quirks.xoExtensions && isExtension(entry.opcodeHandler))
+                continue;
+            if((opcode & entry.mask) == entry.opcode) {
+                table[index] = entry.opcodeHandler;
+                break;
+            }
         }
     }
 
+    return table;
+}
+
+// One handler per top nibble for the families that need no second level
+template<QuirkProfile PROFILE>
+constexpr typename OpcodeCore<PROFILE>::template FamilyTable<16> OpcodeCore<PROFILE>::buildSingleLookup() {
+    FamilyTable<16> table {};
+
+    for(size_t nibble = 0; nibble < table.size(); nibble++) {
+        table[nibble] = buildFamilyTable<1>(static_cast<unsigned short>(nibble << 12))[0];
+    }
+
+    return table;
+}
+
+template<QuirkProfile PROFILE>
+constexpr typename OpcodeCore<PROFILE>::template FamilyTable<16> OpcodeCore<PROFILE>::singleLookup = buildSingleLookup();
+template<QuirkProfile PROFILE>
+constexpr typename OpcodeCore<PROFILE>::template FamilyTable<0x100> OpcodeCore<PROFILE>::family0Lookup = buildFamilyTable<0x100>(0x0000);
+template<QuirkProfile PROFILE>
+constexpr typename OpcodeCore<PROFILE>::template FamilyTable<0x10> OpcodeCore<PROFILE>::family5Lookup = buildFamilyTable<0x10>(0x5000);
+template<QuirkProfile PROFILE>
+constexpr typename OpcodeCore<PROFILE>::template FamilyTable<0x10> OpcodeCore<PROFILE>::family8Lookup = buildFamilyTable<0x10>(0x8000);
+template<QuirkProfile PROFILE>
+constexpr typename OpcodeCore<PROFILE>::template FamilyTable<0x100> OpcodeCore<PROFILE>::familyELookup = buildFamilyTable<0x100>(0xE000);
+template<QuirkProfile PROFILE>
+constexpr typename OpcodeCore<PROFILE>::template FamilyTable<0x100> OpcodeCore<PROFILE>::familyFLookup = buildFamilyTable<0x100>(0xF000);
+
+template<QuirkProfile PROFILE>
+constexpr std::array<typename OpcodeCore<PROFILE>::OpcodeFamily, 16> OpcodeCore<PROFILE>::familyLookup {{
+    {family0Lookup.data(), 0xFF},
+    {&singleLookup[0x1], 0},
+    {&singleLookup[0x2], 0},
+    {&singleLookup[0x3], 0},
+    {&singleLookup[0x4], 0},
+    {family5Lookup.data(), 0xF},
+    {&singleLookup[0x6], 0},
+    {&singleLookup[0x7], 0},
+    {family8Lookup.data(), 0xF},
+    {&singleLookup[0x9], 0},
+    {&singleLookup[0xA], 0},
+    {&singleLookup[0xB], 0},
+    {&singleLookup[0xC], 0},
+    {&singleLookup[0xD], 0},
+    {familyELookup.data(), 0xFF},
+    {familyFLookup.data(), 0xFF}
+}};
+
+// Two indexed loads: family by top nibble, then handler by the family's low bits
+// The family 0 table only holds 00XX, anything from 0100 up is a machine code call
+template<QuirkProfile PROFILE>
+typename OpcodeCore<PROFILE>::OpcodeHandler OpcodeCore<PROFILE>::decodeOpcode(unsigned short opcode) {
+    if(opcode >= 0x0100 && opcode < 0x1000)
+        return &OpcodeCore::opUnknown;
+    // FX00 shares F000's slot in the family F table, only F000 itself loads I
+    if((opcode & 0xF0FF) == OP_LOAD_I_LONG_MASK && opcode != OP_LOAD_I_LONG_MASK)
+        return &OpcodeCore::opUnknown;
+
+    const OpcodeFamily& family = familyLookup[opcode >> 12];
+    return family.handlers[opcode & family.mask];
+}
+
+// Picks the profile's tables, the only place the profile is looked at per opcode
+Opcodes::OpcodeHandler Opcodes::decodeOpcode(unsigned short opcode, QuirkProfile profile) {
+    switch(profile) {
+        case QuirkProfile::Chip8:       return OpcodeCore<QuirkProfile::Chip8>::decodeOpcode(opcode);
+        case QuirkProfile::SuperChip:   return OpcodeCore<QuirkProfile::SuperChip>::decodeOpcode(opcode);
+        case QuirkProfile::XOChip:      return OpcodeCore<QuirkProfile::XOChip>::decodeOpcode(opcode);
+        default:                        return OpcodeCore<QuirkProfile::Default>::decodeOpcode(opcode);
+    }
+}
+
+// Resolves the handler and pulls out every operand field once
+Opcodes::Instruction Opcodes::decodeInstruction(unsigned short opcode, QuirkProfile profile) {
+    Instruction instruction {};
+
+    instruction.handler = decodeOpcode(opcode, profile);
+    instruction.opcode = opcode;
+    instruction.nnn = opcode & 0xFFF;
+    instruction.x = GET_VX_FROM_OP(opcode);
+    instruction.y = GET_VY_FROM_OP(opcode);
+    instruction.n = opcode & 0xF;
+    instruction.nn = opcode & 0xFF;
+
+    return instruction;
+}
+
+// Executes the opcodes
+void Opcodes::executeOpcode(unsigned short opcode, Chip8& chip8) {
+    const Instruction instruction = decodeInstruction(opcode, chip8.getQuirkProfile());
+
+    chip8.addProgramCounter(2);
+    instruction.handler(instruction, chip8);
+
     return;
 }
 
 // Clears the screen
-void Opcodes::opClearScreen(unsigned short opcode, Chip8& chip8) {
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opClearScreen(const Instruction& instruction, Chip8& chip8) {
+    for(int plane = 0; plane < pixels::PLANE_COUNT; plane++) {
+        if(chip8.planeMask & (1 << plane))
+            chip8.pixels[plane].fill(0);
+    }
+    chip8.markDisplayWrite();
 
-    for (size_t height_index = 0; height_index < pixels::DISPLAY_HEIGHT; height_index++) {
-        for (size_t width_index = 0; width_index < pixels::DISPLAY_WIDTH; width_index++) {
-            chip8.pixels[height_index][width_index] = pixels::BLACK_PIXEL;
-        }
+    return;
+}
+
+// Scrolls the selected planes down N rows
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opScrollDown(const Instruction& instruction, Chip8& chip8) {
+    for(int plane = 0; plane < pixels::PLANE_COUNT; plane++) {
+        if(chip8.planeMask & (1 << plane))
+            scrollRowsDown(chip8.pixels[plane], pixels::getHeight(chip8.hires), instruction.n);
+    }
+    chip8.markDisplayWrite();
+
+    return;
+}
+
+// Scrolls the selected planes up N rows (XO-CHIP)
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opScrollUp(const Instruction& instruction, Chip8& chip8) {
+    for(int plane = 0; plane < pixels::PLANE_COUNT; plane++) {
+        if(chip8.planeMask & (1 << plane))
+            scrollRowsUp(chip8.pixels[plane], pixels::getHeight(chip8.hires), instruction.n);
     }
+    chip8.markDisplayWrite();
+
+    return;
+}
+
+// Scrolls the selected planes 4 columns right
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opScrollRight(const Instruction& instruction, Chip8& chip8) {
+    for(int plane = 0; plane < pixels::PLANE_COUNT; plane++) {
+        if(chip8.planeMask & (1 << plane))
+            scrollColumnsRight(chip8.pixels[plane], chip8.hires, SCROLL_COLUMNS);
+    }
+    chip8.markDisplayWrite();
+
+    return;
+}
+
+// Scrolls the selected planes 4 columns left
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opScrollLeft(const Instruction& instruction, Chip8& chip8) {
+    for(int plane = 0; plane < pixels::PLANE_COUNT; plane++) {
+        if(chip8.planeMask & (1 << plane))
+            scrollColumnsLeft(chip8.pixels[plane], chip8.hires, SCROLL_COLUMNS);
+    }
+    chip8.markDisplayWrite();
+
+    return;
+}
+
+// Exits the interpreter. There's nothing to exit to, so the machine parks on this instruction
+// Parked for good, the CPU core skips the rest of the slice like it does for FX0A
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opExit(const Instruction& instruction, Chip8& chip8) {
+    chip8.setProgramCounter(chip8.PC - 2);
+    chip8.idlePeriod = 1;
+
+    return;
+}
+
+// Back to 64x32, the switch clears every plane
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLowRes(const Instruction& instruction, Chip8& chip8) {
+    chip8.hires = false;
+    for(pixels::PackedPlane& plane : chip8.pixels)
+        plane.fill(0);
+    chip8.markDisplayWrite();
+
+    return;
+}
+
+// 128x64, the switch clears every plane
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opHighRes(const Instruction& instruction, Chip8& chip8) {
+    chip8.hires = true;
+    for(pixels::PackedPlane& plane : chip8.pixels)
+        plane.fill(0);
+    chip8.markDisplayWrite();
 
     return;
 }
 
 // Returns from subroutine
-void Opcodes::opReturnFromSub(unsigned short opcode, Chip8& chip8) {
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opReturnFromSub(const Instruction& instruction, Chip8& chip8) {
+    // Nothing to return to, carry on with the next instruction
+    if(chip8.SP == 0 || chip8.SP > STACK_SIZE)
+        return;
+
     chip8.setProgramCounter(chip8.stack[chip8.SP-1]);
     chip8.SP--;
 
@@ -43,115 +337,188 @@ void Opcodes::opReturnFromSub(unsigned short opcode, Chip8& chip8) {
 }
 
 // This opcode is kinda wack. Not sure how this would affect stack usage
-void Opcodes::opCallMchnCode(unsigned short opcode, Chip8& chip8) {
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opCallMchnCode(const Instruction& instruction, Chip8& chip8) {
     unsigned short addr {};
     unsigned short nextOpcode {};
-    addr = (opcode & 0xFFF);
+    addr = instruction.nnn;
     nextOpcode = chip8.getMachineCode(addr);
 
     // TODO: Fix this being called as a public function
     //       Could result in corrupt data?
-    executeOpcode(nextOpcode, chip8);
+    Opcodes::executeOpcode(nextOpcode, chip8);
 
     return;
 }
 
 // Jumps to address
-void Opcodes::opJumpAddr(unsigned short opcode, Chip8& chip8) {
-    chip8.setProgramCounter(opcode & 0xFFF);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opJumpAddr(const Instruction& instruction, Chip8& chip8) {
+    // Backward jumps close loops, PC is already past this one
+    if(instruction.nnn <= chip8.PC - 2)
+        chip8.probeLoop(instruction.nnn);
+
+    chip8.setProgramCounter(instruction.nnn);
 
     return;
 }
 
 // Calls subroutine
-void Opcodes::opCallSub(unsigned short opcode, Chip8& chip8) {
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opCallSub(const Instruction& instruction, Chip8& chip8) {
+    // Stack is full, the call is dropped rather than written past it
+    if(chip8.SP >= STACK_SIZE)
+        return;
+
     chip8.stack[chip8.SP] = chip8.PC;
     chip8.SP++;
-    chip8.setProgramCounter(opcode & 0xFFF);
+    chip8.setProgramCounter(instruction.nnn);
+
+    return;
+}
+
+// Steps over the next instruction, F000 NNNN is two words long under XO-CHIP
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::skipNext(Chip8& chip8) {
+    if constexpr (quirks.xoExtensions) {
+        const unsigned short next = chip8.getProgramCounter();
+        if(chip8.memory[next & (CHIP_8_MEM_SIZE - 1)] == 0xF0 && chip8.memory[(next + 1) & (CHIP_8_MEM_SIZE - 1)] == 0x00)
+            chip8.addProgramCounter(2);
+    }
+
+    chip8.addProgramCounter(2);
 
     return;
 }
 
 // Skips next instruction if Vx == NN
-void Opcodes::opSEVx(unsigned short opcode, Chip8& chip8) {
-    if(chip8.getRegisterValue((opcode & 0x0F00) >> 8) == (opcode & 0xFF))
-        chip8.addProgramCounter(2);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opSEVx(const Instruction& instruction, Chip8& chip8) {
+    if(chip8.getRegisterValue(instruction.x) == instruction.nn)
+        skipNext(chip8);
     
     return;
 }
 
 // Skips next instruction if Vx != NN
-void Opcodes::opSNEVx(unsigned short opcode, Chip8& chip8) {
-    if(chip8.getRegisterValue((opcode & 0x0F00) >> 8) != (opcode & 0xFF))
-        chip8.addProgramCounter(2);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opSNEVx(const Instruction& instruction, Chip8& chip8) {
+    if(chip8.getRegisterValue(instruction.x) != instruction.nn)
+        skipNext(chip8);
 
     return;
 }
 
 // Skips next instruction if Vx == Vy
-void Opcodes::opSEVxVy(unsigned short opcode, Chip8& chip8) {
-    if(chip8.getRegisterValue((opcode & 0x0F00) >> 8) == chip8.getRegisterValue(GET_VY_FROM_OP(opcode)))
-        chip8.addProgramCounter(2);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opSEVxVy(const Instruction& instruction, Chip8& chip8) {
+    if(chip8.getRegisterValue(instruction.x) == chip8.getRegisterValue(instruction.y))
+        skipNext(chip8);
+
+    return;
+}
+
+// Stores Vx through Vy in memory starting at I, in either order, I is left alone (XO-CHIP)
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opStoreRange(const Instruction& instruction, Chip8& chip8) {
+    const int step = instruction.x <= instruction.y ? 1 : -1;
+    const unsigned short length = Opcodes::rangeLength(instruction.opcode);
+    const unsigned short address = chip8.I & (CHIP_8_MEM_SIZE - 1);
+
+    for(unsigned short index = 0; index < length; index++) {
+        chip8.memory[(address + index) & (CHIP_8_MEM_SIZE - 1)] = chip8.getRegisterValue(instruction.x + step * index);
+    }
+    chip8.onMemoryWrite(address, length);
+
+    return;
+}
+
+// Loads Vx through Vy from memory starting at I, in either order, I is left alone (XO-CHIP)
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadRange(const Instruction& instruction, Chip8& chip8) {
+    const int step = instruction.x <= instruction.y ? 1 : -1;
+    const unsigned short length = Opcodes::rangeLength(instruction.opcode);
+
+    for(unsigned short index = 0; index < length; index++) {
+        chip8.setRegisterValue(instruction.x + step * index, chip8.memory[(chip8.I + index) & (CHIP_8_MEM_SIZE - 1)]);
+    }
 
     return;
 }
 
 // Loads NN into Vx
-void Opcodes::opLoadVx(unsigned short opcode, Chip8& chip8) {
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), opcode & 0xFF);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadVx(const Instruction& instruction, Chip8& chip8) {
+    chip8.setRegisterValue(instruction.x, instruction.nn);
     
     return;
 }
 
 // Adds (opcodoe & 0xFF) to Vx
-void Opcodes::opAddVx(unsigned short opcode, Chip8& chip8) {
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opAddVx(const Instruction& instruction, Chip8& chip8) {
     // Consider removing this char for optimization
     // Decreases readability but will marginally increase speed
-    unsigned char registerNumber { static_cast<unsigned char>(GET_VX_FROM_OP(opcode)) };
-    chip8.setRegisterValue(registerNumber, chip8.getRegisterValue(registerNumber) + (opcode & 0xFF));
+    unsigned char registerNumber { static_cast<unsigned char>(instruction.x) };
+    chip8.setRegisterValue(registerNumber, chip8.getRegisterValue(registerNumber) + instruction.nn);
     
     return;
 }
 
 // Loads Vx to Vy
-void Opcodes::opLoadVxVy(unsigned short opcode, Chip8& chip8) {
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), chip8.getRegisterValue(GET_VY_FROM_OP(opcode)));
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadVxVy(const Instruction& instruction, Chip8& chip8) {
+    chip8.setRegisterValue(instruction.x, chip8.getRegisterValue(instruction.y));
     
     return;
 }
 
 // Loads Vx to Vx |= Vy
-void Opcodes::opLoadORVxVy(unsigned short opcode, Chip8& chip8) {
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), 
-                            chip8.getRegisterValue(GET_VX_FROM_OP(opcode)) | chip8.getRegisterValue(GET_VY_FROM_OP(opcode)));
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadORVxVy(const Instruction& instruction, Chip8& chip8) {
+    chip8.setRegisterValue(instruction.x, 
+                            chip8.getRegisterValue(instruction.x) | chip8.getRegisterValue(instruction.y));
+
+    if constexpr (quirks.logicResetsVF)
+        chip8.v[0xF] = 0;
     
     return;
 }
 
 // Loads Vx to Vx &= Vy
-void Opcodes::opLoadANDVxVy(unsigned short opcode, Chip8& chip8) {
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), 
-                            chip8.getRegisterValue(GET_VX_FROM_OP(opcode)) & chip8.getRegisterValue(GET_VY_FROM_OP(opcode)));
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadANDVxVy(const Instruction& instruction, Chip8& chip8) {
+    chip8.setRegisterValue(instruction.x, 
+                            chip8.getRegisterValue(instruction.x) & chip8.getRegisterValue(instruction.y));
+
+    if constexpr (quirks.logicResetsVF)
+        chip8.v[0xF] = 0;
 
     return;
 }
 
 // Loads Vx to Vx ^= Vy
-void Opcodes::opLoadXORVxVy(unsigned short opcode, Chip8&chip8) {
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), 
-                            chip8.getRegisterValue(GET_VX_FROM_OP(opcode)) ^ chip8.getRegisterValue(GET_VY_FROM_OP(opcode)));
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadXORVxVy(const Instruction& instruction, Chip8& chip8) {
+    chip8.setRegisterValue(instruction.x, 
+                            chip8.getRegisterValue(instruction.x) ^ chip8.getRegisterValue(instruction.y));
+
+    if constexpr (quirks.logicResetsVF)
+        chip8.v[0xF] = 0;
+
     return;
 }
 
 // Loads Vx to Vx += Vy. Vf = 1 if an overflow is detected, 0 otherwise
 // TODO: Ignore addition when overflow? or not?
-void Opcodes::opLoadADDVxVy(unsigned short opcode, Chip8& chip8) {
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadADDVxVy(const Instruction& instruction, Chip8& chip8) {
     // Not the most memory efficient if using continually on embedded system
-    int vxValue = chip8.getRegisterValue(GET_VX_FROM_OP(opcode));
-    int vyValue = chip8.getRegisterValue(GET_VY_FROM_OP(opcode));
+    int vxValue = chip8.getRegisterValue(instruction.x);
+    int vyValue = chip8.getRegisterValue(instruction.y);
     int registerValue = static_cast<int>(vxValue + vyValue);
 
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), static_cast<unsigned char>(registerValue));
+    chip8.setRegisterValue(instruction.x, static_cast<unsigned char>(registerValue));
 
     chip8.setOverflowRegister(registerValue > 255);
     
@@ -159,13 +526,14 @@ void Opcodes::opLoadADDVxVy(unsigned short opcode, Chip8& chip8) {
 }
 
 // Loads Vx to Vx -= Vy. Vf = 0 if an underflow is detected, 1 otherwise
-void Opcodes::opLoadSUBVxVy(unsigned short opcode, Chip8& chip8) {
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadSUBVxVy(const Instruction& instruction, Chip8& chip8) {
     // Not the most memory efficient if using continually on embedded system
-    unsigned char vxValue = chip8.getRegisterValue(GET_VX_FROM_OP(opcode));
-    unsigned char vyValue = chip8.getRegisterValue(GET_VY_FROM_OP(opcode));
+    unsigned char vxValue = chip8.getRegisterValue(instruction.x);
+    unsigned char vyValue = chip8.getRegisterValue(instruction.y);
     unsigned char registerValue = static_cast<unsigned char>(vxValue - vyValue);
 
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), registerValue);
+    chip8.setRegisterValue(instruction.x, registerValue);
 
     chip8.setOverflowRegister(vyValue <= vxValue);
 
@@ -173,23 +541,26 @@ void Opcodes::opLoadSUBVxVy(unsigned short opcode, Chip8& chip8) {
 }
 
 // Shifts Vx right by one. Stores the least significant bit prior to shift in Vf
-void Opcodes::opLoadShiftRightVx(unsigned short opcode, Chip8& chip8) {
-    unsigned char registerValue = chip8.getRegisterValue(GET_VX_FROM_OP(opcode));
+// The COSMAC VIP shifts Vy into Vx instead
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadShiftRightVx(const Instruction& instruction, Chip8& chip8) {
+    unsigned char registerValue = chip8.getRegisterValue(quirks.shiftUsesVy ? instruction.y : instruction.x);
 
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), registerValue >> 1);
+    chip8.setRegisterValue(instruction.x, registerValue >> 1);
     chip8.setOverflowRegister(registerValue & 0x1); // Store least significant bit
 
     return;
 }
 
 // Loads Vx to Vy - Vx. Vf = 0 if an underflow is detected, 1 otherwise
-void Opcodes::opLoadSUBVyVx(unsigned short opcode, Chip8& chip8) {
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadSUBVyVx(const Instruction& instruction, Chip8& chip8) {
     // Not the most memory efficient if using continually on embedded system
-    unsigned char vxValue = chip8.getRegisterValue(GET_VX_FROM_OP(opcode));
-    unsigned char vyValue = chip8.getRegisterValue(GET_VY_FROM_OP(opcode));
+    unsigned char vxValue = chip8.getRegisterValue(instruction.x);
+    unsigned char vyValue = chip8.getRegisterValue(instruction.y);
     unsigned char registerValue = static_cast<unsigned char>(vyValue - vxValue);
 
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), registerValue);
+    chip8.setRegisterValue(instruction.x, registerValue);
 
     chip8.setOverflowRegister(vyValue >= vxValue);
 
@@ -197,158 +568,336 @@ void Opcodes::opLoadSUBVyVx(unsigned short opcode, Chip8& chip8) {
 }
 
 // Shifts Vx left by one. Stores the most significant bit prior to shift in Vf
-void Opcodes::opLoadShiftLeftVx(unsigned short opcode, Chip8& chip8) {
-    unsigned char registerValue = chip8.getRegisterValue(GET_VX_FROM_OP(opcode));
+// The COSMAC VIP shifts Vy into Vx instead
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadShiftLeftVx(const Instruction& instruction, Chip8& chip8) {
+    unsigned char registerValue = chip8.getRegisterValue(quirks.shiftUsesVy ? instruction.y : instruction.x);
 
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), static_cast<char>(registerValue << 1));
+    chip8.setRegisterValue(instruction.x, static_cast<char>(registerValue << 1));
     chip8.setOverflowRegister((registerValue & 0x80) >> 7); // Store most significant bit
     
     return;
 }
 
 // Skips next instruction if Vx != Vy
-void Opcodes::opSNEVxVy(unsigned short opcode, Chip8& chip8) {
-    if(chip8.getRegisterValue(GET_VX_FROM_OP(opcode)) != chip8.getRegisterValue(GET_VY_FROM_OP(opcode)))
-        chip8.addProgramCounter(2);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opSNEVxVy(const Instruction& instruction, Chip8& chip8) {
+    if(chip8.getRegisterValue(instruction.x) != chip8.getRegisterValue(instruction.y))
+        skipNext(chip8);
 
     return;
 }
 
 // Loads (opcode & 0xFFF) to I
-void Opcodes::opLoadI(unsigned short opcode, Chip8& chip8) {
-    chip8.setI(opcode & 0xFFF);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadI(const Instruction& instruction, Chip8& chip8) {
+    chip8.setI(instruction.nnn);
     return;
 }
 
-void Opcodes::opJumpAddrV0(unsigned short opcode, Chip8& chip8) {
+// Jumps to NNN + V0, SUPER-CHIP reads it as XNN + Vx
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opJumpAddrV0(const Instruction& instruction, Chip8& chip8) {
+    unsigned char offsetRegister { quirks.jumpUsesVx ? instruction.x : static_cast<unsigned char>(0) };
+
+    chip8.setProgramCounter(instruction.nnn + chip8.v[offsetRegister]);
+
     return;
 }
 
-void Opcodes::opLoadVxRand(unsigned short opcode, Chip8& chip8) {
+// Loads Vx with a random byte AND kk
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadVxRand(const Instruction& instruction, Chip8& chip8) {
+    chip8.v[instruction.x] = chip8.nextRandom() & instruction.nn;
     return;
 }
 
-// Draws a sprite at (Vx,Vy) that is N pixels tall
-// TODO: Optimize this, it sucks lol
-void Opcodes::opDrawSprite(unsigned short opcode, Chip8& chip8) {
+// DXYN with low resolution and only plane 1 selected, a single word per row
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::drawLoresSprite(const Instruction& instruction, Chip8& chip8) {
     // Extract X and Y coordinates from registers
-    unsigned char x { static_cast<unsigned char>(chip8.getRegisterValue((opcode & 0x0F00) >> 8) % pixels::DISPLAY_WIDTH) };
-    unsigned char y { static_cast<unsigned char>(chip8.getRegisterValue((opcode & 0x00F0) >> 4) % pixels::DISPLAY_HEIGHT) };
-    unsigned char spriteHeight { static_cast<unsigned char>(opcode & 0xF) };
-    unsigned short spriteAddr { chip8.I };
-    
-    // Reset collision flag (VF)
-    chip8.setRegisterValue(0xF, 0);
-    
+    unsigned char x { static_cast<unsigned char>(chip8.getRegisterValue(instruction.x) % pixels::DISPLAY_WIDTH) };
+    unsigned char y { static_cast<unsigned char>(chip8.getRegisterValue(instruction.y) % pixels::DISPLAY_HEIGHT) };
+
+    // Clipped: rows past the bottom are dropped, columns past the right edge fall off the shift
+    // Wrapped: rows continue at the top, columns rotate back in on the left
+    unsigned char spriteHeight { quirks.wrapSprites ? instruction.n :
+                                 static_cast<unsigned char>(std::min<int>(instruction.n, pixels::DISPLAY_HEIGHT - y)) };
+    pixels::PackedPlane& plane = chip8.pixels[0];
+    pixels::PackedRow collision {};
+
     for (unsigned char yOffset = 0; yOffset < spriteHeight; yOffset++) {
-        if (y + yOffset >= pixels::DISPLAY_HEIGHT) break; // Don't draw past screen
-        
-        unsigned char spriteByte = chip8.memory[spriteAddr];
-        
-        // Draw a byte at a time
-        for (unsigned char xOffset = 0; xOffset < 8; xOffset++) {
-            if (x + xOffset >= pixels::DISPLAY_WIDTH) break; // Don't draw past right edge
-            
-            unsigned int& screenPixel = chip8.pixels[y + yOffset][x + xOffset];
-
-            bool pixelSet = (spriteByte & (0x80 >> xOffset));
-
-            // Only mess with pixels that are 1 in the sprite
-            if(pixelSet)
-            {
-                // If pixel was set, then collision has occured (VF = 1)
-                if(screenPixel == pixels::WHITE_PIXEL)
-                    chip8.setRegisterValue(0xF, 1);
-                
-                // XOR with the screen
-                // TODO: Find a way to utilize bitwise ^= instead
-                screenPixel = (screenPixel == pixels::WHITE_PIXEL) ? pixels::BLACK_PIXEL : pixels::WHITE_PIXEL;
-            }
+        unsigned char spriteByte = chip8.memory[(chip8.I + yOffset) & (CHIP_8_MEM_SIZE - 1)];
+        pixels::PackedRow spriteRow = (static_cast<pixels::PackedRow>(spriteByte) << (pixels::PACKED_ROW_BITS - 8)) >> x;
+        pixels::PackedRow& screenRow = plane[((y + yOffset) % pixels::DISPLAY_HEIGHT) * pixels::ROW_WORDS];
+
+        if constexpr (quirks.wrapSprites) {
+            if(x > pixels::DISPLAY_WIDTH - 8)
+                spriteRow |= static_cast<pixels::PackedRow>(spriteByte) << (pixels::PACKED_ROW_BITS - 8 + pixels::DISPLAY_WIDTH - x);
         }
 
-        spriteAddr++;
+        collision |= screenRow & spriteRow;
+        screenRow ^= spriteRow;
     }
+
+    chip8.markDisplayWrite();
+    PROFILE_DRAW(collision != 0);
+
+    // If any pixel was already set, a collision has occured (VF = 1)
+    chip8.setRegisterValue(0xF, collision != 0);
+
+    return;
+}
+
+// Draws a sprite at (Vx,Vy) that is N pixels tall, DXY0 draws a 16x16 sprite instead
+// Each sprite row is one shift and one XOR into a packed display word, plus a second
+// pair when the sprite straddles two words
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opDrawSprite(const Instruction& instruction, Chip8& chip8) {
+    // Plain low resolution sprite on the first plane, what nearly every ROM draws
+    if(!chip8.hires && chip8.planeMask == 1 && instruction.n != 0) {
+        drawLoresSprite(instruction, chip8);
+        return;
+    }
+
+    const int width { pixels::getWidth(chip8.hires) };
+    const int height { pixels::getHeight(chip8.hires) };
+
+    // Extract X and Y coordinates from registers, both sizes are powers of two
+    unsigned char x { static_cast<unsigned char>(chip8.getRegisterValue(instruction.x) & (width - 1)) };
+    unsigned char y { static_cast<unsigned char>(chip8.getRegisterValue(instruction.y) & (height - 1)) };
+
+    const int spriteRows { (instruction.n == 0) ? 16 : instruction.n };
+
+    // Clipped: rows past the bottom are dropped, columns past the right edge fall off the shift
+    // Wrapped: rows continue at the top, columns spill into the leftmost word
+    SpriteTarget target {};
+    target.y = y;
+    target.height = height;
+    target.rows = quirks.wrapSprites ? spriteRows : std::min(spriteRows, height - y);
+    target.word = x / pixels::PACKED_ROW_BITS;
+    target.shift = x % pixels::PACKED_ROW_BITS;
+    target.nextWord = (target.word + 1 < width / pixels::PACKED_ROW_BITS) ? target.word + 1 : (quirks.wrapSprites ? 0 : -1);
+
+    unsigned short address { chip8.I };
+    pixels::PackedRow collision {};
+
+    // Every selected plane takes the next sprite's worth of data
+    for(int plane = 0; plane < pixels::PLANE_COUNT; plane++) {
+        if(!(chip8.planeMask & (1 << plane)))
+            continue;
+
+        if(instruction.n == 0) {
+            collision |= drawSpriteRows<2>(chip8.pixels[plane], chip8.memory, address, target);
+            address += spriteRows * 2;
+        }
+        else {
+            collision |= drawSpriteRows<1>(chip8.pixels[plane], chip8.memory, address, target);
+            address += spriteRows;
+        }
+    }
+
+    chip8.markDisplayWrite();
+    PROFILE_DRAW(collision != 0);
+
+    // If any pixel was already set, a collision has occured (VF = 1)
+    chip8.setRegisterValue(0xF, collision != 0);
+
+    return;
 }
 
 // Skips next instruction if key in Vx is pressed
-void Opcodes::opSEKey(unsigned short opcode, Chip8& chip8) {
-    if((chip8.v[GET_VX_FROM_OP(opcode)] & 0xF) == chip8.key_pressed)
-        chip8.addProgramCounter(2);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opSEKey(const Instruction& instruction, Chip8& chip8) {
+    if(chip8.getKeyMask() & (1 << (chip8.v[instruction.x] & 0xF)))
+        skipNext(chip8);
 
     return;
 }
 
 // Skips next instruction if key in Vx is not pressed
-void Opcodes::opSNEKey(unsigned short opcode, Chip8& chip8) {
-    if((chip8.v[GET_VX_FROM_OP(opcode)] & 0xF) != chip8.key_pressed)
-        chip8.addProgramCounter(2);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opSNEKey(const Instruction& instruction, Chip8& chip8) {
+    if(!(chip8.getKeyMask() & (1 << (chip8.v[instruction.x] & 0xF))))
+        skipNext(chip8);
     
     return;
 }
 
+// Loads the 16 bit word after the opcode into I and steps over it (XO-CHIP)
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadILong(const Instruction& instruction, Chip8& chip8) {
+    const unsigned short address = chip8.getProgramCounter();
+
+    chip8.setI(GET_OPCODE(chip8.memory[address & (CHIP_8_MEM_SIZE - 1)], chip8.memory[(address + 1) & (CHIP_8_MEM_SIZE - 1)]));
+    chip8.addProgramCounter(2);
+
+    return;
+}
+
+// Picks which bitplanes draws, clears and scrolls touch (XO-CHIP)
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opSelectPlanes(const Instruction& instruction, Chip8& chip8) {
+    chip8.planeMask = instruction.x & ((1 << pixels::PLANE_COUNT) - 1);
+
+    return;
+}
+
+// Loads the 16 byte XO-CHIP audio pattern from I
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadAudioPattern(const Instruction& instruction, Chip8& chip8) {
+    for(unsigned char index = 0; index < AUDIO_PATTERN_SIZE; index++)
+        chip8.audioPattern[index] = chip8.memory[(chip8.I + index) & (CHIP_8_MEM_SIZE - 1)];
+    chip8.writeCount++;
+
+    return;
+}
+
 // Loads Vx to value of delay timer
-void Opcodes::opLoadVxDelay(unsigned short opcode, Chip8& chip8) {
-    chip8.setRegisterValue(GET_VX_FROM_OP(opcode), chip8.delay_timer);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadVxDelay(const Instruction& instruction, Chip8& chip8) {
+    chip8.setRegisterValue(instruction.x, chip8.delay_timer);
     
     return;
 }
 
-void Opcodes::opLoadVxKey(unsigned short opcode, Chip8& chip8) {
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadVxKey(const Instruction& instruction, Chip8& chip8) {
+    const unsigned short mask { chip8.getKeyMask() };
+
+    if(!chip8.keyWaiting) {
+        chip8.keyWaiting = true;
+        chip8.keyWaitIgnored = mask;
+        chip8.keyWaitKey = KEY_WAIT_NONE;
+    }
+
+    // Released keys can be pressed again, the lowest numbered new press wins
+    chip8.keyWaitIgnored &= mask;
+    const unsigned short pressed = mask & ~chip8.keyWaitIgnored;
+    if(chip8.keyWaitKey == KEY_WAIT_NONE && pressed != 0) {
+        unsigned char key {};
+        while(!(pressed & (1 << key)))
+            key++;
+        chip8.keyWaitKey = key;
+    }
+
+    // Like the VIP, the key counts once it's let go again
+    if(chip8.keyWaitKey != KEY_WAIT_NONE && !(mask & (1 << chip8.keyWaitKey))) {
+        chip8.v[instruction.x] = chip8.keyWaitKey;
+        chip8.keyWaiting = false;
+        chip8.keyWaitKey = KEY_WAIT_NONE;
+        return;
+    }
+
+    // Stay on FX0A, nothing can change until the next slice so the CPU core skips the rest of it
+    chip8.setProgramCounter(chip8.PC - 2);
+    chip8.idlePeriod = 1;
+
     return;
 }
 
 // Sets delay timer to Vx
-void Opcodes::opLoadDelayToVx(unsigned short opcode, Chip8& chip8) {
-    chip8.delay_timer = chip8.v[GET_VX_FROM_OP(opcode)];
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadDelayToVx(const Instruction& instruction, Chip8& chip8) {
+    chip8.delay_timer = chip8.v[instruction.x];
     return;
 }
 
 // Set sound timer to Vx
-void Opcodes::opLoadSoundToVx(unsigned short opcode, Chip8& chip8) {
-    chip8.sound_timer = chip8.v[GET_VX_FROM_OP(opcode)];
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadSoundToVx(const Instruction& instruction, Chip8& chip8) {
+    chip8.sound_timer = chip8.v[instruction.x];
     return;
 }
 
 // Loads I to I += Vx
-void Opcodes::opLoadIVx(unsigned short opcode, Chip8& chip8) {
-    chip8.setI(chip8.I + chip8.getRegisterValue(GET_VX_FROM_OP(opcode)));
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadIVx(const Instruction& instruction, Chip8& chip8) {
+    chip8.setI(chip8.I + chip8.getRegisterValue(instruction.x));
+
+    return;
+}
+
+// Points I at the 4x5 font sprite for the low nibble of Vx
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadISpriteAddr(const Instruction& instruction, Chip8& chip8) {
+    chip8.setI(FONT_START + (chip8.v[instruction.x] & 0xF) * FONT_CHAR_SIZE);
+
+    return;
+}
+
+// Points I at the 8x10 font sprite for the low nibble of Vx
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadIBigSpriteAddr(const Instruction& instruction, Chip8& chip8) {
+    chip8.setI(HIRES_FONT_START + (chip8.v[instruction.x] & 0xF) * HIRES_FONT_CHAR_SIZE);
 
     return;
 }
 
-void Opcodes::opLoadISpriteAddr(unsigned short opcode, Chip8& chip8) {
+// Sets the XO-CHIP pattern playback rate to 4000*2^((Vx-64)/48) bits per second
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadPitch(const Instruction& instruction, Chip8& chip8) {
+    chip8.audioPitch = chip8.v[instruction.x];
+
     return;
 }
 
 // Stores the binary-coded decimal of Vx in memory
-void Opcodes::opLoadBCDVx(unsigned short opcode, Chip8& chip8) {
-    unsigned char registerValue = chip8.getRegisterValue(GET_VX_FROM_OP(opcode));
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadBCDVx(const Instruction& instruction, Chip8& chip8) {
+    unsigned char registerValue = chip8.getRegisterValue(instruction.x);
+
+    const unsigned short address = chip8.I & (CHIP_8_MEM_SIZE - 1);
 
-    chip8.memory[chip8.I] = (registerValue / 100) % 10;
-    chip8.memory[chip8.I + 1] = (registerValue / 10) % 10;
-    chip8.memory[chip8.I + 2] = registerValue % 10;
+    // Wraps past the end of memory like sprite reads do
+    chip8.memory[address] = (registerValue / 100) % 10;
+    chip8.memory[(address + 1) & (CHIP_8_MEM_SIZE - 1)] = (registerValue / 10) % 10;
+    chip8.memory[(address + 2) & (CHIP_8_MEM_SIZE - 1)] = registerValue % 10;
+    chip8.onMemoryWrite(address, 3);
 
     return;
 }
 
 // Stores registers in memory starting at I 
-void Opcodes::opStoreRegisterValues(unsigned short opcode, Chip8& chip8) {
-    unsigned char maxRegister = GET_VX_FROM_OP(opcode);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opStoreRegisterValues(const Instruction& instruction, Chip8& chip8) {
+    unsigned char maxRegister = instruction.x;
+    const unsigned short address = chip8.I & (CHIP_8_MEM_SIZE - 1);
 
     for (unsigned char index = 0; index <= maxRegister; ++index) {
-        chip8.memory[chip8.I + index] = chip8.getRegisterValue(index);
+        chip8.memory[(address + index) & (CHIP_8_MEM_SIZE - 1)] = chip8.getRegisterValue(index);
     }
+    chip8.onMemoryWrite(address, maxRegister + 1);
+
+    if constexpr (quirks.incrementI)
+        chip8.setI(chip8.I + maxRegister + 1);
 
     return;
 }
 
 // Load registers with memory starting at I
-void Opcodes::opLoadRegisterValues(unsigned short opcode, Chip8& chip8) {
-    unsigned char maxRegister = GET_VX_FROM_OP(opcode);
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opLoadRegisterValues(const Instruction& instruction, Chip8& chip8) {
+    unsigned char maxRegister = instruction.x;
 
     for (unsigned char index = 0; index <= maxRegister; ++index) {
-        chip8.setRegisterValue(index, chip8.memory[chip8.I + index]);
+        chip8.setRegisterValue(index, chip8.memory[(chip8.I + index) & (CHIP_8_MEM_SIZE - 1)]);
     }
 
+    if constexpr (quirks.incrementI)
+        chip8.setI(chip8.I + maxRegister + 1);
+
     return;
 }
+
+// Opcodes with no handler are skipped
+template<QuirkProfile PROFILE>
+void OpcodeCore<PROFILE>::opUnknown(const Instruction& instruction, Chip8& chip8) {
+    return;
+}
+
+// Every profile the decoder can hand out
+template class OpcodeCore<QuirkProfile::Default>;
+template class OpcodeCore<QuirkProfile::Chip8>;
+template class OpcodeCore<QuirkProfile::SuperChip>;
+template class OpcodeCore<QuirkProfile::XOChip>;
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cstring>
+#include "pixel_expand.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PIXEL_EXPAND_X86
+#endif
+
+namespace pixels {
+
+typedef void(*RowExpander)(PackedRow row, Pixel* output);
+
+// Every expander turns one 64 pixel word of the first plane into black and white
+static void expandRowScalar(PackedRow row, Pixel* output) {
+    for(int column = 0; column < PACKED_ROW_BITS; column++) {
+        bool pixelSet = (row >> (PACKED_ROW_BITS - 1 - column)) & 0x1;
+        output[column] = static_cast<Pixel>(pixelSet ? WHITE_PIXEL : BLACK_PIXEL);
+    }
+
+    return;
+}
+
+#ifdef PIXEL_EXPAND_X86
+// Each lane tests one bit of a broadcast byte, then turns the compare mask into a colour
+// Both colours share the alpha byte so the blend is BLACK | (mask & (WHITE ^ BLACK))
+static void expandRowSSE2(PackedRow row, Pixel* output) {
+    const __m128i highBits = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+    const __m128i lowBits = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+    const __m128i black = _mm_set1_epi32(static_cast<int>(BLACK_PIXEL));
+    const __m128i colour = _mm_set1_epi32(static_cast<int>(WHITE_PIXEL ^ BLACK_PIXEL));
+
+    for(int byteIndex = 0; byteIndex < PACKED_ROW_BITS / 8; byteIndex++) {
+        __m128i byte = _mm_set1_epi32(static_cast<int>((row >> (PACKED_ROW_BITS - 8 - byteIndex * 8)) & 0xFF));
+        __m128i high = _mm_cmpeq_epi32(_mm_and_si128(byte, highBits), highBits);
+        __m128i low = _mm_cmpeq_epi32(_mm_and_si128(byte, lowBits), lowBits);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + byteIndex * 8), _mm_or_si128(black, _mm_and_si128(high, colour)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + byteIndex * 8 + 4), _mm_or_si128(black, _mm_and_si128(low, colour)));
+    }
+
+    return;
+}
+
+__attribute__((target("avx2")))
+static void expandRowAVX2(PackedRow row, Pixel* output) {
+    const __m256i bits = _mm256_set_epi32(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+    const __m256i black = _mm256_set1_epi32(static_cast<int>(BLACK_PIXEL));
+    const __m256i colour = _mm256_set1_epi32(static_cast<int>(WHITE_PIXEL ^ BLACK_PIXEL));
+
+    for(int byteIndex = 0; byteIndex < PACKED_ROW_BITS / 8; byteIndex++) {
+        __m256i byte = _mm256_set1_epi32(static_cast<int>((row >> (PACKED_ROW_BITS - 8 - byteIndex * 8)) & 0xFF));
+        __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(byte, bits), bits);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + byteIndex * 8), _mm256_or_si256(black, _mm256_and_si256(mask, colour)));
+    }
+
+    return;
+}
+#endif
+
+// Words where the second plane has pixels set go through the palette one pixel at a time
+static void expandWordPalette(PackedRow first, PackedRow second, Pixel* output) {
+    for(int column = 0; column < PACKED_ROW_BITS; column++) {
+        int shift = PACKED_ROW_BITS - 1 - column;
+        output[column] = PALETTE[(((second >> shift) & 0x1) << 1) | ((first >> shift) & 0x1)];
+    }
+
+    return;
+}
+
+static RowExpander selectRowExpander() {
+#ifdef PIXEL_EXPAND_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return &expandRowAVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return &expandRowSSE2;
+#endif
+    return &expandRowScalar;
+}
+
+// Rows are expanded once at 1x, then widened and repeated for larger scales
+static void expandWith(RowExpander expandRow, const PackedBuffer& packed, bool hires, void* destination, int pitch, int scale) {
+    unsigned char* outputBytes = static_cast<unsigned char*>(destination);
+    const int width = getWidth(hires);
+    const int height = getHeight(hires);
+    PixelRow rowPixels {};
+
+    for(int row = 0; row < height; row++) {
+        Pixel* output = reinterpret_cast<Pixel*>(outputBytes + static_cast<size_t>(row) * scale * pitch);
+        Pixel* rowOutput = (scale == 1) ? output : rowPixels.data();
+
+        for(int word = 0; word < width / PACKED_ROW_BITS; word++) {
+            PackedRow first = packed[0][row * ROW_WORDS + word];
+            PackedRow second = packed[1][row * ROW_WORDS + word];
+
+            if(second == 0)
+                expandRow(first, rowOutput + word * PACKED_ROW_BITS);
+            else
+                expandWordPalette(first, second, rowOutput + word * PACKED_ROW_BITS);
+        }
+
+        if(scale == 1)
+            continue;
+
+        for(int column = 0; column < width; column++)
+            std::fill_n(output + column * scale, scale, rowPixels[column]);
+
+        for(int copy = 1; copy < scale; copy++)
+            memcpy(outputBytes + (static_cast<size_t>(row) * scale + copy) * pitch, output, width * scale * sizeof(Pixel));
+    }
+
+    return;
+}
+
+void expandPackedRows(const PackedBuffer& packed, bool hires, void* destination, int pitch, int scale) {
+    static const RowExpander expandRow = selectRowExpander();
+
+    expandWith(expandRow, packed, hires, destination, pitch, scale);
+
+    return;
+}
+
+void expandPackedRowsScalar(const PackedBuffer& packed, bool hires, void* destination, int pitch, int scale) {
+    expandWith(&expandRowScalar, packed, hires, destination, pitch, scale);
+
+    return;
+}
+
+}
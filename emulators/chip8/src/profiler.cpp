@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "chip8.h"
+#include "profiler.h"
+
+#ifdef CHIP8_PROFILE
+
+static_assert(PROFILE_ADDRESS_SPACE == CHIP_8_MEM_SIZE, "Histogram must cover memory");
+
+typedef struct {
+    unsigned short mask;
+    unsigned short opcode;
+    const char* name;
+}OpcodeClass;
+
+// Same masks and order as the decoder's opcodeLookup, anything that matches none is unknown
+static constexpr OpcodeClass opcodeClassTable[] {
+    {0xFFF0, OP_SCROLL_DOWN_MASK, "00CN"},
+    {0xFFF0, OP_SCROLL_UP_MASK, "00DN"},
+    {0xFFFF, OP_CLEAR_SCREEN_MASK, "00E0"},
+    {0xFFFF, OP_RETURN_FROM_SUB_MASK, "00EE"},
+    {0xFFFF, OP_SCROLL_RIGHT_MASK, "00FB"},
+    {0xFFFF, OP_SCROLL_LEFT_MASK, "00FC"},
+    {0xFFFF, OP_EXIT_MASK, "00FD"},
+    {0xFFFF, OP_LOW_RES_MASK, "00FE"},
+    {0xFFFF, OP_HIGH_RES_MASK, "00FF"},
+    {0xF000, OP_JUMP_ADDR_MASK, "1NNN"},
+    {0xF000, OP_CALL_SUB_MASK, "2NNN"},
+    {0xF000, OP_SE_VX_MASK, "3XNN"},
+    {0xF000, OP_SNE_VX_MASK, "4XNN"},
+    {0xF000, OP_SE_VX_VY_MASK, "5XY0"},
+    {0xF000, OP_LOAD_VX_MASK, "6XNN"},
+    {0xF000, OP_ADD_VX_MASK, "7XNN"},
+    {0xF00F, OP_LOAD_VX_VY_MASK, "8XY0"},
+    {0xF00F, OP_LOAD_OR_VX_VY_MASK, "8XY1"},
+    {0xF00F, OP_LOAD_AND_VX_VY_MASK, "8XY2"},
+    {0xF00F, OP_LOAD_XOR_VX_VY_MASK, "8XY3"},
+    {0xF00F, OP_LOAD_ADD_VX_VY_MASK, "8XY4"},
+    {0xF00F, OP_LOAD_SUB_VX_VY_MASK, "8XY5"},
+    {0xF00F, OP_LOAD_SHIFT_RIGHT_VX_MASK, "8XY6"},
+    {0xF00F, OP_LOAD_SUB_VY_VX_MASK, "8XY7"},
+    {0xF00F, OP_LOAD_SHIFT_LEFT_VX_MASK, "8XYE"},
+    {0xF000, OP_SNE_VX_VY_MASK, "9XY0"},
+    {0xF000, OP_LOAD_I_MASK, "ANNN"},
+    {0xF000, OP_JUMP_ADDR_V0_MASK, "BNNN"},
+    {0xF000, OP_LOAD_VX_RAND_MASK, "CXNN"},
+    {0xF000, OP_DRAW_SPRITE_MASK, "DXYN"},
+    {0xF0FF, OP_SE_KEY_MASK, "EX9E"},
+    {0xF0FF, OP_SNE_KEY_MASK, "EXA1"},
+    {0xF0FF, OP_SELECT_PLANES_MASK, "FN01"},
+    {0xF0FF, OP_LOAD_AUDIO_PATTERN_MASK, "F002"},
+    {0xF0FF, OP_LOAD_VX_DELAY_MASK, "FX07"},
+    {0xF0FF, OP_LOAD_VX_KEY_MASK, "FX0A"},
+    {0xF0FF, OP_LOAD_DELAY_TO_VX_MASK, "FX15"},
+    {0xF0FF, OP_LOAD_SOUND_TO_VX_MASK, "FX18"},
+    {0xF0FF, OP_LOAD_I_VX_MASK, "FX1E"},
+    {0xF0FF, OP_LOAD_I_SPRITE_ADDR_MASK, "FX29"},
+    {0xF0FF, OP_LOAD_I_BIG_SPRITE_ADDR_MASK, "FX30"},
+    {0xF0FF, OP_BCD_VX_MASK, "FX33"},
+    {0xF0FF, OP_LOAD_PITCH_MASK, "FX3A"},
+    {0xF0FF, OP_STORE_REGISTER_VALUES_MASK, "FX55"},
+    {0xF0FF, OP_LOAD_REGISTER_VALUES_MASK, "FX65"}
+};
+
+#define PROFILE_UNKNOWN_CLASS   (sizeof(opcodeClassTable) / sizeof(opcodeClassTable[0]))
+
+static_assert(PROFILE_UNKNOWN_CLASS + 1 == PROFILE_OPCODE_CLASSES, "Opcode classes out of date");
+
+static const char* getClassName(unsigned char opcodeClass) {
+    return (opcodeClass < PROFILE_UNKNOWN_CLASS) ? opcodeClassTable[opcodeClass].name : "????";
+}
+
+const std::array<unsigned char, 0x10000> profiler::opcodeClasses = [] {
+    std::array<unsigned char, 0x10000> classes {};
+
+    for(unsigned int opcode = 0; opcode < classes.size(); opcode++) {
+        unsigned char opcodeClass = PROFILE_UNKNOWN_CLASS;
+
+        for(unsigned char index = 0; index < PROFILE_UNKNOWN_CLASS; index++) {
+            if((opcode & opcodeClassTable[index].mask) == opcodeClassTable[index].opcode) {
+                opcodeClass = index;
+                break;
+            }
+        }
+
+        classes[opcode] = opcodeClass;
+    }
+
+    return classes;
+}();
+
+// Plain sums of every thread's counters
+typedef struct {
+    unsigned long long instructions;
+    unsigned long long idleCycles;
+    unsigned long long draws;
+    unsigned long long collisions;
+    unsigned long long frames;
+    unsigned long long frameMin;
+    unsigned long long frameMax;
+    unsigned long long frameBuckets[PROFILE_FRAME_BUCKETS];
+    unsigned long long opcodes[PROFILE_OPCODE_CLASSES];
+    unsigned long long pcHits[PROFILE_ADDRESS_SPACE];
+    unsigned char pcOpcode[PROFILE_ADDRESS_SPACE];
+}ProfileTotals;
+
+// Function local so it's built before install registers the exit dump, and torn down after it
+typedef struct {
+    std::mutex mutex;
+    std::vector<profiler::ThreadCounters*> live;
+    ProfileTotals retired;
+    std::string path;
+}ProfileRegistry;
+
+static ProfileRegistry& getRegistry() {
+    static ProfileRegistry registry {};
+    return registry;
+}
+
+static std::atomic<bool> dumpRequested {};
+
+static void addCounters(ProfileTotals& totals, const profiler::ThreadCounters& counters) {
+    const unsigned long long frames = counters.frames.load(std::memory_order_relaxed);
+
+    if(frames != 0) {
+        const unsigned long long frameMin = counters.frameMin.load(std::memory_order_relaxed);
+        const unsigned long long frameMax = counters.frameMax.load(std::memory_order_relaxed);
+
+        totals.frameMin = (totals.frames == 0) ? frameMin : std::min(totals.frameMin, frameMin);
+        totals.frameMax = std::max(totals.frameMax, frameMax);
+    }
+
+    totals.instructions += counters.instructions.load(std::memory_order_relaxed);
+    totals.idleCycles += counters.idleCycles.load(std::memory_order_relaxed);
+    totals.draws += counters.draws.load(std::memory_order_relaxed);
+    totals.collisions += counters.collisions.load(std::memory_order_relaxed);
+    totals.frames += frames;
+
+    for(size_t bucket = 0; bucket < PROFILE_FRAME_BUCKETS; bucket++)
+        totals.frameBuckets[bucket] += counters.frameBuckets[bucket].load(std::memory_order_relaxed);
+
+    for(size_t opcodeClass = 0; opcodeClass < PROFILE_OPCODE_CLASSES; opcodeClass++)
+        totals.opcodes[opcodeClass] += counters.opcodes[opcodeClass].load(std::memory_order_relaxed);
+
+    for(size_t pc = 0; pc < PROFILE_ADDRESS_SPACE; pc++) {
+        const unsigned long long hits = counters.pcHits[pc].load(std::memory_order_relaxed);
+        if(hits == 0)
+            continue;
+
+        totals.pcHits[pc] += hits;
+        totals.pcOpcode[pc] = counters.pcOpcode[pc].load(std::memory_order_relaxed);
+    }
+
+    return;
+}
+
+profiler::ThreadCounters::ThreadCounters() {
+    ProfileRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    registry.live.push_back(this);
+}
+
+profiler::ThreadCounters::~ThreadCounters() {
+    ProfileRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    addCounters(registry.retired, *this);
+    registry.live.erase(std::remove(registry.live.begin(), registry.live.end(), this), registry.live.end());
+}
+
+void profiler::countFrame() {
+    ThreadCounters& counters = getThreadCounters();
+    const unsigned long long instructions = counters.instructions.load(std::memory_order_relaxed);
+    const unsigned long long executed = instructions - counters.frameStart;
+    unsigned int bucket {};
+
+    counters.frameStart = instructions;
+
+    while(bucket < PROFILE_FRAME_BUCKETS - 1 && (executed >> bucket) != 0)
+        bucket++;
+
+    if(counters.frames.load(std::memory_order_relaxed) == 0 || executed < counters.frameMin.load(std::memory_order_relaxed))
+        counters.frameMin.store(executed, std::memory_order_relaxed);
+    if(executed > counters.frameMax.load(std::memory_order_relaxed))
+        counters.frameMax.store(executed, std::memory_order_relaxed);
+
+    bump(counters.frames);
+    bump(counters.frameBuckets[bucket]);
+
+    // Whichever thread finishes a frame first after the signal writes the dump
+    if(dumpRequested.load(std::memory_order_relaxed) && dumpRequested.exchange(false))
+        dump();
+
+    return;
+}
+
+// Hottest first, addresses that never ran are left out
+static std::vector<unsigned short> sortHotAddresses(const ProfileTotals& totals) {
+    std::vector<unsigned short> addresses {};
+
+    for(unsigned short pc = 0; pc < PROFILE_ADDRESS_SPACE; pc++) {
+        if(totals.pcHits[pc] != 0)
+            addresses.push_back(pc);
+    }
+
+    std::stable_sort(addresses.begin(), addresses.end(), [&totals](unsigned short a, unsigned short b) {
+        return totals.pcHits[a] > totals.pcHits[b];
+    });
+
+    return addresses;
+}
+
+static void writeJson(FILE* file, const ProfileTotals& totals) {
+    std::vector<unsigned char> classes {};
+    for(unsigned char opcodeClass = 0; opcodeClass < PROFILE_OPCODE_CLASSES; opcodeClass++) {
+        if(totals.opcodes[opcodeClass] != 0)
+            classes.push_back(opcodeClass);
+    }
+
+    std::stable_sort(classes.begin(), classes.end(), [&totals](unsigned char a, unsigned char b) {
+        return totals.opcodes[a] > totals.opcodes[b];
+    });
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"instructions\": %llu,\n", totals.instructions);
+    fprintf(file, "  \"idleCycles\": %llu,\n", totals.idleCycles);
+    fprintf(file, "  \"draws\": %llu,\n", totals.draws);
+    fprintf(file, "  \"collisions\": %llu,\n", totals.collisions);
+
+    // Instructions actually run per frame, skipped idle cycles don't count
+    fprintf(file, "  \"frames\": {\n");
+    fprintf(file, "    \"count\": %llu,\n", totals.frames);
+    fprintf(file, "    \"minInstructions\": %llu,\n", totals.frameMin);
+    fprintf(file, "    \"maxInstructions\": %llu,\n", totals.frameMax);
+    fprintf(file, "    \"histogram\": [");
+    for(unsigned int bucket = 0; bucket < PROFILE_FRAME_BUCKETS; bucket++) {
+        fprintf(file, "%s\n      {\"minInstructions\": %llu, \"frames\": %llu}", bucket ? "," : "",
+                bucket ? 1ULL << (bucket - 1) : 0ULL, totals.frameBuckets[bucket]);
+    }
+    fprintf(file, "\n    ]\n  },\n");
+
+    fprintf(file, "  \"opcodes\": [");
+    for(size_t index = 0; index < classes.size(); index++) {
+        fprintf(file, "%s\n    {\"opcode\": \"%s\", \"count\": %llu}", index ? "," : "",
+                getClassName(classes[index]), totals.opcodes[classes[index]]);
+    }
+    fprintf(file, "\n  ],\n");
+
+    const std::vector<unsigned short> addresses = sortHotAddresses(totals);
+    fprintf(file, "  \"addresses\": [");
+    for(size_t index = 0; index < addresses.size(); index++) {
+        const unsigned short pc = addresses[index];
+        fprintf(file, "%s\n    {\"pc\": \"0x%04X\", \"opcode\": \"%s\", \"hits\": %llu}", index ? "," : "",
+                pc, getClassName(totals.pcOpcode[pc]), totals.pcHits[pc]);
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    return;
+}
+
+// One line per address, grouped by 256 byte page so loops sharing a page stack up together
+static void writeFolded(FILE* file, const ProfileTotals& totals) {
+    for(unsigned short pc = 0; pc < PROFILE_ADDRESS_SPACE; pc++) {
+        if(totals.pcHits[pc] == 0)
+            continue;
+
+        fprintf(file, "chip8;0x%04X-0x%04X;0x%04X %s %llu\n", pc & 0xF00, (pc & 0xF00) | 0xFF,
+                pc, getClassName(totals.pcOpcode[pc]), totals.pcHits[pc]);
+    }
+
+    return;
+}
+
+static void dumpAtExit() {
+    profiler::dump();
+    return;
+}
+
+static void requestDump(int) {
+    dumpRequested.store(true, std::memory_order_relaxed);
+    return;
+}
+
+char profiler::install(const char* path) {
+    ProfileRegistry& registry = getRegistry();
+
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.path = path;
+    }
+
+    std::atexit(dumpAtExit);
+
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, requestDump);
+#endif
+
+    return 0;
+}
+
+char profiler::dump() {
+    ProfileRegistry& registry = getRegistry();
+    std::unique_ptr<ProfileTotals> totals = std::make_unique<ProfileTotals>();
+    std::string path {};
+
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        *totals = registry.retired;
+        for(const ThreadCounters* counters : registry.live)
+            addCounters(*totals, *counters);
+        path = registry.path;
+    }
+
+    if(path.empty())
+        return -1;
+
+    FILE* file = fopen(path.c_str(), "w");
+    if(file == nullptr) {
+        std::cerr << "Could not write profile " << path << std::endl;
+        return -1;
+    }
+
+    const bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if(json)
+        writeJson(file, *totals);
+    else
+        writeFolded(file, *totals);
+
+    fclose(file);
+
+    return 0;
+}
+
+#else
+
+char profiler::install(const char* path) {
+    std::cerr << "Not profiling to " << path << ", configure with -DCHIP8_PROFILE=ON" << std::endl;
+    return -1;
+}
+
+char profiler::dump() {
+    return -1;
+}
+
+#endif
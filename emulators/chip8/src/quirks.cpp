@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <array>
+#include "quirks.h"
+
+typedef struct {
+    unsigned long long romHash;
+    QuirkProfile profile;
+}QuirkEntry;
+
+// Bundled ROMs that need something other than the default profile, sorted by hash
+// Hashes are FNV-1a over the whole file, same as RomImage
+// The 1977-1981 titles were written against the COSMAC VIP interpreter
+constexpr std::array<QuirkEntry, 25> QuirkDatabase {{
+    {0x1E209A80FD3D334AULL, QuirkProfile::Chip8},  // Clock Program [Bill Fisher, 1981]
+    {0x289CE14A5119DDBFULL, QuirkProfile::Chip8},  // Nim [Carmelo Cortez, 1978]
+    {0x2EE3A4A2D183C87EULL, QuirkProfile::Chip8},  // Programmable Spacefighters [Jef Winsor]
+    {0x3A88EB66F94C1482ULL, QuirkProfile::Chip8},  // Biorhythm [Jef Winsor]
+    {0x43A0A3E5B571E276ULL, QuirkProfile::Chip8},  // Framed MK2 [GV Samways, 1980]
+    {0x47A6B64574B6F567ULL, QuirkProfile::Chip8},  // Framed MK1 [GV Samways, 1980]
+    {0x48F83DF46B8EBCEBULL, QuirkProfile::Chip8},  // Breakout [Carmelo Cortez, 1979]
+    {0x4BAF9E72329A0A16ULL, QuirkProfile::Chip8},  // Slide [Joyce Weisbecker]
+    {0x4C139BA88896EDE1ULL, QuirkProfile::Chip8},  // Hi-Lo [Jef Winsor, 1978]
+    {0x6A01B16D00737853ULL, QuirkProfile::Chip8},  // Craps [Camerlo Cortez, 1978]
+    {0x6A500484E148E957ULL, QuirkProfile::Chip8},  // Spooky Spot [Joseph Weisbecker, 1978]
+    {0x757373F9296128F5ULL, QuirkProfile::Chip8},  // Submarine [Carmelo Cortez, 1978]
+    {0x847EE1947D13F660ULL, QuirkProfile::Chip8},  // Sum Fun [Joyce Weisbecker]
+    {0x8BDF18DB083EF860ULL, QuirkProfile::Chip8},  // Lunar Lander (Udo Pernisz, 1979)
+    {0x9BF79E68B91A56D9ULL, QuirkProfile::Chip8},  // Space Intercept [Joseph Weisbecker, 1978]
+    {0x9E5EB66BF9A0EEC0ULL, QuirkProfile::Chip8},  // Shooting Stars [Philip Baltzer, 1978]
+    {0xB7E1D74B387BEDE6ULL, QuirkProfile::Chip8},  // Wipe Off [Joseph Weisbecker]
+    {0xC1799734D41FD3F5ULL, QuirkProfile::Chip8},  // Mastermind FourRow (Robert Lindley, 1978)
+    {0xC346F686F56AB7D6ULL, QuirkProfile::Chip8},  // Coin Flipping [Carmelo Cortez, 1978]
+    {0xC934D0C8937DAC28ULL, QuirkProfile::Chip8},  // Jumping X and O [Harry Kleinberg, 1977]
+    {0xD134B4CD125A3684ULL, QuirkProfile::Chip8},  // Russian Roulette [Carmelo Cortez, 1978]
+    {0xD1AE8CA64A995D4FULL, QuirkProfile::Chip8},  // Sequence Shoot [Joyce Weisbecker]
+    {0xD1C88ACD90BA4541ULL, QuirkProfile::Chip8},  // Rocket [Joseph Weisbecker, 1978]
+    {0xD4911604C3F935C7ULL, QuirkProfile::Chip8},  // Kaleidoscope [Joseph Weisbecker, 1978]
+    {0xFD18B6E89178CBF4ULL, QuirkProfile::Chip8}   // Life [GV Samways, 1980]
+}};
+
+QuirkProfile lookupQuirkProfile(unsigned long long romHash) {
+    auto found = std::lower_bound(QuirkDatabase.begin(), QuirkDatabase.end(), romHash,
+        [](const QuirkEntry& entry, unsigned long long hash) { return entry.romHash < hash; });
+
+    if(found == QuirkDatabase.end() || found->romHash != romHash)
+        return QuirkProfile::Default;
+
+    return found->profile;
+}
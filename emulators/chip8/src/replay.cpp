@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "aot.h"
+#include "block_engine.h"
+#include "chip8.h"
+#include "cpu_core.h"
+#include "journal.h"
+#include "rom.h"
+#include "trace.h"
+
+// Reruns a recorded session headless and checks every frame against the journal
+int main(int argc, char* argv[]) {
+    if(argc < 3) {
+        fprintf(stderr, "Usage: %s <ROM path> <journal> [--engine=interp|block] [--aot=DIR] [--trace=FILE] [--trace-lz]\n", argv[0]);
+        return -1;
+    }
+
+    std::unique_ptr<AotLibrary> aotLibrary {};
+    std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+    std::unique_ptr<CpuCore> cpuCore = std::make_unique<InterpreterCore>();
+    MappedRomManager romManager;
+    InputJournal journal;
+    TraceWriter traceWriter;
+    const char* tracePath {};
+    const char* aotDir {};
+    bool traceCompress {};
+
+    for(int index = 3; index < argc; index++) {
+        if(strcmp(argv[index], "--engine=block") == 0)
+            cpuCore = std::make_unique<BlockCore>();
+        else if(strncmp(argv[index], "--trace=", 8) == 0)
+            tracePath = argv[index] + 8;
+        else if(strcmp(argv[index], "--trace-lz") == 0)
+            traceCompress = true;
+        else if(strncmp(argv[index], "--aot=", 6) == 0)
+            aotDir = argv[index] + 6;
+    }
+
+    if(InputJournal::load(argv[2], journal)) {
+        fprintf(stderr, "Could not read journal %s\n", argv[2]);
+        return -1;
+    }
+
+    if(romManager.loadRom(argv[1], *chip8)) {
+        fprintf(stderr, "Could not load ROM %s\n", argv[1]);
+        return -1;
+    }
+
+    chip8->setQuirkProfile(journal.getQuirkProfile());
+    chip8->seedRandom(journal.getSeed());
+    if(chip8->getStateHash() != journal.getInitialHash()) {
+        fprintf(stderr, "Journal was recorded against a different ROM or seed\n");
+        return -1;
+    }
+
+    if(aotDir != nullptr) {
+        std::unique_ptr<BlockCore> blockCore = std::make_unique<BlockCore>();
+        aotLibrary = std::make_unique<AotLibrary>(aotDir);
+        blockCore->setNativeModule(aotLibrary->find(RomCache::acquire(argv[1])->getHash()));
+        cpuCore = std::move(blockCore);
+    }
+
+    if(tracePath != nullptr) {
+        if(traceWriter.open(tracePath, traceCompress)) {
+            fprintf(stderr, "Could not open trace %s\n", tracePath);
+            return -1;
+        }
+
+        cpuCore = std::make_unique<TraceCore>(traceWriter);
+    }
+
+    JournalPlayer player(journal);
+    unsigned long long cycles {};
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while(!player.finished()) {
+        cycles += player.runFrame(*chip8, *cpuCore);
+
+        if(!player.frameMatches(*chip8)) {
+            printf("DIVERGED at frame %llu (cycle %llu)\n", player.getFrame() - 1, chip8->getCycleCount());
+            traceWriter.close();
+            return 1;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(tracePath != nullptr && traceWriter.close()) {
+        fprintf(stderr, "Could not write trace %s\n", tracePath);
+        return -1;
+    }
+
+    printf("OK %llu frames, %zu input events, final state %016llX\n",
+           player.getFrame(), journal.getEvents().size(), chip8->getStateHash());
+    fprintf(stderr, "%llu instructions in %.3f s (%.2f MIPS)\n", cycles, seconds, cycles / seconds / 1e6);
+
+    return 0;
+}
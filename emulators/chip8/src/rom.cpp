@@ -1,7 +1,15 @@
 #include "rom.h"
 #include <fstream>
+#include <mutex>
 #include <vector>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 char FileRomManager::loadRom(std::string_view filename, Chip8& chip8) {
     char error {};
     
@@ -27,8 +35,117 @@ char FileRomManager::loadRom(std::string_view filename, Chip8& chip8) {
     }
 
     // Write to Chip8 memory space
-    if(chip8.writeMemory(buffer.data(), buffer.size(), ROM_MEM_START));
+    if(chip8.writeMemory(buffer.data(), buffer.size(), ROM_MEM_START))
         return -1;
 
+    chip8.setQuirkProfile(lookupQuirkProfile(fnv1aHash(buffer.data(), buffer.size())));
+
     return error;
 };
+
+std::shared_mutex RomCache::mutex {};
+std::map<std::string, std::shared_ptr<const RomImage>, std::less<>> RomCache::byPath {};
+std::map<unsigned long long, std::weak_ptr<const RomImage>> RomCache::byHash {};
+
+RomImage::RomImage(const unsigned char* data, size_t size, bool mapped)
+    : data(data), size(size), hash(fnv1aHash(data, size)), mapped(mapped) {
+}
+
+RomImage::~RomImage() {
+#ifndef _WIN32
+    if(mapped) {
+        munmap(const_cast<unsigned char*>(data), size);
+        return;
+    }
+#endif
+    delete[] data;
+}
+
+std::shared_ptr<const RomImage> RomCache::mapFile(std::string_view filename) {
+    std::string path(filename);
+
+#ifndef _WIN32
+    int file = open(path.c_str(), O_RDONLY);
+    if(file < 0)
+        return nullptr;
+
+    struct stat fileStat {};
+    if(fstat(file, &fileStat) != 0 || fileStat.st_size > static_cast<off_t>(ROM_MEM_SIZE)) {
+        close(file);
+        return nullptr;
+    }
+
+    // mmap refuses empty files, an empty ROM simply has no bytes to copy
+    size_t fileSize = static_cast<size_t>(fileStat.st_size);
+    void* mapping = (fileSize != 0) ? mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0) : nullptr;
+    close(file);
+
+    if(mapping == MAP_FAILED)
+        return nullptr;
+
+    return std::make_shared<const RomImage>(static_cast<const unsigned char*>(mapping), fileSize, mapping != nullptr);
+#else
+    // No mmap here, read it once into the heap instead
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+        return nullptr;
+
+    std::streamsize fileSize = file.tellg();
+    if(fileSize > static_cast<std::streamsize>(ROM_MEM_SIZE))
+        return nullptr;
+
+    unsigned char* buffer = new unsigned char[fileSize];
+    file.seekg(0, std::ios::beg);
+    if(!file.read(reinterpret_cast<char*>(buffer), fileSize)) {
+        delete[] buffer;
+        return nullptr;
+    }
+
+    return std::make_shared<const RomImage>(buffer, static_cast<size_t>(fileSize), false);
+#endif
+}
+
+std::shared_ptr<const RomImage> RomCache::acquire(std::string_view filename) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto found = byPath.find(filename);
+        if(found != byPath.end())
+            return found->second;
+    }
+
+    // Map outside the lock, another thread may win the race and that's fine
+    std::shared_ptr<const RomImage> image = mapFile(filename);
+    if(image == nullptr)
+        return nullptr;
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto found = byPath.find(filename);
+    if(found != byPath.end())
+        return found->second;
+
+    // Same bytes under another path (copies, symlinks) share the first mapping
+    std::shared_ptr<const RomImage> existing = byHash[image->getHash()].lock();
+    if(existing != nullptr && existing->getSize() == image->getSize() &&
+        std::equal(image->getData(), image->getData() + image->getSize(), existing->getData()))
+        image = existing;
+    else
+        byHash[image->getHash()] = image;
+
+    byPath.emplace(std::string(filename), image);
+
+    return image;
+}
+
+char MappedRomManager::loadRom(std::string_view filename, Chip8& chip8) {
+    std::shared_ptr<const RomImage> image = RomCache::acquire(filename);
+    if(image == nullptr)
+        return -1;
+
+    // Write to Chip8 memory space
+    if(chip8.writeMemory(image->getData(), image->getSize(), ROM_MEM_START))
+        return -1;
+
+    chip8.setQuirkProfile(lookupQuirkProfile(image->getHash()));
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <cstring>
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC      0x4E533843     // "C8SN"
+#define SNAPSHOT_VERSION    5
+
+// Little-endian helpers so images move between hosts
+static void putValue(std::vector<unsigned char>& data, unsigned long long value, size_t size) {
+    for(size_t index = 0; index < size; index++)
+        data.push_back(static_cast<unsigned char>(value >> (index * 8)));
+
+    return;
+}
+
+static unsigned long long getValue(const std::vector<unsigned char>& data, size_t& offset, size_t size) {
+    unsigned long long value {};
+
+    for(size_t index = 0; index < size; index++)
+        value |= static_cast<unsigned long long>(data[offset + index]) << (index * 8);
+    offset += size;
+
+    return value;
+}
+
+// Shared by every default constructed snapshot, so they compare equal page by page without a byte compare
+const std::shared_ptr<const MemoryPage>& Snapshot::getZeroPage() {
+    static const std::shared_ptr<const MemoryPage> zeroPage = std::make_shared<const MemoryPage>();
+    return zeroPage;
+}
+
+std::vector<unsigned char> Snapshot::serialize() const {
+    std::vector<unsigned char> data {};
+
+    putValue(data, SNAPSHOT_MAGIC, 4);
+    putValue(data, SNAPSHOT_VERSION, 2);
+    putValue(data, PC, 2);
+    putValue(data, SP, 1);
+    putValue(data, I, 2);
+    putValue(data, delay_timer, 2);
+    putValue(data, sound_timer, 2);
+    putValue(data, keyMask, 2);
+    putValue(data, randomState, 8);
+    putValue(data, cycleCount, 8);
+    data.insert(data.end(), v, v + SNAPSHOT_REGISTER_COUNT);
+
+    for(unsigned short entry : stack)
+        putValue(data, entry, 2);
+
+    putValue(data, hires, 1);
+    putValue(data, planeMask, 1);
+    for(const pixels::PackedPlane& plane : pixels) {
+        for(pixels::PackedRow row : plane)
+            putValue(data, row, 8);
+    }
+
+    data.insert(data.end(), audioPattern, audioPattern + SNAPSHOT_AUDIO_PATTERN_SIZE);
+    putValue(data, audioPitch, 1);
+    putValue(data, keyWaiting, 1);
+    putValue(data, keyWaitIgnored, 2);
+    putValue(data, keyWaitKey, 1);
+
+    for(const auto &page : pages)
+        data.insert(data.end(), page->begin(), page->end());
+
+    return data;
+}
+
+char Snapshot::deserialize(const std::vector<unsigned char>& data, Snapshot& snapshot) {
+    const size_t expectedSize = 4 + 2 + 2 + 1 + 2 + 2 + 2 + 2 + 8 + 8 + SNAPSHOT_REGISTER_COUNT +
+                                SNAPSHOT_STACK_SIZE * 2 + 1 + 1 + sizeof(pixels::PackedBuffer) +
+                                SNAPSHOT_AUDIO_PATTERN_SIZE + 1 + 1 + 2 + 1 +
+                                SNAPSHOT_PAGE_COUNT * SNAPSHOT_PAGE_SIZE;
+    size_t offset {};
+
+    if(data.size() != expectedSize)
+        return -1;
+
+    if(getValue(data, offset, 4) != SNAPSHOT_MAGIC || getValue(data, offset, 2) != SNAPSHOT_VERSION)
+        return -1;
+
+    snapshot.PC = getValue(data, offset, 2);
+    snapshot.SP = getValue(data, offset, 1);
+    snapshot.I = getValue(data, offset, 2);
+    snapshot.delay_timer = getValue(data, offset, 2);
+    snapshot.sound_timer = getValue(data, offset, 2);
+    snapshot.keyMask = getValue(data, offset, 2);
+    snapshot.randomState = getValue(data, offset, 8);
+    snapshot.cycleCount = getValue(data, offset, 8);
+    memcpy(snapshot.v, data.data() + offset, SNAPSHOT_REGISTER_COUNT);
+    offset += SNAPSHOT_REGISTER_COUNT;
+
+    for(unsigned short &entry : snapshot.stack)
+        entry = getValue(data, offset, 2);
+
+    snapshot.hires = getValue(data, offset, 1) != 0;
+    snapshot.planeMask = getValue(data, offset, 1);
+    for(pixels::PackedPlane& plane : snapshot.pixels) {
+        for(pixels::PackedRow &row : plane)
+            row = getValue(data, offset, 8);
+    }
+
+    memcpy(snapshot.audioPattern, data.data() + offset, SNAPSHOT_AUDIO_PATTERN_SIZE);
+    offset += SNAPSHOT_AUDIO_PATTERN_SIZE;
+    snapshot.audioPitch = getValue(data, offset, 1);
+    snapshot.keyWaiting = getValue(data, offset, 1) != 0;
+    snapshot.keyWaitIgnored = getValue(data, offset, 2);
+    snapshot.keyWaitKey = getValue(data, offset, 1);
+
+    // Restoring bypasses the setters that keep these in range, so a corrupt image would index out of bounds
+    if(snapshot.PC >= SNAPSHOT_PAGE_COUNT * SNAPSHOT_PAGE_SIZE || snapshot.SP > SNAPSHOT_STACK_SIZE || snapshot.planeMask > 3)
+        return -1;
+
+    for(auto &page : snapshot.pages) {
+        std::shared_ptr<MemoryPage> copy = std::make_shared<MemoryPage>();
+        memcpy(copy->data(), data.data() + offset, SNAPSHOT_PAGE_SIZE);
+        offset += SNAPSHOT_PAGE_SIZE;
+        page = std::move(copy);
+    }
+
+    return 0;
+}
+
+SnapshotDiff Snapshot::diff(const Snapshot& first, const Snapshot& second) {
+    SnapshotDiff result {};
+
+    // Shared pages are equal by construction, only compare bytes when the pointers differ
+    for(unsigned char page = 0; page < SNAPSHOT_PAGE_COUNT; page++) {
+        if(first.pages[page] != second.pages[page] && *first.pages[page] != *second.pages[page])
+            result.changedPages |= 1 << page;
+    }
+
+    for(unsigned char index = 0; index < SNAPSHOT_REGISTER_COUNT; index++) {
+        if(first.v[index] != second.v[index])
+            result.changedRegisters |= 1 << index;
+    }
+
+    result.programCounter = first.PC != second.PC;
+    result.stackPointer = first.SP != second.SP;
+    result.indexRegister = first.I != second.I;
+    result.timers = first.delay_timer != second.delay_timer || first.sound_timer != second.sound_timer;
+    result.stack = memcmp(first.stack, second.stack, sizeof(first.stack)) != 0;
+    result.display = first.pixels != second.pixels || first.hires != second.hires;
+    result.audio = memcmp(first.audioPattern, second.audioPattern, sizeof(first.audioPattern)) != 0 ||
+                   first.audioPitch != second.audioPitch;
+
+    return result;
+}
@@ -1,31 +1,218 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
 #include "Config.h"
+#include "aot.h"
+#include "audio.h"
+#include "block_engine.h"
 #include "chip8.h"
+#include "cpu_core.h"
+#include "debugger.h"
 #include "display.h"
+#include "journal.h"
+#include "logger.h"
+#include "options.h"
+#include "profiler.h"
 #include "rom.h"
+#include "scheduler.h"
+#include "trace.h"
+
+typedef struct {
+    int scale { 1 };        // CPU side upscale factor, 1 leaves scaling to the renderer
+    unsigned int cyclesPerFrame { DEFAULT_CYCLES_PER_FRAME };
+    // Wall clock unless "--seed=N", so every session plays differently
+    unsigned long long seed { static_cast<unsigned long long>(std::chrono::steady_clock::now().time_since_epoch().count()) };
+    bool turbo {};
+    bool mute {};           // Skips opening an audio device at all
+    bool useBlockCore {};
+    bool overrideQuirks {};
+    bool traceCompress {};
+    QuirkProfile quirkProfile {};
+    const char* aotDir {};      // Runs the block engine with the modules' native bodies
+    const char* recordPath {};
+    const char* logPath {};     // stderr otherwise
+    const char* profilePath {}; // Only does anything in CHIP8_PROFILE builds
+    const char* tracePath {};
+    const char* debugPath {};
+    const char* rom {};
+}StartupOptions;
+
+static char parseOptions(int argc, char* argv[], StartupOptions& options) {
+    for(int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+
+        if(strncmp(arg, "--scale=", 8) == 0) {
+            if(parseNumber(arg + 8, options.scale) || options.scale == 0)
+                return -1;
+        }
+        else if(strncmp(arg, "--cycles-per-frame=", 19) == 0) {
+            if(parseNumber(arg + 19, options.cyclesPerFrame) || options.cyclesPerFrame == 0)
+                return -1;
+        }
+        else if(strncmp(arg, "--seed=", 7) == 0) {
+            if(parseNumber(arg + 7, options.seed, 0))
+                return -1;
+        }
+        else if(strcmp(arg, "--turbo") == 0)
+            options.turbo = true;
+        else if(strcmp(arg, "--mute") == 0)
+            options.mute = true;
+        else if(strcmp(arg, "--engine=block") == 0)
+            options.useBlockCore = true;
+        else if(strcmp(arg, "--engine=interp") == 0)
+            options.useBlockCore = false;
+        else if(strncmp(arg, "--quirks=", 9) == 0) {
+            if(parseQuirkProfile(arg + 9, options.quirkProfile))
+                return -1;
+            options.overrideQuirks = true;
+        }
+        else if(strncmp(arg, "--aot=", 6) == 0)
+            options.aotDir = arg + 6;
+        else if(strncmp(arg, "--record=", 9) == 0)
+            options.recordPath = arg + 9;
+        else if(strncmp(arg, "--log=", 6) == 0)
+            options.logPath = arg + 6;
+        else if(strncmp(arg, "--profile=", 10) == 0)
+            options.profilePath = arg + 10;
+        else if(strncmp(arg, "--trace=", 8) == 0)
+            options.tracePath = arg + 8;
+        else if(strcmp(arg, "--trace-lz") == 0)
+            options.traceCompress = true;
+        else if(strncmp(arg, "--debug=", 8) == 0)
+            options.debugPath = arg + 8;
+        else if(strncmp(arg, "--", 2) == 0 || options.rom != nullptr)
+            return -1;
+        else
+            options.rom = arg;
+    }
+
+    return (options.rom == nullptr) ? -1 : 0;
+}
 
 int main(int argc, char* argv[]) {
+    StartupOptions options {};
+
     // TODO: Exclude this in embedded platform
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <ROM path>" << std::endl;
+    if(parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " <ROM path> [--engine=interp|block] [--aot=DIR] [--scale=N] [--cycles-per-frame=N] [--turbo] [--mute] [--seed=N] [--quirks=default|chip8|schip|xochip] [--record=FILE] [--profile=FILE] [--log=FILE] [--trace=FILE] [--trace-lz] [--debug=PATH]" << std::endl;
         return -1;
     }
 
+    if(options.logPath != nullptr && logger::setOutput(options.logPath))
+        std::cerr << "Could not open log " << options.logPath << std::endl;
+
+    std::unique_ptr<AotLibrary> aotLibrary {};
+
     Chip8 chip8interpreter;
-    Display chip8display;
+    FrameScheduler scheduler(options.cyclesPerFrame, options.turbo);
+    Display chip8display(options.scale, !scheduler.isTurbo());
     FileRomManager RomManager;
+    std::unique_ptr<CpuCore> cpuCore {};
+    if(options.useBlockCore)
+        cpuCore = std::make_unique<BlockCore>();
+    else
+        cpuCore = std::make_unique<InterpreterCore>();
 
-    RomManager.loadRom(argv[1], chip8interpreter);
+    // Declared after the display so it closes before SDL_Quit
+    std::unique_ptr<Audio> chip8audio;
+    if(!options.mute)
+        chip8audio = std::make_unique<Audio>();
+
+    const char* tracePath = options.tracePath;
+    InputJournal journal;
+    TraceWriter traceWriter;
+    Debugger debugger;
+
+    if(RomManager.loadRom(options.rom, chip8interpreter)) {
+        std::cerr << "Could not load ROM " << options.rom << std::endl;
+        return -1;
+    }
+
+    if(options.aotDir != nullptr) {
+        std::unique_ptr<BlockCore> blockCore = std::make_unique<BlockCore>();
+        aotLibrary = std::make_unique<AotLibrary>(options.aotDir);
+
+        // Modules are looked up by image hash, a ROM the cache can't map runs on the plain block engine
+        const AotModule* module {};
+        std::shared_ptr<const RomImage> image = RomCache::acquire(options.rom);
+        if(image != nullptr)
+            module = aotLibrary->find(image->getHash());
+        if(module == nullptr)
+            LOG_INFO("No recompiled module for %s in %s, running the block engine", options.rom, options.aotDir);
+
+        blockCore->setNativeModule(module);
+        cpuCore = std::move(blockCore);
+    }
+    chip8interpreter.seedRandom(options.seed);
 
-    // Test Memory Space
+    if(options.overrideQuirks)
+        chip8interpreter.setQuirkProfile(options.quirkProfile);
+
+    if(options.profilePath != nullptr)
+        profiler::install(options.profilePath);
+
+    // Traces every instruction whichever engine was picked
+    if(tracePath != nullptr && traceWriter.open(tracePath, options.traceCompress)) {
+        LOG_ERROR("Could not open trace %s", tracePath);
+        tracePath = nullptr;
+    }
+    if(tracePath != nullptr)
+        cpuCore = std::make_unique<TraceCore>(traceWriter);
+
+    if(options.debugPath != nullptr && debugger.listen(options.debugPath))
+        LOG_ERROR("Could not open debugger socket %s", options.debugPath);
+
+    // A stopped machine parks this thread inside the core, keep the window responding meanwhile
+    // Closing it gives up the stop so the loop below can finish
+    bool running = true;
+    debugger.setStoppedCallback([&running, &chip8display] {
+        running = running && chip8display.closeDisplayCheck();
+        return running;
+    });
+
+    if(options.recordPath != nullptr)
+        journal.begin(chip8interpreter, options.seed, scheduler.getCyclesPerFrame());
+
+    // Test Memory Space, compiled out below CHIP8_LOG_LEVEL=DEBUG
     chip8interpreter.printMemory();
     
-    while(chip8display.closeDisplayCheck()) {
-        chip8interpreter.printDebug();
-        
-        chip8interpreter.readNextInstruction();
-        chip8display.renderDisplay(chip8interpreter.getPixels());
-        //SDL_Delay(100);
+    // Events and presenting happen once per frame, never per instruction
+    while(running) {
+        // Keys are sampled once per frame, the journal keeps the cycle they changed on
+        chip8interpreter.setKeyMask(chip8display.keyMask());
+        if(options.recordPath != nullptr)
+            journal.recordInput(chip8interpreter.getCycleCount(), chip8interpreter.getKeyMask());
+
+        scheduler.runFrame(chip8interpreter, *cpuCore);
+
+        // Never blocks, the audio thread picks the samples up on its own schedule
+        if(chip8audio != nullptr)
+            chip8audio->queueFrame(chip8interpreter);
+
+        if(options.recordPath != nullptr)
+            journal.recordFrame(chip8interpreter);
+
+        if(scheduler.presentDue()) {
+            running = running && chip8display.closeDisplayCheck();
+            chip8display.renderDisplay(chip8interpreter.getPixels(), chip8interpreter.isHires(),
+                                        chip8interpreter.takeDisplayDirty());
+        }
+
+        // Parked on FX0A, turbo would otherwise race through empty frames until a key shows up
+        if(running && scheduler.isTurbo() && chip8interpreter.isWaitingForKey())
+            running = chip8display.waitForInput(1000 / FRAMES_PER_SECOND);
+
+        scheduler.waitForNextFrame();
     };
 
+    if(options.recordPath != nullptr && journal.save(options.recordPath))
+        LOG_ERROR("Could not write journal %s", options.recordPath);
+
+    if(tracePath != nullptr && traceWriter.close())
+        LOG_ERROR("Could not write trace %s", tracePath);
+
     return 0;
 }
\ No newline at end of file
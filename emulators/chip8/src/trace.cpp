@@ -0,0 +1,447 @@
+#include <cstring>
+#include "lz.h"
+#include "trace.h"
+
+#define TRACE_MAGIC             0x52543843     // "C8TR"
+#define TRACE_VERSION           1
+#define TRACE_BLOCK_HEADER_SIZE 21
+#define TRACE_MAX_BLOCK_BYTES   (TRACE_BLOCK_BYTES * 4)    // Sanity limit for readers
+
+// Block flags
+#define TRACE_BLOCK_COMPRESSED  0x01
+
+// Entry flags, anything not flagged is the same as the previous entry or implied by it
+#define TRACE_ENTRY_CYCLE       0x01    // Cycle moved by more than one, varint delta follows
+#define TRACE_ENTRY_PC          0x02    // PC isn't the previous PC + 2
+#define TRACE_ENTRY_REGISTERS   0x04    // Varint change mask, then the changed registers
+#define TRACE_ENTRY_WRITE       0x08    // Address, length and the bytes stored
+
+static void putValue(std::vector<unsigned char>& data, unsigned long long value, size_t size) {
+    for(size_t index = 0; index < size; index++)
+        data.push_back(static_cast<unsigned char>(value >> (index * 8)));
+
+    return;
+}
+
+static void putVarint(std::vector<unsigned char>& data, unsigned long long value) {
+    while(value >= 0x80) {
+        data.push_back(static_cast<unsigned char>(value) | 0x80);
+        value >>= 7;
+    }
+    data.push_back(static_cast<unsigned char>(value));
+
+    return;
+}
+
+static char getValue(const std::vector<unsigned char>& data, size_t& offset, size_t size, unsigned long long& value) {
+    if(data.size() - offset < size)
+        return -1;
+
+    value = 0;
+    for(size_t index = 0; index < size; index++)
+        value |= static_cast<unsigned long long>(data[offset + index]) << (index * 8);
+    offset += size;
+
+    return 0;
+}
+
+static char getVarint(const std::vector<unsigned char>& data, size_t& offset, unsigned long long& value) {
+    value = 0;
+
+    for(unsigned int shift = 0; shift < 64; shift += 7) {
+        if(offset >= data.size())
+            return -1;
+
+        unsigned char byte = data[offset++];
+        value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+        if(!(byte & 0x80))
+            return 0;
+    }
+
+    return -1;
+}
+
+static unsigned int changedRegisters(const TraceRegisters& before, const TraceRegisters& after) {
+    unsigned int mask {};
+
+    for(unsigned int index = 0; index < REGISTER_COUNT; index++)
+        mask |= (before.v[index] != after.v[index]) << index;
+    for(unsigned int index = 0; index < STACK_SIZE; index++)
+        mask |= (before.stack[index] != after.stack[index]) << (TRACE_REGISTER_STACK + index);
+
+    mask |= (before.I != after.I) << TRACE_REGISTER_I;
+    mask |= (before.SP != after.SP) << TRACE_REGISTER_SP;
+    mask |= (before.delay_timer != after.delay_timer) << TRACE_REGISTER_DT;
+    mask |= (before.sound_timer != after.sound_timer) << TRACE_REGISTER_ST;
+
+    return mask;
+}
+
+TraceWriter::~TraceWriter() {
+    if(file != nullptr)
+        close();
+}
+
+char TraceWriter::open(std::string_view filename, bool compress) {
+    std::vector<unsigned char> header {};
+
+    file = fopen(std::string(filename).c_str(), "wb");
+    if(file == nullptr)
+        return -1;
+
+    putValue(header, TRACE_MAGIC, 4);
+    putValue(header, TRACE_VERSION, 2);
+    if(fwrite(header.data(), 1, header.size(), file) != header.size()) {
+        fclose(file);
+        file = nullptr;
+        return -1;
+    }
+
+    this->compress = compress;
+    block.reserve(TRACE_BLOCK_BYTES + 256);
+    writer = std::thread(&TraceWriter::run, this);
+
+    return 0;
+}
+
+void TraceWriter::record(const TraceEntry& entry) {
+    encode(entry);
+    blockEntries++;
+
+    if(block.size() >= TRACE_BLOCK_BYTES)
+        submitBlock();
+
+    return;
+}
+
+void TraceWriter::encode(const TraceEntry& entry) {
+    const size_t flagsOffset = block.size();
+    unsigned char flags {};
+    unsigned int mask = keyframe ? TRACE_ALL_REGISTERS : changedRegisters(previous.registers, entry.registers);
+
+    block.push_back(0);
+    putValue(block, entry.opcode, 2);
+
+    if(entry.cycle != previous.cycle + 1) {
+        flags |= TRACE_ENTRY_CYCLE;
+        putVarint(block, entry.cycle - previous.cycle);
+    }
+
+    if(keyframe || entry.PC != static_cast<unsigned short>(previous.PC + 2)) {
+        flags |= TRACE_ENTRY_PC;
+        putValue(block, entry.PC, 2);
+    }
+
+    if(mask != 0) {
+        flags |= TRACE_ENTRY_REGISTERS;
+        putVarint(block, mask);
+
+        for(unsigned int index = 0; index < REGISTER_COUNT; index++) {
+            if(mask & (1U << index))
+                block.push_back(entry.registers.v[index]);
+        }
+        if(mask & (1U << TRACE_REGISTER_I))
+            putValue(block, entry.registers.I, 2);
+        if(mask & (1U << TRACE_REGISTER_SP))
+            block.push_back(entry.registers.SP);
+        if(mask & (1U << TRACE_REGISTER_DT))
+            putValue(block, entry.registers.delay_timer, 2);
+        if(mask & (1U << TRACE_REGISTER_ST))
+            putValue(block, entry.registers.sound_timer, 2);
+        for(unsigned int index = 0; index < STACK_SIZE; index++) {
+            if(mask & (1U << (TRACE_REGISTER_STACK + index)))
+                putValue(block, entry.registers.stack[index], 2);
+        }
+    }
+
+    if(entry.writeLength != 0) {
+        flags |= TRACE_ENTRY_WRITE;
+        putValue(block, entry.writeAddress, 2);
+        block.push_back(entry.writeLength);
+        block.insert(block.end(), entry.writeData, entry.writeData + entry.writeLength);
+    }
+
+    block[flagsOffset] = flags;
+    previous = entry;
+    keyframe = false;
+
+    return;
+}
+
+void TraceWriter::submitBlock() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Only waits when the disk can't keep up, dropping entries would make the trace useless
+    drained.wait(lock, [this] { return pending.size() < TRACE_QUEUED_BLOCKS; });
+    pending.push_back({std::move(block), blockEntries, blockCycle});
+
+    if(!spareBuffers.empty()) {
+        block = std::move(spareBuffers.back());
+        spareBuffers.pop_back();
+    }
+    else {
+        block = {};
+        block.reserve(TRACE_BLOCK_BYTES + 256);
+    }
+
+    lock.unlock();
+    queued.notify_one();
+
+    blockEntries = 0;
+    blockCycle = previous.cycle;
+    keyframe = true;
+
+    return;
+}
+
+void TraceWriter::run() {
+    std::vector<unsigned char> header {};
+    std::vector<unsigned char> compressed {};
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while(true) {
+        queued.wait(lock, [this] { return stopping || !pending.empty(); });
+        if(pending.empty())
+            break;
+
+        PendingBlock next = std::move(pending.front());
+        pending.pop_front();
+        lock.unlock();
+
+        const std::vector<unsigned char>* data = &next.data;
+        unsigned char flags {};
+
+        if(compress) {
+            compressed.clear();
+            lzCompress(next.data.data(), next.data.size(), compressed);
+
+            if(compressed.size() < next.data.size()) {
+                data = &compressed;
+                flags |= TRACE_BLOCK_COMPRESSED;
+            }
+        }
+
+        header.clear();
+        putValue(header, next.data.size(), 4);
+        putValue(header, data->size(), 4);
+        putValue(header, next.entries, 4);
+        putValue(header, flags, 1);
+        putValue(header, next.cycle, 8);
+
+        if(fwrite(header.data(), 1, header.size(), file) != header.size() ||
+           fwrite(data->data(), 1, data->size(), file) != data->size())
+            failed = true;
+
+        lock.lock();
+        next.data.clear();
+        spareBuffers.push_back(std::move(next.data));
+        drained.notify_all();
+    }
+
+    return;
+}
+
+char TraceWriter::close() {
+    if(file == nullptr)
+        return -1;
+
+    if(blockEntries != 0)
+        submitBlock();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queued.notify_one();
+    writer.join();
+
+    if(fclose(file) != 0)
+        failed = true;
+    file = nullptr;
+
+    return failed ? -1 : 0;
+}
+
+TraceReader::~TraceReader() {
+    if(file != nullptr)
+        fclose(file);
+}
+
+char TraceReader::open(std::string_view filename) {
+    unsigned char header[6];
+
+    file = fopen(std::string(filename).c_str(), "rb");
+    if(file == nullptr)
+        return -1;
+
+    if(fread(header, 1, sizeof(header), file) != sizeof(header))
+        return -1;
+
+    std::vector<unsigned char> data(header, header + sizeof(header));
+    size_t position {};
+    unsigned long long magic {}, version {};
+
+    getValue(data, position, 4, magic);
+    getValue(data, position, 2, version);
+
+    return (magic == TRACE_MAGIC && version == TRACE_VERSION) ? 0 : -1;
+}
+
+// 0 with a block loaded, 1 at a clean end of file, -1 if the file is damaged
+char TraceReader::readBlock() {
+    unsigned char header[TRACE_BLOCK_HEADER_SIZE];
+    const size_t got = fread(header, 1, sizeof(header), file);
+
+    if(got == 0 && feof(file))
+        return 1;
+    if(got != sizeof(header))
+        return -1;
+
+    std::vector<unsigned char> data(header, header + sizeof(header));
+    size_t position {};
+    unsigned long long rawSize {}, storedSize {}, entries {}, flags {}, cycle {};
+
+    getValue(data, position, 4, rawSize);
+    getValue(data, position, 4, storedSize);
+    getValue(data, position, 4, entries);
+    getValue(data, position, 1, flags);
+    getValue(data, position, 8, cycle);
+
+    if(rawSize > TRACE_MAX_BLOCK_BYTES || storedSize > TRACE_MAX_BLOCK_BYTES || entries == 0 || entries > rawSize)
+        return -1;
+
+    stored.resize(storedSize);
+    if(fread(stored.data(), 1, storedSize, file) != storedSize)
+        return -1;
+
+    if(flags & TRACE_BLOCK_COMPRESSED) {
+        block.resize(rawSize);
+        if(lzDecompress(stored.data(), stored.size(), block.data(), block.size()))
+            return -1;
+    }
+    else {
+        if(storedSize != rawSize)
+            return -1;
+        block.swap(stored);
+    }
+
+    remaining = static_cast<unsigned int>(entries);
+    previous.cycle = cycle;
+    keyframe = true;
+    offset = 0;
+
+    return 0;
+}
+
+bool TraceReader::next(TraceEntry& entry) {
+    if(file == nullptr || error)
+        return false;
+
+    while(remaining == 0) {
+        const char result = readBlock();
+        if(result == 1)
+            return false;
+
+        if(result != 0) {
+            error = true;
+            return false;
+        }
+    }
+
+    if(!decode(entry)) {
+        error = true;
+        return false;
+    }
+
+    remaining--;
+
+    return true;
+}
+
+bool TraceReader::decode(TraceEntry& entry) {
+    unsigned long long flags {}, value {};
+
+    entry = previous;
+    entry.writeLength = 0;
+
+    if(getValue(block, offset, 1, flags) || getValue(block, offset, 2, value))
+        return false;
+    entry.opcode = static_cast<unsigned short>(value);
+
+    entry.cycle = previous.cycle + 1;
+    if(flags & TRACE_ENTRY_CYCLE) {
+        if(getVarint(block, offset, value))
+            return false;
+        entry.cycle = previous.cycle + value;
+    }
+
+    entry.PC = static_cast<unsigned short>(previous.PC + 2);
+    if(flags & TRACE_ENTRY_PC) {
+        if(getValue(block, offset, 2, value))
+            return false;
+        entry.PC = static_cast<unsigned short>(value);
+    }
+    else if(keyframe) {
+        return false;
+    }
+
+    if(flags & TRACE_ENTRY_REGISTERS) {
+        unsigned long long mask {};
+        if(getVarint(block, offset, mask))
+            return false;
+
+        for(unsigned int index = 0; index < REGISTER_COUNT; index++) {
+            if(!(mask & (1U << index)))
+                continue;
+            if(getValue(block, offset, 1, value))
+                return false;
+            entry.registers.v[index] = static_cast<unsigned char>(value);
+        }
+
+        if(mask & (1U << TRACE_REGISTER_I)) {
+            if(getValue(block, offset, 2, value))
+                return false;
+            entry.registers.I = static_cast<unsigned short>(value);
+        }
+        if(mask & (1U << TRACE_REGISTER_SP)) {
+            if(getValue(block, offset, 1, value))
+                return false;
+            entry.registers.SP = static_cast<unsigned char>(value);
+        }
+        if(mask & (1U << TRACE_REGISTER_DT)) {
+            if(getValue(block, offset, 2, value))
+                return false;
+            entry.registers.delay_timer = static_cast<unsigned short>(value);
+        }
+        if(mask & (1U << TRACE_REGISTER_ST)) {
+            if(getValue(block, offset, 2, value))
+                return false;
+            entry.registers.sound_timer = static_cast<unsigned short>(value);
+        }
+
+        for(unsigned int index = 0; index < STACK_SIZE; index++) {
+            if(!(mask & (1U << (TRACE_REGISTER_STACK + index))))
+                continue;
+            if(getValue(block, offset, 2, value))
+                return false;
+            entry.registers.stack[index] = static_cast<unsigned short>(value);
+        }
+    }
+
+    if(flags & TRACE_ENTRY_WRITE) {
+        if(getValue(block, offset, 2, value))
+            return false;
+        entry.writeAddress = static_cast<unsigned short>(value);
+
+        if(getValue(block, offset, 1, value) || value == 0 || value > TRACE_MAX_WRITE || block.size() - offset < value)
+            return false;
+        entry.writeLength = static_cast<unsigned char>(value);
+        memcpy(entry.writeData, block.data() + offset, entry.writeLength);
+        offset += entry.writeLength;
+    }
+
+    previous = entry;
+    keyframe = false;
+
+    return true;
+}
@@ -0,0 +1,180 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "options.h"
+#include "trace.h"
+
+#define TRACE_CONTEXT_ENTRIES   8       // Entries shown before a divergence
+
+static void printEntry(const char* prefix, const TraceEntry& entry) {
+    printf("%s%10llu  PC: %04X  %04X  I: %04X  SP: %02X  DT: %02X  ST: %02X  V:", prefix, entry.cycle, entry.PC, entry.opcode,
+           entry.registers.I, entry.registers.SP, entry.registers.delay_timer, entry.registers.sound_timer);
+    for(unsigned int index = 0; index < REGISTER_COUNT; index++)
+        printf(" %02X", entry.registers.v[index]);
+
+    if(entry.writeLength != 0) {
+        printf("  [%04X]:", entry.writeAddress);
+        for(unsigned int index = 0; index < entry.writeLength; index++)
+            printf(" %02X", entry.writeData[index]);
+    }
+    printf("\n");
+
+    return;
+}
+
+// Field by field, the registers struct has padding
+static bool sameEntry(const TraceEntry& a, const TraceEntry& b) {
+    return a.cycle == b.cycle && a.PC == b.PC && a.opcode == b.opcode &&
+           memcmp(a.registers.v, b.registers.v, sizeof(a.registers.v)) == 0 &&
+           memcmp(a.registers.stack, b.registers.stack, sizeof(a.registers.stack)) == 0 &&
+           a.registers.I == b.registers.I && a.registers.SP == b.registers.SP &&
+           a.registers.delay_timer == b.registers.delay_timer && a.registers.sound_timer == b.registers.sound_timer &&
+           a.writeLength == b.writeLength &&
+           (a.writeLength == 0 || (a.writeAddress == b.writeAddress && memcmp(a.writeData, b.writeData, a.writeLength) == 0));
+}
+
+// One line per field that differs, empty if the entries match
+static std::string describeDifference(const TraceEntry& a, const TraceEntry& b) {
+    std::string difference {};
+    char buffer[64];
+
+    auto compare = [&](const char* name, unsigned long long first, unsigned long long second) {
+        if(first == second)
+            return;
+
+        snprintf(buffer, sizeof(buffer), "  %s: %llX != %llX\n", name, first, second);
+        difference += buffer;
+    };
+
+    compare("cycle", a.cycle, b.cycle);
+    compare("PC", a.PC, b.PC);
+    compare("opcode", a.opcode, b.opcode);
+    compare("I", a.registers.I, b.registers.I);
+    compare("SP", a.registers.SP, b.registers.SP);
+    compare("DT", a.registers.delay_timer, b.registers.delay_timer);
+    compare("ST", a.registers.sound_timer, b.registers.sound_timer);
+
+    for(unsigned int index = 0; index < REGISTER_COUNT; index++) {
+        char name[4];
+        snprintf(name, sizeof(name), "V%X", index);
+        compare(name, a.registers.v[index], b.registers.v[index]);
+    }
+    for(unsigned int index = 0; index < STACK_SIZE; index++) {
+        const std::string name = "stack[" + std::to_string(index) + "]";
+        compare(name.c_str(), a.registers.stack[index], b.registers.stack[index]);
+    }
+
+    compare("write address", a.writeAddress * (a.writeLength != 0), b.writeAddress * (b.writeLength != 0));
+    compare("write length", a.writeLength, b.writeLength);
+    if(a.writeLength == b.writeLength && memcmp(a.writeData, b.writeData, a.writeLength) != 0)
+        difference += "  write data differs\n";
+
+    return difference;
+}
+
+// Streams both traces side by side, keeps only a short ring of context
+static int diffTraces(const char* firstPath, const char* secondPath) {
+    TraceReader first, second;
+    TraceEntry firstEntry, secondEntry;
+    TraceEntry context[TRACE_CONTEXT_ENTRIES];
+    unsigned long long count {};
+
+    if(first.open(firstPath) || second.open(secondPath)) {
+        fprintf(stderr, "Could not open traces %s and %s\n", firstPath, secondPath);
+        return -1;
+    }
+
+    while(true) {
+        const bool firstMore = first.next(firstEntry);
+        const bool secondMore = second.next(secondEntry);
+
+        if(first.hasError() || second.hasError()) {
+            fprintf(stderr, "%s is damaged after %llu entries\n", first.hasError() ? firstPath : secondPath, count);
+            return -1;
+        }
+
+        if(!firstMore && !secondMore) {
+            printf("SAME %llu instructions\n", count);
+            return 0;
+        }
+
+        if(firstMore && secondMore && sameEntry(firstEntry, secondEntry)) {
+            context[count % TRACE_CONTEXT_ENTRIES] = firstEntry;
+            count++;
+            continue;
+        }
+
+        printf("DIVERGED at instruction %llu\n", count);
+        for(unsigned long long index = (count > TRACE_CONTEXT_ENTRIES) ? count - TRACE_CONTEXT_ENTRIES : 0; index < count; index++)
+            printEntry("   ", context[index % TRACE_CONTEXT_ENTRIES]);
+
+        if(firstMore)
+            printEntry(" A ", firstEntry);
+        else
+            printf(" A ends\n");
+
+        if(secondMore)
+            printEntry(" B ", secondEntry);
+        else
+            printf(" B ends\n");
+
+        if(firstMore && secondMore)
+            printf("%s", describeDifference(firstEntry, secondEntry).c_str());
+
+        return 1;
+    }
+}
+
+static int dumpTrace(const char* path, unsigned long long from, unsigned long long count) {
+    TraceReader reader;
+    TraceEntry entry;
+
+    if(reader.open(path)) {
+        fprintf(stderr, "Could not open trace %s\n", path);
+        return -1;
+    }
+
+    while(count != 0 && reader.next(entry)) {
+        if(entry.cycle < from)
+            continue;
+
+        printEntry("", entry);
+        count--;
+    }
+
+    if(reader.hasError()) {
+        fprintf(stderr, "%s is damaged\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc >= 4 && strcmp(argv[1], "diff") == 0)
+        return diffTraces(argv[2], argv[3]);
+
+    if(argc >= 3 && strcmp(argv[1], "dump") == 0) {
+        unsigned long long from {};
+        unsigned long long count = ~0ULL;
+
+        char error {};
+
+        for(int index = 3; index < argc && !error; index++) {
+            if(strncmp(argv[index], "--from=", 7) == 0)
+                error = parseNumber(argv[index] + 7, from);
+            else if(strncmp(argv[index], "--count=", 8) == 0)
+                error = parseNumber(argv[index] + 8, count);
+            else
+                error = -1;
+        }
+
+        if(!error)
+            return dumpTrace(argv[2], from, count);
+    }
+
+    fprintf(stderr, "Usage: %s diff <trace A> <trace B>\n", argv[0]);
+    fprintf(stderr, "       %s dump <trace> [--from=CYCLE] [--count=N]\n", argv[0]);
+
+    return -1;
+}
@@ -0,0 +1,887 @@
+#include <cstring>
+#include "wide_engine.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WIDE_ENGINE_X86
+#endif
+
+#define WIDE_INLINE inline __attribute__((always_inline))
+
+// Vector helpers are always inlined, their ABI never matters
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+typedef void(*WideRunner)(WideEngine& engine, unsigned int cycleBudget);
+
+WideEngine::WideInstruction WideEngine::decodeWide(unsigned short opcode, QuirkProfile profile) {
+    Opcodes::Instruction decoded = Opcodes::decodeInstruction(opcode, profile);
+    const Quirks quirks = getQuirks(profile);
+    WideInstruction instruction { WideOp::Scalar, decoded.handler, opcode, decoded.nnn,
+                                  decoded.x, decoded.y, decoded.n, decoded.nn };
+
+    // Same families as the decode tables, everything not listed stays scalar
+    switch(opcode & 0xF000) {
+        case OP_JUMP_ADDR_MASK:     instruction.op = WideOp::Jump; break;
+        case OP_CALL_SUB_MASK:      instruction.op = WideOp::Call; break;
+        case OP_LOAD_VX_RAND_MASK:  instruction.op = WideOp::Random; break;
+        case OP_DRAW_SPRITE_MASK:   instruction.op = WideOp::Draw; break;
+        case OP_SE_VX_MASK:         instruction.op = WideOp::SkipEqualImmediate; break;
+        case OP_SNE_VX_MASK:        instruction.op = WideOp::SkipNotEqualImmediate; break;
+        case OP_SE_VX_VY_MASK:
+            if(!quirks.xoExtensions || !Opcodes::isRegisterRange(opcode))
+                instruction.op = WideOp::SkipEqualRegister;
+            break;
+        case OP_SNE_VX_VY_MASK:     instruction.op = WideOp::SkipNotEqualRegister; break;
+        case OP_LOAD_VX_MASK:       instruction.op = WideOp::LoadImmediate; break;
+        case OP_ADD_VX_MASK:        instruction.op = WideOp::AddImmediate; break;
+        case OP_LOAD_I_MASK:        instruction.op = WideOp::LoadI; break;
+        case 0x0000:
+            if(opcode == OP_RETURN_FROM_SUB_MASK)
+                instruction.op = WideOp::Return;
+            break;
+        case 0xE000:
+            switch(opcode & 0xF0FF) {
+                case OP_SE_KEY_MASK:    instruction.op = WideOp::SkipKey; break;
+                case OP_SNE_KEY_MASK:   instruction.op = WideOp::SkipNotKey; break;
+            }
+            break;
+        case OP_LOAD_VX_VY_MASK:
+            switch(opcode & 0xF00F) {
+                case OP_LOAD_VX_VY_MASK:            instruction.op = WideOp::LoadRegister; break;
+                case OP_LOAD_OR_VX_VY_MASK:         instruction.op = WideOp::Or; break;
+                case OP_LOAD_AND_VX_VY_MASK:        instruction.op = WideOp::And; break;
+                case OP_LOAD_XOR_VX_VY_MASK:        instruction.op = WideOp::Xor; break;
+                case OP_LOAD_ADD_VX_VY_MASK:        instruction.op = WideOp::Add; break;
+                case OP_LOAD_SUB_VX_VY_MASK:        instruction.op = WideOp::Subtract; break;
+                case OP_LOAD_SHIFT_RIGHT_VX_MASK:   instruction.op = WideOp::ShiftRight; break;
+                case OP_LOAD_SUB_VY_VX_MASK:        instruction.op = WideOp::SubtractReversed; break;
+                case OP_LOAD_SHIFT_LEFT_VX_MASK:    instruction.op = WideOp::ShiftLeft; break;
+            }
+
+            // The vector ALU only knows the default variants
+            if(quirks.logicResetsVF && instruction.op >= WideOp::Or && instruction.op <= WideOp::Xor)
+                instruction.op = WideOp::Scalar;
+            if(quirks.shiftUsesVy && (instruction.op == WideOp::ShiftRight || instruction.op == WideOp::ShiftLeft))
+                instruction.op = WideOp::Scalar;
+            break;
+        case 0xF000:
+            switch(opcode & 0xF0FF) {
+                case OP_LOAD_VX_DELAY_MASK:     instruction.op = WideOp::LoadDelay; break;
+                case OP_LOAD_DELAY_TO_VX_MASK:  instruction.op = WideOp::SetDelay; break;
+                case OP_LOAD_SOUND_TO_VX_MASK:  instruction.op = WideOp::SetSound; break;
+                case OP_LOAD_I_VX_MASK:         instruction.op = WideOp::AddI; break;
+                case OP_LOAD_REGISTER_VALUES_MASK:
+                    instruction.op = quirks.incrementI ? WideOp::Scalar : WideOp::LoadRegisters;
+                    break;
+            }
+            break;
+    }
+
+    // A skip over F000 NNNN moves four bytes, the handler checks for it
+    const bool skips = (instruction.op >= WideOp::SkipEqualImmediate && instruction.op <= WideOp::SkipNotEqualRegister) ||
+                       instruction.op == WideOp::SkipKey || instruction.op == WideOp::SkipNotKey;
+    if(quirks.xoExtensions && skips)
+        instruction.op = WideOp::Scalar;
+
+    return instruction;
+}
+
+// Everything that reaches into WideEngine's register file, built once per vector width
+// VECTOR_BYTES is the native register size: 32 under AVX2, 16 for the SSE2 baseline
+template<unsigned int VECTOR_BYTES>
+class WideKernel {
+    public:
+        static WIDE_INLINE void runLanes(WideEngine& engine, unsigned int cycleBudget) {
+            unsigned int executed[WIDE_MAX_LANES] {};
+            unsigned int scalarExecuted[WIDE_MAX_LANES] {};
+
+            for(unsigned int bits = engine.retiredLanes; bits != 0; bits &= bits - 1)
+                executed[__builtin_ctz(bits)] = cycleBudget;
+
+            while(true) {
+                unsigned int aliveBits {};
+                unsigned int groupBits {};
+                unsigned int leader {};
+
+                for(unsigned int lane = 0; lane < engine.laneCount; lane++) {
+                    if(executed[lane] < cycleBudget)
+                        aliveBits |= 1U << lane;
+                }
+
+                if(aliveBits == 0)
+                    break;
+
+                // The lane furthest behind goes next, along with every lane at its PC
+                leader = __builtin_ctz(aliveBits);
+                for(unsigned int bits = aliveBits; bits != 0; bits &= bits - 1) {
+                    const unsigned int lane = __builtin_ctz(bits);
+
+                    if(executed[lane] < executed[leader])
+                        leader = lane;
+                }
+
+                for(unsigned int bits = aliveBits; bits != 0; bits &= bits - 1) {
+                    const unsigned int lane = __builtin_ctz(bits);
+
+                    if(engine.PC[lane] == engine.PC[leader])
+                        groupBits |= 1U << lane;
+                }
+
+                // Alone at its PC, nobody to share instructions with
+                if((groupBits & (groupBits - 1)) == 0) {
+                    retireLane(engine, leader, executed[leader], 0, cycleBudget, executed, scalarExecuted);
+                    engine.checkChurn(1, 0);
+                    continue;
+                }
+
+                const unsigned int steps = runConverged(engine, cycleBudget, groupBits, executed, scalarExecuted);
+
+                // Not worth it, every lane still running finishes the run on its own machine
+                if(engine.checkChurn(__builtin_popcount(groupBits), steps)) {
+                    for(unsigned int lane = 0; lane < engine.laneCount; lane++) {
+                        if(executed[lane] < cycleBudget)
+                            retireLane(engine, lane, executed[lane], 0, cycleBudget, executed, scalarExecuted);
+                    }
+                }
+            }
+
+            // Retired lanes were counted when they left
+            for(unsigned int lane = 0; lane < engine.laneCount; lane++) {
+                if((engine.retiredLanes >> lane) & 1)
+                    continue;
+
+                engine.vectorSteps += executed[lane] - scalarExecuted[lane];
+                engine.scalarSteps += scalarExecuted[lane];
+            }
+
+            return;
+        };
+
+    private:
+        typedef unsigned char Bytes __attribute__((vector_size(VECTOR_BYTES)));
+        typedef WideEngine::WideOp WideOp;
+        typedef WideEngine::WideInstruction WideInstruction;
+
+        // Bytes stored by the lanes of one step, checked for divergence once all of them ran
+        typedef struct {
+            size_t first;
+            size_t last;
+        }StoreRange;
+
+        static WIDE_INLINE Bytes load(const unsigned char* source) {
+            Bytes value;
+            memcpy(&value, source, sizeof(value));
+
+            return value;
+        };
+
+        static WIDE_INLINE void store(unsigned char* destination, Bytes value) {
+            memcpy(destination, &value, sizeof(value));
+            return;
+        };
+
+        // One bit per lane from an all-ones/all-zeros compare result
+        static WIDE_INLINE unsigned int laneBits(Bytes mask) {
+            unsigned int bits {};
+
+#ifdef WIDE_ENGINE_X86
+            for(unsigned int offset = 0; offset < VECTOR_BYTES; offset += 16) {
+                __m128i half;
+                memcpy(&half, reinterpret_cast<const unsigned char*>(&mask) + offset, sizeof(half));
+                bits |= static_cast<unsigned int>(_mm_movemask_epi8(half)) << offset;
+            }
+#else
+            for(unsigned int lane = 0; lane < VECTOR_BYTES; lane++)
+                bits |= (mask[lane] ? 1U : 0U) << lane;
+#endif
+
+            return bits;
+        };
+
+        // Wide instruction at pc, or Scalar when lanes might disagree on the code or PC edge cases apply
+        static WIDE_INLINE WideInstruction fetch(WideEngine& engine, unsigned short pc, unsigned int lane) {
+            WideInstruction instruction {};
+            instruction.op = WideOp::Scalar;
+
+            // Reserved space and the top of memory keep the interpreter's PC edge cases
+            if(pc < ROM_MEM_START || pc + 4 >= CHIP_8_MEM_SIZE - 1 || engine.divergent[pc] || engine.divergent[pc + 1])
+                return instruction;
+
+            WideInstruction& cached = engine.decodeCache[pc];
+            if(cached.op == WideOp::Undecoded) {
+                const Chip8& chip8 = *engine.machines[lane];
+                cached = WideEngine::decodeWide(GET_OPCODE(chip8.memory[pc], chip8.memory[pc + 1]), chip8.quirkProfile);
+            }
+
+            return cached;
+        };
+
+        // Hands one instruction to the lane's own Chip8, exactly as the interpreter would run it
+        // laneExecuted is what the lane ran before it, so loop probes in the handlers see the right cycle
+        static void scalarStep(WideEngine& engine, unsigned int lane, unsigned int laneExecuted, StoreRange& stores) {
+            Chip8& chip8 = *engine.machines[lane];
+            unsigned short pc = engine.PC[lane];
+            unsigned short storeStart = engine.I[lane] & (CHIP_8_MEM_SIZE - 1);
+            unsigned short storeSize {};
+
+            // Lanes may hold different code here, so look at this lane's own opcode
+            if(pc < CHIP_8_MEM_SIZE - 1)
+                storeSize = Opcodes::storeLength(GET_OPCODE(chip8.memory[pc], chip8.memory[pc + 1]), chip8.quirkProfile);
+
+            for(unsigned char reg = 0; reg < REGISTER_COUNT; reg++)
+                chip8.v[reg] = engine.v[reg][lane];
+            chip8.PC = engine.PC[lane];
+            chip8.I = engine.I[lane];
+            chip8.SP = engine.SP[lane];
+            chip8.delay_timer = engine.delayTimer[lane];
+            chip8.sound_timer = engine.soundTimer[lane];
+            chip8.cycleCount = engine.cycleBase[lane] + laneExecuted;
+
+            chip8.readNextInstruction();
+
+            for(unsigned char reg = 0; reg < REGISTER_COUNT; reg++)
+                engine.v[reg][lane] = chip8.v[reg];
+            engine.PC[lane] = chip8.PC;
+            engine.I[lane] = chip8.I;
+            engine.SP[lane] = chip8.SP;
+            engine.delayTimer[lane] = chip8.delay_timer;
+            engine.soundTimer[lane] = chip8.sound_timer;
+            engine.laneWrites[lane] = static_cast<unsigned int>(chip8.writeCount);
+
+            if(storeSize != 0) {
+                stores.first = std::min<size_t>(stores.first, storeStart);
+                stores.last = std::max<size_t>(stores.last, static_cast<size_t>(storeStart) + storeSize);
+            }
+
+            // The store wrapped to the start of memory, recheck all of it rather than track two ranges
+            if(static_cast<size_t>(storeStart) + storeSize > CHIP_8_MEM_SIZE) {
+                stores.first = 0;
+                stores.last = CHIP_8_MEM_SIZE;
+            }
+
+            return;
+        };
+
+        // A wide instruction for a single lane, same results as the vector path and the handlers
+        // Returns false when the lane hit a case only the handler gets exactly right (stack or memory bounds)
+        static bool stepLane(WideEngine& engine, const WideInstruction& instruction, unsigned int lane) {
+            Chip8& chip8 = *engine.machines[lane];
+            unsigned char& vx = engine.v[instruction.x][lane];
+            unsigned char& vf = engine.v[0xF][lane];
+            unsigned char x = vx;
+            unsigned char y = engine.v[instruction.y][lane];
+            unsigned short next = engine.PC[lane] + 2;
+
+            switch(instruction.op) {
+                case WideOp::Undecoded:
+                case WideOp::Scalar:
+                    return false;
+                case WideOp::Jump:                  next = instruction.nnn; break;
+                case WideOp::SkipEqualImmediate:    next += (x == instruction.nn) ? 2 : 0; break;
+                case WideOp::SkipNotEqualImmediate: next += (x != instruction.nn) ? 2 : 0; break;
+                case WideOp::SkipEqualRegister:     next += (x == y) ? 2 : 0; break;
+                case WideOp::SkipNotEqualRegister:  next += (x != y) ? 2 : 0; break;
+                case WideOp::LoadImmediate:         vx = instruction.nn; break;
+                case WideOp::AddImmediate:          vx = x + instruction.nn; break;
+                case WideOp::LoadRegister:          vx = y; break;
+                case WideOp::Or:                    vx = x | y; break;
+                case WideOp::And:                   vx = x & y; break;
+                case WideOp::Xor:                   vx = x ^ y; break;
+                case WideOp::Add:                   vx = x + y; vf = (x + y) > 0xFF; break;
+                case WideOp::Subtract:              vx = x - y; vf = y <= x; break;
+                case WideOp::ShiftRight:            vx = x >> 1; vf = x & 0x1; break;
+                case WideOp::SubtractReversed:      vx = y - x; vf = y >= x; break;
+                case WideOp::ShiftLeft:             vx = x << 1; vf = x >> 7; break;
+                case WideOp::LoadI:                 engine.I[lane] = instruction.nnn; break;
+                case WideOp::AddI:                  engine.I[lane] += x; break;
+                case WideOp::LoadDelay:             vx = static_cast<unsigned char>(engine.delayTimer[lane]); break;
+                case WideOp::SetDelay:              engine.delayTimer[lane] = x; break;
+                case WideOp::SetSound:              engine.soundTimer[lane] = x; break;
+                case WideOp::SkipKey:               next += (engine.keyMask[lane] >> (x & 0xF)) & 0x1 ? 2 : 0; break;
+                case WideOp::SkipNotKey:            next += (engine.keyMask[lane] >> (x & 0xF)) & 0x1 ? 0 : 2; break;
+                case WideOp::Random:                vx = chip8.nextRandom() & instruction.nn; break;
+                case WideOp::Call:
+                    if(engine.SP[lane] >= STACK_SIZE)
+                        return false;
+
+                    chip8.stack[engine.SP[lane]++] = next;
+                    next = instruction.nnn;
+                    break;
+                case WideOp::Return: {
+                    if(engine.SP[lane] == 0 || engine.SP[lane] > STACK_SIZE)
+                        return false;
+
+                    // setProgramCounter refuses addresses past memory and leaves PC after the return
+                    unsigned short target = chip8.stack[--engine.SP[lane]];
+                    if(target < CHIP_8_MEM_SIZE)
+                        next = target;
+                    break;
+                }
+                case WideOp::LoadRegisters:
+                    if(engine.I[lane] + instruction.x >= CHIP_8_MEM_SIZE)
+                        return false;
+
+                    for(unsigned char reg = 0; reg <= instruction.x; reg++)
+                        engine.v[reg][lane] = chip8.memory[engine.I[lane] + reg];
+                    break;
+                case WideOp::Draw: {
+                    // The sprite handler only reads Vx, Vy and I and only writes VF and the display
+                    Opcodes::Instruction decoded { instruction.handler, instruction.opcode, instruction.nnn,
+                                                   instruction.x, instruction.y, instruction.n, instruction.nn };
+                    chip8.v[instruction.x] = x;
+                    chip8.v[instruction.y] = y;
+                    chip8.I = engine.I[lane];
+                    decoded.handler(decoded, chip8);
+                    vf = chip8.v[0xF];
+                    engine.laneWrites[lane] = static_cast<unsigned int>(chip8.writeCount);
+                    break;
+                }
+            }
+
+            engine.PC[lane] = next;
+
+            return true;
+        };
+
+        // Vector body of an ALU op, flags are written after Vx like the handlers do
+        // Only lanes set in masks take the result, the rest keep their registers
+        static WIDE_INLINE void aluLanes(WideEngine& engine, const WideInstruction& instruction, const Bytes* masks) {
+            for(unsigned int offset = 0; offset < WIDE_MAX_LANES; offset += VECTOR_BYTES) {
+                const Bytes mask = masks[offset / VECTOR_BYTES];
+                Bytes x = load(&engine.v[instruction.x][offset]);
+                Bytes y = load(&engine.v[instruction.y][offset]);
+                Bytes result {};
+                Bytes flag {};
+                bool writesFlag = false;
+
+                switch(instruction.op) {
+                    case WideOp::LoadImmediate:     result = Bytes {} + instruction.nn; break;
+                    case WideOp::AddImmediate:      result = x + instruction.nn; break;
+                    case WideOp::LoadRegister:      result = y; break;
+                    case WideOp::Or:                result = x | y; break;
+                    case WideOp::And:               result = x & y; break;
+                    case WideOp::Xor:               result = x ^ y; break;
+                    case WideOp::Add:               result = x + y; flag = (Bytes)(result < x) & 1; writesFlag = true; break;
+                    case WideOp::Subtract:          result = x - y; flag = (Bytes)(y <= x) & 1; writesFlag = true; break;
+                    case WideOp::ShiftRight:        result = x >> 1; flag = x & 1; writesFlag = true; break;
+                    case WideOp::SubtractReversed:  result = y - x; flag = (Bytes)(y >= x) & 1; writesFlag = true; break;
+                    case WideOp::ShiftLeft:         result = x << 1; flag = x >> 7; writesFlag = true; break;
+                    default:                        result = x; break;
+                }
+
+                store(&engine.v[instruction.x][offset], (result & mask) | (x & ~mask));
+                if(writesFlag)
+                    store(&engine.v[0xF][offset], (flag & mask) | (load(&engine.v[0xF][offset]) & ~mask));
+            }
+
+            return;
+        };
+
+        // Lanes whose skip condition holds, one bit per lane
+        static WIDE_INLINE unsigned int skipTaken(WideEngine& engine, const WideInstruction& instruction) {
+            unsigned int taken {};
+
+            for(unsigned int offset = 0; offset < WIDE_MAX_LANES; offset += VECTOR_BYTES) {
+                Bytes x = load(&engine.v[instruction.x][offset]);
+                Bytes y = (instruction.op == WideOp::SkipEqualImmediate || instruction.op == WideOp::SkipNotEqualImmediate)
+                          ? Bytes {} + instruction.nn : load(&engine.v[instruction.y][offset]);
+                Bytes equal = (Bytes)(x == y);
+
+                taken |= laneBits(equal) << offset;
+            }
+
+            if(instruction.op == WideOp::SkipNotEqualImmediate || instruction.op == WideOp::SkipNotEqualRegister)
+                taken = ~taken;
+
+            return taken;
+        };
+
+        // All-ones bytes for the lanes set in bits, starting at lane offset
+        static WIDE_INLINE Bytes laneMask(unsigned int bits, unsigned int offset) {
+            unsigned char mask[VECTOR_BYTES];
+
+            for(unsigned int lane = 0; lane < VECTOR_BYTES; lane++)
+                mask[lane] = ((bits >> (offset + lane)) & 1) ? 0xFF : 0x00;
+
+            return load(mask);
+        };
+
+        // The lanes in mask just jumped back to head, same rules as Chip8::probeLoop
+        // Lanes whose registers changed are told apart with vector compares and only have their
+        // probe moved, the per lane comparison is left for lanes that might really be idle
+        // Returns the lanes that came back to the same state with nothing written in between,
+        // periods gets how many instructions one of their idle iterations takes
+        static unsigned int probeLanes(WideEngine& engine, unsigned short head, unsigned int mask,
+                                       const unsigned int* executed, unsigned int offset, unsigned int* periods) {
+            unsigned int same {};
+            unsigned int idle {};
+
+            for(unsigned int lane = 0; lane < WIDE_MAX_LANES; lane += VECTOR_BYTES) {
+                const Bytes select = laneMask(mask, lane);
+                Bytes equal = ~Bytes {};
+
+                for(unsigned char reg = 0; reg < REGISTER_COUNT; reg++) {
+                    const Bytes current = load(&engine.v[reg][lane]);
+                    const Bytes previous = load(&engine.probeV[reg][lane]);
+
+                    equal &= (Bytes)(current == previous);
+                    store(&engine.probeV[reg][lane], (current & select) | (previous & ~select));
+                }
+
+                same |= laneBits(equal) << lane;
+            }
+
+            // Registers moved on, this visit is the new starting point
+            const unsigned int moved = mask & ~same;
+            for(unsigned int lane = 0; lane < engine.laneCount; lane++) {
+                if((moved >> lane) & 1) {
+                    engine.probeHead[lane] = head;
+                    engine.probeCycle[lane] = executed[lane] + offset;
+                    engine.probeWrites[lane] = engine.laneWrites[lane];
+                }
+            }
+            engine.probeComplete &= ~moved;
+
+            for(unsigned int bits = mask & same; bits != 0; bits &= bits - 1) {
+                const unsigned int lane = __builtin_ctz(bits);
+                const unsigned int now = executed[lane] + offset;
+                const Chip8& chip8 = *engine.machines[lane];
+                WideEngine::LaneProbe& probe = engine.laneProbes[lane];
+
+                if(engine.probeHead[lane] != head || engine.probeWrites[lane] != engine.laneWrites[lane]) {
+                    engine.probeHead[lane] = head;
+                    engine.probeCycle[lane] = now;
+                    engine.probeWrites[lane] = engine.laneWrites[lane];
+                    engine.probeComplete &= ~(1U << lane);
+                    continue;
+                }
+
+                // Same head, same registers and no writes, the rest of the machine decides
+                if(((engine.probeComplete >> lane) & 1) && probe.I == engine.I[lane] && probe.SP == engine.SP[lane] &&
+                   probe.delayTimer == engine.delayTimer[lane] && probe.soundTimer == engine.soundTimer[lane] &&
+                   probe.randomState == chip8.randomState && probe.planeMask == chip8.planeMask &&
+                   probe.audioPitch == chip8.audioPitch && memcmp(probe.stack, chip8.stack, sizeof(probe.stack)) == 0) {
+                    periods[lane] = now - engine.probeCycle[lane];
+                    engine.probeCycle[lane] = now;
+                    idle |= 1U << lane;
+                    continue;
+                }
+
+                probe.I = engine.I[lane];
+                probe.SP = engine.SP[lane];
+                probe.delayTimer = engine.delayTimer[lane];
+                probe.soundTimer = engine.soundTimer[lane];
+                probe.randomState = chip8.randomState;
+                probe.planeMask = chip8.planeMask;
+                probe.audioPitch = chip8.audioPitch;
+                memcpy(probe.stack, chip8.stack, sizeof(probe.stack));
+                engine.probeCycle[lane] = now;
+                engine.probeComplete |= 1U << lane;
+            }
+
+            return idle;
+        };
+
+        // The lane leaves the lockstep after laneExecuted instructions, its Chip8 runs the rest of the run
+        // in WideEngine::run once the other lanes are done. A lane that went idle skips its whole idle
+        // iterations first, the way the scalar cores skip them, idlePeriod 0 means it's just on its own
+        static void retireLane(WideEngine& engine, unsigned int lane, unsigned int laneExecuted, unsigned int idlePeriod,
+                               unsigned int cycleBudget, unsigned int* executed, const unsigned int* scalarExecuted) {
+            Chip8& chip8 = *engine.machines[lane];
+            const unsigned int remaining = cycleBudget - laneExecuted;
+
+            engine.storeLane(lane, laneExecuted);
+            engine.leftover[lane] = remaining;
+
+            if(idlePeriod != 0) {
+                chip8.idlePeriod = idlePeriod;
+                const unsigned int skipped = chip8.skipIdleCycles(remaining);
+                engine.leftover[lane] -= skipped;
+                engine.idleSteps += skipped;
+                engine.parkedLanes |= 1U << lane;
+            }
+
+            engine.vectorSteps += laneExecuted - scalarExecuted[lane];
+            engine.scalarSteps += scalarExecuted[lane];
+            engine.retiredLanes |= 1U << lane;
+            executed[lane] = cycleBudget;
+
+            return;
+        };
+
+        // Every lane in active at the same PC: one decode and one vector op per instruction
+        // Lanes outside active may be at other PCs, vector results are masked off for them
+        // Runs until the lanes split, go idle or run out of budget, returns how many instructions that took
+        static WIDE_INLINE unsigned int runConverged(WideEngine& engine, unsigned int cycleBudget, unsigned int active,
+                                             unsigned int* executed, unsigned int* scalarExecuted) {
+            unsigned short pc = engine.PC[__builtin_ctz(active)];
+            unsigned int mostExecuted {};
+            unsigned int done {};
+            Bytes masks[WIDE_MAX_LANES / VECTOR_BYTES];
+
+            // Lanes retiring below keep getting results, their registers already went back to their Chip8
+            for(unsigned int offset = 0; offset < WIDE_MAX_LANES; offset += VECTOR_BYTES)
+                masks[offset / VECTOR_BYTES] = laneMask(active, offset);
+
+            for(unsigned int bits = active; bits != 0; bits &= bits - 1)
+                mostExecuted = std::max(mostExecuted, executed[__builtin_ctz(bits)]);
+
+            const unsigned int steps = cycleBudget - mostExecuted;
+
+            while(done < steps) {
+                WideInstruction instruction = fetch(engine, pc, __builtin_ctz(active));
+                done++;
+
+                switch(instruction.op) {
+                    case WideOp::Undecoded:
+                    case WideOp::Scalar:
+                    case WideOp::Call:
+                    case WideOp::Return:
+                    case WideOp::SkipKey:
+                    case WideOp::SkipNotKey:
+                    case WideOp::Random:
+                    case WideOp::Draw:
+                    case WideOp::LoadRegisters: {
+                        StoreRange stores { CHIP_8_MEM_SIZE, 0 };
+                        bool together = true;
+
+                        for(unsigned int bits = active; bits != 0; bits &= bits - 1) {
+                            const unsigned int lane = __builtin_ctz(bits);
+
+                            engine.PC[lane] = pc;
+                            if(!stepLane(engine, instruction, lane)) {
+                                scalarStep(engine, lane, executed[lane] + done - 1, stores);
+                                scalarExecuted[lane]++;
+
+                                // FX0A, 00FD, or a loop the handler's own probe caught
+                                if(engine.machines[lane]->isIdle()) {
+                                    retireLane(engine, lane, executed[lane] + done, engine.machines[lane]->idlePeriod,
+                                               cycleBudget, executed, scalarExecuted);
+                                    active &= ~(1U << lane);
+                                    continue;
+                                }
+                            }
+                        }
+
+                        if(stores.last > stores.first)
+                            engine.markStore(stores.first, stores.last - stores.first);
+
+                        if(active == 0)
+                            return done;
+
+                        pc = engine.PC[__builtin_ctz(active)];
+                        for(unsigned int bits = active; bits != 0; bits &= bits - 1)
+                            together &= engine.PC[__builtin_ctz(bits)] == pc;
+
+                        if(!together) {
+                            advance(active, executed, done);
+                            return done;
+                        }
+                        continue;
+                    }
+                    case WideOp::Jump:
+                        // Backward jumps close loops, lanes that came back unchanged leave the lockstep
+                        if(instruction.nnn <= pc) {
+                            unsigned int periods[WIDE_MAX_LANES];
+                            const unsigned int idle = probeLanes(engine, instruction.nnn, active, executed, done, periods);
+
+                            for(unsigned int bits = idle; bits != 0; bits &= bits - 1) {
+                                const unsigned int lane = __builtin_ctz(bits);
+
+                                engine.PC[lane] = instruction.nnn;
+                                retireLane(engine, lane, executed[lane] + done, periods[lane], cycleBudget, executed, scalarExecuted);
+                            }
+
+                            active &= ~idle;
+                            if(active == 0)
+                                return done;
+                        }
+
+                        pc = instruction.nnn;
+                        continue;
+                    case WideOp::SkipEqualImmediate:
+                    case WideOp::SkipNotEqualImmediate:
+                    case WideOp::SkipEqualRegister:
+                    case WideOp::SkipNotEqualRegister: {
+                        unsigned int taken = skipTaken(engine, instruction) & active;
+
+                        if(taken != 0 && taken != active) {
+                            for(unsigned int bits = active; bits != 0; bits &= bits - 1) {
+                                const unsigned int lane = __builtin_ctz(bits);
+                                engine.PC[lane] = pc + ((taken >> lane) & 1 ? 4 : 2);
+                            }
+                            advance(active, executed, done);
+                            return done;
+                        }
+
+                        pc += taken ? 4 : 2;
+                        continue;
+                    }
+                    case WideOp::LoadI:
+                        for(unsigned int bits = active; bits != 0; bits &= bits - 1)
+                            engine.I[__builtin_ctz(bits)] = instruction.nnn;
+                        break;
+                    case WideOp::AddI:
+                        for(unsigned int bits = active; bits != 0; bits &= bits - 1) {
+                            const unsigned int lane = __builtin_ctz(bits);
+                            engine.I[lane] += engine.v[instruction.x][lane];
+                        }
+                        break;
+                    case WideOp::LoadDelay:
+                        for(unsigned int bits = active; bits != 0; bits &= bits - 1) {
+                            const unsigned int lane = __builtin_ctz(bits);
+                            engine.v[instruction.x][lane] = static_cast<unsigned char>(engine.delayTimer[lane]);
+                        }
+                        break;
+                    case WideOp::SetDelay:
+                        for(unsigned int bits = active; bits != 0; bits &= bits - 1) {
+                            const unsigned int lane = __builtin_ctz(bits);
+                            engine.delayTimer[lane] = engine.v[instruction.x][lane];
+                        }
+                        break;
+                    case WideOp::SetSound:
+                        for(unsigned int bits = active; bits != 0; bits &= bits - 1) {
+                            const unsigned int lane = __builtin_ctz(bits);
+                            engine.soundTimer[lane] = engine.v[instruction.x][lane];
+                        }
+                        break;
+                    default:
+                        aluLanes(engine, instruction, masks);
+                        break;
+                }
+
+                pc += 2;
+            }
+
+            for(unsigned int bits = active; bits != 0; bits &= bits - 1)
+                engine.PC[__builtin_ctz(bits)] = pc;
+            advance(active, executed, done);
+
+            return done;
+        };
+
+        static WIDE_INLINE void advance(unsigned int active, unsigned int* executed, unsigned int done) {
+            for(unsigned int bits = active; bits != 0; bits &= bits - 1)
+                executed[__builtin_ctz(bits)] += done;
+
+            return;
+        };
+};
+
+static void runBaseline(WideEngine& engine, unsigned int cycleBudget) {
+    WideKernel<16>::runLanes(engine, cycleBudget);
+    return;
+}
+
+#ifdef WIDE_ENGINE_X86
+__attribute__((target("avx2")))
+static void runAVX2(WideEngine& engine, unsigned int cycleBudget) {
+    WideKernel<32>::runLanes(engine, cycleBudget);
+    return;
+}
+#endif
+
+static WideRunner selectRunner() {
+#ifdef WIDE_ENGINE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return &runAVX2;
+#endif
+    return &runBaseline;
+}
+
+WideEngine::WideEngine(Chip8* const* machines, unsigned int count) {
+    laneCount = std::min<unsigned int>(count, WIDE_MAX_LANES);
+    std::copy(machines, machines + laneCount, this->machines.begin());
+
+    resync();
+}
+
+unsigned int WideEngine::run(unsigned int cycleBudget) {
+    static const WideRunner runner = selectRunner();
+    const unsigned int allLanes = ~0U >> (WIDE_MAX_LANES - laneCount);
+
+    // Probes from the last run don't count, inputs may have changed since
+    for(unsigned int lane = 0; lane < laneCount; lane++)
+        machines[lane]->beginSlice();
+
+    // A lane waiting on a key or the timers rarely wakes up within a run, so lanes that went idle
+    // last time run on their own machine like the interpreter and rejoin once they stop idling
+    // All of them do while the lockstep is on a break, see checkChurn
+    retiredLanes = parkedLanes;
+    parkedLanes = 0;
+    if(soloRuns != 0) {
+        retiredLanes = allLanes;
+        soloRuns--;
+    }
+    for(unsigned int bits = retiredLanes; bits != 0; bits &= bits - 1)
+        leftover[__builtin_ctz(bits)] = cycleBudget;
+
+    // With every lane on its own machine there's no register file to fill
+    if(retiredLanes != allLanes) {
+        std::fill_n(probeHead, WIDE_MAX_LANES, LOOP_PROBE_NONE);
+        probeComplete = 0;
+
+        loadLanes();
+        runner(*this, cycleBudget);
+        storeLanes(cycleBudget);
+    }
+    runLeftovers();
+
+    return cycleBudget;
+}
+
+void WideEngine::resync() {
+    divergent.reset();
+    decodeCache.fill({});
+
+    for(unsigned int lane = 1; lane < laneCount; lane++) {
+        for(size_t addr = 0; addr < CHIP_8_MEM_SIZE; addr++) {
+            if(machines[lane]->memory[addr] != machines[0]->memory[addr])
+                divergent.set(addr);
+        }
+    }
+
+    return;
+}
+
+void WideEngine::loadLanes() {
+    for(unsigned int lane = 0; lane < laneCount; lane++) {
+        const Chip8& chip8 = *machines[lane];
+
+        if((retiredLanes >> lane) & 1)
+            continue;
+
+        for(unsigned char reg = 0; reg < REGISTER_COUNT; reg++)
+            v[reg][lane] = chip8.v[reg];
+        PC[lane] = chip8.PC;
+        I[lane] = chip8.I;
+        SP[lane] = chip8.SP;
+        delayTimer[lane] = chip8.delay_timer;
+        soundTimer[lane] = chip8.sound_timer;
+        keyMask[lane] = chip8.getKeyMask();
+        cycleBase[lane] = chip8.cycleCount;
+        laneWrites[lane] = static_cast<unsigned int>(chip8.writeCount);
+    }
+
+    return;
+}
+
+// Hands the lane's registers back to its machine, executed is how far the lane got
+void WideEngine::storeLane(unsigned int lane, unsigned int executed) {
+    Chip8& chip8 = *machines[lane];
+
+    for(unsigned char reg = 0; reg < REGISTER_COUNT; reg++)
+        chip8.v[reg] = v[reg][lane];
+    chip8.PC = PC[lane];
+    chip8.I = I[lane];
+    chip8.SP = SP[lane];
+    chip8.delay_timer = delayTimer[lane];
+    chip8.sound_timer = soundTimer[lane];
+    chip8.cycleCount = cycleBase[lane] + executed;
+
+    return;
+}
+
+// Retired lanes already handed theirs back when they went idle
+void WideEngine::storeLanes(unsigned int executed) {
+    for(unsigned int lane = 0; lane < laneCount; lane++) {
+        if(!((retiredLanes >> lane) & 1))
+            storeLane(lane, executed);
+    }
+
+    return;
+}
+
+// Retired lanes finish the run on their own machine, the same loop InterpreterCore runs
+// Whatever they store goes through markStore like any other scalar store, once for all of them
+// since it compares every lane anyway
+void WideEngine::runLeftovers() {
+    size_t first = CHIP_8_MEM_SIZE;
+    size_t last {};
+
+    for(unsigned int lane = 0; lane < laneCount; lane++) {
+        if(!((retiredLanes >> lane) & 1))
+            continue;
+
+        Chip8& chip8 = *machines[lane];
+        unsigned short storeStart {};
+        unsigned short storeEnd {};
+        bool wentIdle {};
+
+        chip8.takeWrittenRange(storeStart, storeEnd);
+        for(unsigned int cycle = 0; cycle < leftover[lane]; cycle++) {
+            chip8.readNextInstruction();
+
+            if(chip8.isIdle()) {
+                const unsigned int skipped = chip8.skipIdleCycles(leftover[lane] - cycle - 1);
+                cycle += skipped;
+                idleSteps += skipped;
+                wentIdle = true;
+            }
+        }
+
+        chip8.takeWrittenRange(storeStart, storeEnd);
+        if(storeEnd > storeStart) {
+            first = std::min<size_t>(first, storeStart);
+            last = std::max<size_t>(last, storeEnd);
+        }
+
+        if(wentIdle)
+            parkedLanes |= 1U << lane;
+        scalarSteps += leftover[lane];
+    }
+
+    if(last > first)
+        markStore(first, last - first);
+
+    return;
+}
+
+// Counts a regroup of groupLanes lanes that ran steps instructions together, true once a whole
+// window of them averaged too little work to beat running the lanes one by one. The lanes then
+// stay solo for a while, longer each time the lockstep fails again right after
+bool WideEngine::checkChurn(unsigned int groupLanes, unsigned int steps) {
+    groupSteps += groupLanes * steps;
+    if(++regroups < WIDE_CHURN_WINDOW)
+        return false;
+
+    const bool churning = groupSteps < WIDE_CHURN_WINDOW * WIDE_GROUP_STEPS;
+    regroups = 0;
+    groupSteps = 0;
+
+    if(!churning) {
+        soloBackoff = WIDE_MIN_SOLO_RUNS;
+        return false;
+    }
+
+    soloRuns = soloBackoff;
+    soloBackoff = std::min<unsigned int>(soloBackoff * 2, WIDE_MAX_SOLO_RUNS);
+
+    return true;
+}
+
+// A store may leave lanes holding different bytes, or rewrite code they all share
+// Compared a lane at a time, so each pass walks one machine's memory in order
+void WideEngine::markStore(size_t start, size_t size) {
+    size_t last = std::min<size_t>(start + size, CHIP_8_MEM_SIZE);
+    const unsigned char* first = machines[0]->memory;
+    unsigned char differs[CHIP_8_MEM_SIZE];
+
+    std::fill(differs + start, differs + last, 0);
+    for(unsigned int lane = 1; lane < laneCount; lane++) {
+        const unsigned char* memory = machines[lane]->memory;
+
+        for(size_t addr = start; addr < last; addr++)
+            differs[addr] |= memory[addr] ^ first[addr];
+    }
+
+    for(size_t addr = start; addr < last; addr++) {
+        divergent[addr] = differs[addr] != 0;
+        decodeCache[addr].op = WideOp::Undecoded;
+        if(addr > 0)
+            decodeCache[addr - 1].op = WideOp::Undecoded;
+    }
+
+    return;
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "aot.h"
+#include "block_engine.h"
+#include "chip8.h"
+#include "cpu_core.h"
+#include "options.h"
+#include "rom.h"
+#include "scheduler.h"
+#include "wide_engine.h"
+
+#define ENGINES_DEFAULT_FRAMES  1200
+#define ENGINES_COPIES          4       // Lanes for the wide engine, and copies every other engine runs
+
+typedef struct {
+    std::unique_ptr<AotLibrary> aotLibrary {};
+    unsigned int frames { ENGINES_DEFAULT_FRAMES };
+    std::vector<unsigned int> cyclesPerFrame { DEFAULT_CYCLES_PER_FRAME, 1000 };
+    std::vector<std::string> roms {};
+}EnginesOptions;
+
+// State hash of every copy after every frame
+using HashTrace = std::vector<std::vector<unsigned long long>>;
+
+static void addRoms(const std::string& path, std::vector<std::string>& roms) {
+    if(!std::filesystem::is_directory(path)) {
+        roms.push_back(path);
+        return;
+    }
+
+    std::vector<std::string> found {};
+    for(const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+        if(entry.is_regular_file() && entry.path().extension() == ".ch8")
+            found.push_back(entry.path().string());
+    }
+
+    std::sort(found.begin(), found.end());
+    roms.insert(roms.end(), found.begin(), found.end());
+
+    return;
+}
+
+static char parseOptions(int argc, char* argv[], EnginesOptions& options) {
+    for(int index = 1; index < argc; index++) {
+        const char* arg = argv[index];
+
+        if(strncmp(arg, "--frames=", 9) == 0) {
+            if(parseNumber(arg + 9, options.frames))
+                return -1;
+        }
+        else if(strncmp(arg, "--cycles-per-frame=", 19) == 0) {
+            unsigned int cyclesPerFrame {};
+            if(parseNumber(arg + 19, cyclesPerFrame) || cyclesPerFrame == 0)
+                return -1;
+            options.cyclesPerFrame = { cyclesPerFrame };
+        }
+        else if(strncmp(arg, "--aot=", 6) == 0)
+            options.aotLibrary = std::make_unique<AotLibrary>(arg + 6);
+        else if(strncmp(arg, "--", 2) == 0)
+            return -1;
+        else
+            addRoms(arg, options.roms);
+    }
+
+    return options.roms.empty() ? -1 : 0;
+}
+
+// Each copy presses its own keys, so wide lanes split on key checks as well as on random numbers
+static unsigned short keysFor(unsigned int copy, unsigned int frame) {
+    frame += copy * 37;
+    return ((frame / 20) % 3 == 2) ? 0 : static_cast<unsigned short>(1 << ((frame / 45 + copy) % 16));
+}
+
+static char loadCopies(const std::string& rom, std::vector<std::unique_ptr<Chip8>>& machines) {
+    MappedRomManager romManager;
+
+    for(unsigned int copy = 0; copy < ENGINES_COPIES; copy++) {
+        machines.push_back(std::make_unique<Chip8>());
+        if(romManager.loadRom(rom, *machines.back()))
+            return -1;
+        machines.back()->seedRandom(copy);
+    }
+
+    return 0;
+}
+
+// One machine per copy on a scalar core, module picks an AOT module for BlockCore
+static char runScalar(const EnginesOptions& options, const std::string& rom, unsigned int cyclesPerFrame,
+                      bool block, const AotModule* module, HashTrace& hashes) {
+    std::vector<std::unique_ptr<Chip8>> machines {};
+
+    if(loadCopies(rom, machines))
+        return -1;
+
+    hashes.assign(ENGINES_COPIES, {});
+    for(unsigned int copy = 0; copy < ENGINES_COPIES; copy++) {
+        std::unique_ptr<CpuCore> cpuCore {};
+
+        if(block) {
+            std::unique_ptr<BlockCore> blockCore = std::make_unique<BlockCore>();
+            blockCore->setNativeModule(module);
+            cpuCore = std::move(blockCore);
+        }
+        else
+            cpuCore = std::make_unique<InterpreterCore>();
+
+        FrameScheduler scheduler(cyclesPerFrame, true);
+        for(unsigned int frame = 0; frame < options.frames; frame++) {
+            machines[copy]->setKeyMask(keysFor(copy, frame));
+            scheduler.runFrame(*machines[copy], *cpuCore);
+            hashes[copy].push_back(machines[copy]->getStateHash());
+        }
+    }
+
+    return 0;
+}
+
+// Every copy as a lane of one WideEngine
+static char runWide(const EnginesOptions& options, const std::string& rom, unsigned int cyclesPerFrame, HashTrace& hashes) {
+    std::vector<std::unique_ptr<Chip8>> machines {};
+    std::vector<Chip8*> lanes {};
+
+    if(loadCopies(rom, machines))
+        return -1;
+
+    for(const auto &machine : machines)
+        lanes.push_back(machine.get());
+
+    WideEngine engine(lanes.data(), ENGINES_COPIES);
+    hashes.assign(ENGINES_COPIES, {});
+    for(unsigned int frame = 0; frame < options.frames; frame++) {
+        for(unsigned int copy = 0; copy < ENGINES_COPIES; copy++)
+            machines[copy]->setKeyMask(keysFor(copy, frame));
+
+        engine.run(cyclesPerFrame);
+        engine.tickTimers();
+
+        for(unsigned int copy = 0; copy < ENGINES_COPIES; copy++)
+            hashes[copy].push_back(machines[copy]->getStateHash());
+    }
+
+    return 0;
+}
+
+// Reports the first frame an engine left the interpreter, false if it never did
+static bool diverged(const char* engine, const std::string& rom, unsigned int cyclesPerFrame,
+                     const HashTrace& reference, const HashTrace& hashes) {
+    for(unsigned int copy = 0; copy < ENGINES_COPIES; copy++) {
+        for(size_t frame = 0; frame < reference[copy].size(); frame++) {
+            if(hashes[copy][frame] != reference[copy][frame]) {
+                printf("DIVERGED %-6s copy %u frame %zu (%u cycles per frame) %s\n",
+                       engine, copy, frame, cyclesPerFrame, rom.c_str());
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    EnginesOptions options {};
+
+    if(parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s [--frames=N] [--cycles-per-frame=N] [--aot=DIR] <ROM or directory>...\n", argv[0]);
+        return -1;
+    }
+
+    int failures {};
+    for(const auto &rom : options.roms) {
+        const AotModule* module {};
+
+        // Asking for AOT and not finding the ROM's module would quietly compare block against itself
+        if(options.aotLibrary != nullptr) {
+            module = options.aotLibrary->find(RomCache::acquire(rom)->getHash());
+            if(module == nullptr) {
+                printf("NO-MODULE %s\n", rom.c_str());
+                failures++;
+                continue;
+            }
+        }
+
+        for(unsigned int cyclesPerFrame : options.cyclesPerFrame) {
+            HashTrace reference, hashes;
+
+            if(runScalar(options, rom, cyclesPerFrame, false, nullptr, reference)) {
+                printf("LOAD-FAILED %s\n", rom.c_str());
+                failures++;
+                break;
+            }
+
+            runScalar(options, rom, cyclesPerFrame, true, nullptr, hashes);
+            failures += diverged("block", rom, cyclesPerFrame, reference, hashes);
+
+            runWide(options, rom, cyclesPerFrame, hashes);
+            failures += diverged("wide", rom, cyclesPerFrame, reference, hashes);
+
+            if(module != nullptr) {
+                runScalar(options, rom, cyclesPerFrame, true, module, hashes);
+                failures += diverged("aot", rom, cyclesPerFrame, reference, hashes);
+            }
+        }
+    }
+
+    printf("%zu ROMs, %d failures\n", options.roms.size(), failures);
+
+    return failures ? 1 : 0;
+}
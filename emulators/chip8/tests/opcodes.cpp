@@ -0,0 +1,233 @@
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+#include "block_engine.h"
+#include "chip8.h"
+#include "cpu_core.h"
+#include "quirks.h"
+
+#define SPRITE_ADDR     0x300   // Where the tests put sprite data and point I at stores
+
+// Failed checks print where they are and the run carries on, the exit code says if any did
+static int failures {};
+
+#define CHECK(condition)                                                                \
+    do {                                                                                \
+        if(!(condition)) {                                                              \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                                 \
+        }                                                                               \
+    } while(0)
+
+static const QuirkProfile Profiles[] {
+    QuirkProfile::Default, QuirkProfile::Chip8, QuirkProfile::SuperChip, QuirkProfile::XOChip
+};
+
+// A fresh machine under profile with program at ROM_MEM_START, nothing run yet
+static std::unique_ptr<Chip8> loadProgram(QuirkProfile profile, std::initializer_list<unsigned short> program) {
+    std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+    std::vector<unsigned char> bytes {};
+
+    for(unsigned short opcode : program) {
+        bytes.push_back(static_cast<unsigned char>(opcode >> 8));
+        bytes.push_back(static_cast<unsigned char>(opcode & 0xFF));
+    }
+
+    chip8->setQuirkProfile(profile);
+    chip8->writeMemory(bytes.data(), bytes.size(), ROM_MEM_START);
+
+    return chip8;
+}
+
+static void step(Chip8& chip8, unsigned int count) {
+    for(unsigned int index = 0; index < count; index++)
+        chip8.readNextInstruction();
+
+    return;
+}
+
+static bool pixelAt(const Chip8& chip8, int x, int y) {
+    const pixels::PackedRow row = chip8.getPixels()[0][y * pixels::ROW_WORDS + x / pixels::PACKED_ROW_BITS];
+
+    return (row >> (pixels::PACKED_ROW_BITS - 1 - x % pixels::PACKED_ROW_BITS)) & 1;
+}
+
+static int pixelCount(const Chip8& chip8) {
+    int count {};
+
+    for(pixels::PackedRow row : chip8.getPixels()[0])
+        count += __builtin_popcountll(row);
+
+    return count;
+}
+
+// 00CN, 00FB and 00FC move a single hires pixel around
+static void checkScrolls() {
+    const unsigned char dot = 0x80;
+    std::unique_ptr<Chip8> chip8 = loadProgram(QuirkProfile::SuperChip, {
+        0x00FF, 0xA000 | SPRITE_ADDR, 0x6008, 0x6100, 0xD011, 0x00C3, 0x00FB, 0x00FC, 0x00FC
+    });
+    chip8->writeMemory(&dot, 1, SPRITE_ADDR);
+
+    step(*chip8, 5);
+    CHECK(chip8->isHires());
+    CHECK(pixelAt(*chip8, 8, 0));
+
+    step(*chip8, 1);
+    CHECK(pixelAt(*chip8, 8, 3) && pixelCount(*chip8) == 1);
+
+    step(*chip8, 1);
+    CHECK(pixelAt(*chip8, 12, 3) && pixelCount(*chip8) == 1);
+
+    step(*chip8, 2);
+    CHECK(pixelAt(*chip8, 4, 3) && pixelCount(*chip8) == 1);
+
+    return;
+}
+
+// DXY0 draws a 16x16 sprite two bytes a row, drawing it again erases it and sets VF
+static void checkLargeSprite() {
+    unsigned char sprite[32] {};
+    for(int row = 0; row < 16; row++) {
+        sprite[row * 2] = static_cast<unsigned char>((0x8000 >> row) >> 8);
+        sprite[row * 2 + 1] = static_cast<unsigned char>((0x8000 >> row) & 0xFF);
+    }
+
+    std::unique_ptr<Chip8> chip8 = loadProgram(QuirkProfile::SuperChip, {
+        0x00FF, 0xA000 | SPRITE_ADDR, 0x6004, 0x6102, 0xD010, 0xD010
+    });
+    chip8->writeMemory(sprite, sizeof(sprite), SPRITE_ADDR);
+
+    step(*chip8, 5);
+    for(int row = 0; row < 16; row++)
+        CHECK(pixelAt(*chip8, 4 + row, 2 + row));
+    CHECK(pixelCount(*chip8) == 16);
+    CHECK(chip8->getRegisterValue(0xF) == 0);
+
+    step(*chip8, 1);
+    CHECK(pixelCount(*chip8) == 0);
+    CHECK(chip8->getRegisterValue(0xF) == 1);
+
+    return;
+}
+
+// Every profile has to do exactly what its row of QuirkTable says
+static void checkQuirks(QuirkProfile profile) {
+    const Quirks quirks = getQuirks(profile);
+
+    // 8XY6 with V0 = 5, V1 = 6
+    std::unique_ptr<Chip8> chip8 = loadProgram(profile, { 0x6005, 0x6106, 0x8016 });
+    step(*chip8, 3);
+    CHECK(chip8->getRegisterValue(0) == (quirks.shiftUsesVy ? 3 : 2));
+    CHECK(chip8->getRegisterValue(0xF) == (quirks.shiftUsesVy ? 0 : 1));
+
+    // B210 with V0 = 0, V2 = 4
+    chip8 = loadProgram(profile, { 0x6000, 0x6204, 0xB210 });
+    step(*chip8, 3);
+    CHECK(chip8->getProgramCounter() == (quirks.jumpUsesVx ? 0x214 : 0x210));
+
+    // Two FX55 in a row land on top of each other unless I moves
+    chip8 = loadProgram(profile, { 0xA000 | SPRITE_ADDR, 0x6007, 0xF055, 0x6008, 0xF055 });
+    step(*chip8, 5);
+    CHECK(chip8->getMachineCode(SPRITE_ADDR) == (quirks.incrementI ? 7 : 8));
+    CHECK(chip8->getMachineCode(SPRITE_ADDR + 1) == (quirks.incrementI ? 8 : 0));
+
+    // The font's top row of 0 is four pixels wide, drawn two pixels from the right edge
+    chip8 = loadProgram(profile, { 0x6000, 0xF029, 0x603E, 0x6100, 0xD015 });
+    step(*chip8, 5);
+    CHECK(pixelAt(*chip8, 62, 0) && pixelAt(*chip8, 63, 0));
+    CHECK(pixelAt(*chip8, 0, 0) == quirks.wrapSprites);
+    CHECK(pixelAt(*chip8, 1, 0) == quirks.wrapSprites);
+
+    // 8XY1 with VF = 5
+    chip8 = loadProgram(profile, { 0x6F05, 0x6003, 0x610C, 0x8011 });
+    step(*chip8, 4);
+    CHECK(chip8->getRegisterValue(0) == 0x0F);
+    CHECK(chip8->getRegisterValue(0xF) == (quirks.logicResetsVF ? 0 : 5));
+
+    // A taken skip in front of F000 NNNN
+    chip8 = loadProgram(profile, { 0x3000, 0xF000, 0x0300, 0x6107 });
+    step(*chip8, 1);
+    CHECK(chip8->getProgramCounter() == (quirks.xoExtensions ? 0x206 : 0x204));
+
+    // 5XY2 is still 5XY0 without the XO-CHIP opcodes
+    chip8 = loadProgram(profile, { 0xA000 | SPRITE_ADDR, 0x6101, 0x6301, 0x5132 });
+    step(*chip8, 4);
+    CHECK(chip8->getProgramCounter() == (quirks.xoExtensions ? 0x208 : 0x20A));
+    CHECK(chip8->getMachineCode(SPRITE_ADDR) == (quirks.xoExtensions ? 1 : 0));
+
+    return;
+}
+
+// 5XY2, 5XY3 and F000 NNNN under XO-CHIP
+static void checkExtensions() {
+    std::unique_ptr<Chip8> chip8 = loadProgram(QuirkProfile::XOChip, {
+        0xA000 | SPRITE_ADDR, 0x6101, 0x6202, 0x6303, 0x5132, 0x5312, 0x5643,
+        0xF000, SPRITE_ADDR + 0x10, 0x6055, 0xF055
+    });
+
+    // Both directions store at I and leave it there, the second store overwrites the first
+    step(*chip8, 5);
+    CHECK(chip8->getMachineCode(SPRITE_ADDR) == 1);
+    CHECK(chip8->getMachineCode(SPRITE_ADDR + 1) == 2);
+    CHECK(chip8->getMachineCode(SPRITE_ADDR + 2) == 3);
+
+    step(*chip8, 1);
+    CHECK(chip8->getMachineCode(SPRITE_ADDR) == 3);
+    CHECK(chip8->getMachineCode(SPRITE_ADDR + 2) == 1);
+    CHECK(chip8->getMachineCode(SPRITE_ADDR + 3) == 0);
+
+    // Loaded downwards from V6, so V6 gets the first byte
+    step(*chip8, 1);
+    CHECK(chip8->getRegisterValue(6) == 3);
+    CHECK(chip8->getRegisterValue(5) == 2);
+    CHECK(chip8->getRegisterValue(4) == 1);
+
+    step(*chip8, 1);
+    CHECK(chip8->getProgramCounter() == 0x212);
+
+    step(*chip8, 2);
+    CHECK(chip8->getMachineCode(SPRITE_ADDR + 0x10) == 0x55);
+
+    return;
+}
+
+// The block engine has to take the long skip the same way the interpreter does
+static void checkBlockExtensions() {
+    const std::initializer_list<unsigned short> program {
+        0x6000, 0x3000, 0xF000, SPRITE_ADDR, 0x6155, 0x4000, 0xF000, SPRITE_ADDR + 1,
+        0x6133, 0x5112, 0x1214
+    };
+    std::unique_ptr<Chip8> interpreted = loadProgram(QuirkProfile::XOChip, program);
+    std::unique_ptr<Chip8> compiled = loadProgram(QuirkProfile::XOChip, program);
+    InterpreterCore interpreter {};
+    BlockCore blocks {};
+
+    interpreter.run(*interpreted, 40);
+    blocks.run(*compiled, 40);
+
+    CHECK(interpreted->getProgramCounter() == 0x214);
+    CHECK(interpreted->getMachineCode(SPRITE_ADDR + 1) == 0x33);
+    CHECK(compiled->getStateHash() == interpreted->getStateHash());
+
+    return;
+}
+
+int main() {
+    checkScrolls();
+    checkLargeSprite();
+    for(QuirkProfile profile : Profiles)
+        checkQuirks(profile);
+    checkExtensions();
+    checkBlockExtensions();
+
+    if(failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("opcodes: all checks passed\n");
+
+    return 0;
+}
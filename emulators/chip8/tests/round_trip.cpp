@@ -0,0 +1,392 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "chip8.h"
+#include "cpu_core.h"
+#include "journal.h"
+#include "lz.h"
+#include "rom.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "trace.h"
+
+#ifndef CHIP8_TEST_ROM
+#define CHIP8_TEST_ROM      "Brix [Andreas Gustafsson, 1990].ch8"
+#endif
+
+#define ROUND_TRIP_FRAMES   600
+#define ROUND_TRIP_CYCLES   DEFAULT_CYCLES_PER_FRAME
+
+// Failed checks print where they are and the run carries on, the exit code says if any did
+static int failures {};
+
+#define CHECK(condition)                                                                \
+    do {                                                                                \
+        if(!(condition)) {                                                              \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                                 \
+        }                                                                               \
+    } while(0)
+
+// Same SplitMix64 as the machines, test data doesn't depend on the standard library's engines
+static unsigned long long nextRandom(unsigned long long& state) {
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+// Holds each key for a while, then lets go, so ROMs waiting on FX0A get both edges
+static unsigned short keysForFrame(unsigned int frame) {
+    return ((frame / 20) % 3 == 2) ? 0 : static_cast<unsigned short>(1 << ((frame / 60) % 16));
+}
+
+static std::string tempPath(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static void checkLz(const std::vector<unsigned char>& data) {
+    std::vector<unsigned char> compressed {};
+    std::vector<unsigned char> decompressed(data.size() + 1);
+
+    lzCompress(data.data(), data.size(), compressed);
+    CHECK(lzDecompress(compressed.data(), compressed.size(), decompressed.data(), data.size()) == 0);
+    CHECK(memcmp(decompressed.data(), data.data(), data.size()) == 0);
+
+    // Asking for more than was compressed, or losing part of the stream, is malformed
+    // There's no framing, so only cuts that drop output are caught
+    CHECK(lzDecompress(compressed.data(), compressed.size(), decompressed.data(), data.size() + 1) != 0);
+    if(!data.empty())
+        CHECK(lzDecompress(compressed.data(), compressed.size() / 2, decompressed.data(), data.size()) != 0);
+
+    return;
+}
+
+static void testLz() {
+    unsigned long long state { 1 };
+    std::vector<unsigned char> data {};
+
+    checkLz(data);
+
+    data = { 0x42 };
+    checkLz(data);
+
+    // Too short to match anything
+    data = { 1, 2, 3 };
+    checkLz(data);
+
+    // One long match, its length takes continuation bytes
+    data.assign(100000, 0);
+    checkLz(data);
+
+    // Nothing to match, literal length continuation and matches further back than an offset reaches
+    data.resize(LZ_MAX_OFFSET * 2);
+    for(auto &byte : data)
+        byte = static_cast<unsigned char>(nextRandom(state));
+    checkLz(data);
+
+    // Short records repeating with a few bytes changed, what traces look like
+    data.clear();
+    for(unsigned int record = 0; record < 20000; record++) {
+        unsigned char bytes[] = { 0x12, 0x34, 0x00, 0x05, static_cast<unsigned char>(record), 0xA2, 0x0A };
+        if(nextRandom(state) % 8 == 0)
+            bytes[2] = static_cast<unsigned char>(nextRandom(state));
+        data.insert(data.end(), bytes, bytes + sizeof(bytes));
+    }
+    checkLz(data);
+
+    return;
+}
+
+static bool sameEntry(const TraceEntry& a, const TraceEntry& b) {
+    return a.cycle == b.cycle && a.PC == b.PC && a.opcode == b.opcode &&
+           memcmp(a.registers.v, b.registers.v, sizeof(a.registers.v)) == 0 &&
+           memcmp(a.registers.stack, b.registers.stack, sizeof(a.registers.stack)) == 0 &&
+           a.registers.I == b.registers.I && a.registers.SP == b.registers.SP &&
+           a.registers.delay_timer == b.registers.delay_timer && a.registers.sound_timer == b.registers.sound_timer &&
+           a.writeLength == b.writeLength &&
+           (a.writeLength == 0 || (a.writeAddress == b.writeAddress && memcmp(a.writeData, b.writeData, a.writeLength) == 0));
+}
+
+// Enough random entries to fill several blocks, each one changing a few fields of the last
+static void testTraceEntries(bool compress) {
+    const std::string path = tempPath("chip8_round_trip.trace");
+    std::vector<TraceEntry> entries(50000);
+    unsigned long long state { 2 };
+    TraceEntry entry {};
+    TraceWriter writer;
+    TraceReader reader;
+
+    for(auto &recorded : entries) {
+        entry.cycle += 1 + (nextRandom(state) % 16 == 0 ? nextRandom(state) % 1000 : 0);
+        entry.PC = static_cast<unsigned short>(nextRandom(state) & (CHIP_8_MEM_SIZE - 1));
+        entry.opcode = static_cast<unsigned short>(nextRandom(state));
+        entry.registers.v[nextRandom(state) % REGISTER_COUNT] = static_cast<unsigned char>(nextRandom(state));
+        entry.registers.stack[nextRandom(state) % STACK_SIZE] = static_cast<unsigned short>(nextRandom(state) & 0xFFF);
+        entry.registers.I = static_cast<unsigned short>(nextRandom(state));
+        entry.registers.SP = static_cast<unsigned char>(nextRandom(state) % STACK_SIZE);
+        entry.registers.delay_timer = static_cast<unsigned short>(nextRandom(state) % 256);
+        entry.registers.sound_timer = static_cast<unsigned short>(nextRandom(state) % 256);
+
+        entry.writeLength = (nextRandom(state) % 4 == 0) ? static_cast<unsigned char>(1 + nextRandom(state) % TRACE_MAX_WRITE) : 0;
+        entry.writeAddress = static_cast<unsigned short>(nextRandom(state) & (CHIP_8_MEM_SIZE - 1));
+        for(unsigned char index = 0; index < entry.writeLength; index++)
+            entry.writeData[index] = static_cast<unsigned char>(nextRandom(state));
+
+        recorded = entry;
+    }
+
+    CHECK(writer.open(path, compress) == 0);
+    for(const auto &recorded : entries)
+        writer.record(recorded);
+    CHECK(writer.close() == 0);
+
+    CHECK(reader.open(path) == 0);
+    for(const auto &recorded : entries) {
+        if(!reader.next(entry)) {
+            CHECK(!"trace ended early");
+            break;
+        }
+        CHECK(sameEntry(entry, recorded));
+    }
+    CHECK(!reader.next(entry));
+    CHECK(!reader.hasError());
+
+    std::filesystem::remove(path);
+
+    return;
+}
+
+// TraceCore on a real ROM ends where the interpreter does, and the last entry shows it
+static void testTraceCore(const std::string& rom) {
+    const std::string path = tempPath("chip8_round_trip_core.trace");
+    Chip8 traced, reference;
+    FileRomManager romManager;
+    InterpreterCore interpreter;
+    TraceWriter writer;
+    TraceReader reader;
+    TraceEntry entry {};
+    TraceEntry last {};
+    unsigned long long entries {};
+
+    CHECK(romManager.loadRom(rom, traced) == 0);
+    CHECK(romManager.loadRom(rom, reference) == 0);
+    CHECK(writer.open(path, true) == 0);
+
+    TraceCore core(writer);
+    FrameScheduler tracedScheduler(ROUND_TRIP_CYCLES, true);
+    FrameScheduler referenceScheduler(ROUND_TRIP_CYCLES, true);
+    for(unsigned int frame = 0; frame < ROUND_TRIP_FRAMES; frame++) {
+        traced.setKeyMask(keysForFrame(frame));
+        reference.setKeyMask(keysForFrame(frame));
+        tracedScheduler.runFrame(traced, core);
+        referenceScheduler.runFrame(reference, interpreter);
+    }
+    CHECK(writer.close() == 0);
+    CHECK(traced.getStateHash() == reference.getStateHash());
+
+    CHECK(reader.open(path) == 0);
+    while(reader.next(entry)) {
+        last = entry;
+        entries++;
+    }
+    CHECK(!reader.hasError());
+    CHECK(entries != 0);
+    CHECK(last.cycle == traced.getCycleCount());
+
+    std::filesystem::remove(path);
+
+    return;
+}
+
+// FX55 at I=0xFFC writes the top four bytes, then wraps to the bottom of memory
+static void testTraceWrappedStore() {
+    const unsigned char program[] = {
+        0xAF, 0xFC,     // LD I, 0xFFC
+        0x60, 0x11, 0x61, 0x22, 0x62, 0x33, 0x63, 0x44, 0x64, 0x55, 0x65, 0x66, 0x66, 0x77,
+        0xF6, 0x55,     // LD [I], V0-V6
+        0x12, 0x12,     // JP 0x212
+    };
+    const std::string romPath = tempPath("chip8_round_trip_wrap.ch8");
+    const std::string path = tempPath("chip8_round_trip_wrap.trace");
+    Chip8 chip8;
+    FileRomManager romManager;
+    TraceWriter writer;
+    TraceReader reader;
+    TraceEntry entry {};
+    unsigned int stores {};
+
+    FILE* file = fopen(romPath.c_str(), "wb");
+    CHECK(file != nullptr);
+    if(file == nullptr)
+        return;
+    fwrite(program, 1, sizeof(program), file);
+    fclose(file);
+
+    CHECK(romManager.loadRom(romPath, chip8) == 0);
+    CHECK(writer.open(path, false) == 0);
+    TraceCore core(writer);
+    core.run(chip8, 10);
+    CHECK(writer.close() == 0);
+
+    CHECK(reader.open(path) == 0);
+    while(reader.next(entry)) {
+        if(entry.writeLength == 0)
+            continue;
+
+        const unsigned char expected[] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77 };
+        CHECK(entry.writeAddress == 0xFFC);
+        CHECK(entry.writeLength == sizeof(expected));
+        CHECK(memcmp(entry.writeData, expected, sizeof(expected)) == 0);
+        stores++;
+    }
+    CHECK(stores == 1);
+
+    std::filesystem::remove(romPath);
+    std::filesystem::remove(path);
+
+    return;
+}
+
+static void testSnapshot(const std::string& rom) {
+    Chip8 chip8, restored;
+    FileRomManager romManager;
+    InterpreterCore interpreter;
+    FrameScheduler scheduler(ROUND_TRIP_CYCLES, true);
+    Snapshot copy;
+
+    CHECK(romManager.loadRom(rom, chip8) == 0);
+    chip8.seedRandom(7);
+    for(unsigned int frame = 0; frame < ROUND_TRIP_FRAMES; frame++) {
+        chip8.setKeyMask(keysForFrame(frame));
+        scheduler.runFrame(chip8, interpreter);
+    }
+
+    const Snapshot snapshot = chip8.takeSnapshot();
+    const std::vector<unsigned char> image = snapshot.serialize();
+    CHECK(Snapshot::deserialize(image, copy) == 0);
+
+    const SnapshotDiff diff = Snapshot::diff(snapshot, copy);
+    CHECK(diff.changedPages == 0 && diff.changedRegisters == 0);
+    CHECK(!diff.programCounter && !diff.stackPointer && !diff.indexRegister && !diff.timers);
+    CHECK(!diff.stack && !diff.display && !diff.audio);
+    CHECK(copy.serialize() == image);
+
+    // A fresh machine picks up exactly where the first one was, and keeps up with it
+    restored.restoreSnapshot(copy);
+    CHECK(restored.getStateHash() == chip8.getStateHash());
+
+    FrameScheduler restoredScheduler(ROUND_TRIP_CYCLES, true);
+    for(unsigned int frame = ROUND_TRIP_FRAMES; frame < ROUND_TRIP_FRAMES * 2; frame++) {
+        chip8.setKeyMask(keysForFrame(frame));
+        restored.setKeyMask(keysForFrame(frame));
+        scheduler.runFrame(chip8, interpreter);
+        restoredScheduler.runFrame(restored, interpreter);
+    }
+    CHECK(restored.getStateHash() == chip8.getStateHash());
+
+    // Short images are rejected rather than read past
+    std::vector<unsigned char> truncated(image.begin(), image.end() - 1);
+    CHECK(Snapshot::deserialize(truncated, copy) != 0);
+
+    // So are PC, SP and plane masks that would index past memory, the stack or the planes
+    // PC sits after the magic and version, SP right after it, the plane mask after hires
+    const size_t planeMaskOffset = 4 + 2 + 2 + 1 + 2 + 2 + 2 + 2 + 8 + 8 + SNAPSHOT_REGISTER_COUNT + SNAPSHOT_STACK_SIZE * 2 + 1;
+    for(const auto &[offset, value] : std::vector<std::pair<size_t, unsigned char>>{ {7, 0x10}, {8, SNAPSHOT_STACK_SIZE + 1}, {planeMaskOffset, 4} }) {
+        std::vector<unsigned char> corrupt = image;
+        corrupt[offset] = value;
+        CHECK(Snapshot::deserialize(corrupt, copy) != 0);
+    }
+
+    return;
+}
+
+static void testJournal(const std::string& rom) {
+    const std::string path = tempPath("chip8_round_trip.journal");
+    const unsigned long long seed { 0x1234 };
+    std::unique_ptr<Chip8> chip8 = std::make_unique<Chip8>();
+    FileRomManager romManager;
+    InterpreterCore interpreter;
+    InputJournal journal, loaded;
+
+    CHECK(romManager.loadRom(rom, *chip8) == 0);
+    chip8->seedRandom(seed);
+    journal.begin(*chip8, seed, ROUND_TRIP_CYCLES);
+
+    // Keys change mid frame too, so replays have to split slices at the right instruction
+    FrameScheduler scheduler(ROUND_TRIP_CYCLES, true);
+    for(unsigned int frame = 0; frame < ROUND_TRIP_FRAMES; frame++) {
+        chip8->setKeyMask(keysForFrame(frame));
+        journal.recordInput(chip8->getCycleCount(), keysForFrame(frame));
+        interpreter.run(*chip8, ROUND_TRIP_CYCLES / 2);
+
+        chip8->setKeyMask(keysForFrame(frame + 7));
+        journal.recordInput(chip8->getCycleCount(), keysForFrame(frame + 7));
+        interpreter.run(*chip8, ROUND_TRIP_CYCLES - ROUND_TRIP_CYCLES / 2);
+
+        chip8->tickTimers();
+        journal.recordFrame(*chip8);
+    }
+    const unsigned long long finalHash = chip8->getStateHash();
+
+    CHECK(journal.save(path) == 0);
+    CHECK(InputJournal::load(path, loaded) == 0);
+    CHECK(loaded.getSeed() == journal.getSeed());
+    CHECK(loaded.getCyclesPerFrame() == journal.getCyclesPerFrame());
+    CHECK(loaded.getQuirkProfile() == journal.getQuirkProfile());
+    CHECK(loaded.getInitialHash() == journal.getInitialHash());
+    CHECK(loaded.getFrameHashes() == journal.getFrameHashes());
+    CHECK(loaded.getEvents().size() == journal.getEvents().size());
+    for(size_t index = 0; index < std::min(loaded.getEvents().size(), journal.getEvents().size()); index++) {
+        CHECK(loaded.getEvents()[index].cycle == journal.getEvents()[index].cycle);
+        CHECK(loaded.getEvents()[index].keyMask == journal.getEvents()[index].keyMask);
+    }
+
+    // Played back on a fresh machine it matches every recorded frame
+    chip8 = std::make_unique<Chip8>();
+    CHECK(romManager.loadRom(rom, *chip8) == 0);
+    chip8->setQuirkProfile(loaded.getQuirkProfile());
+    chip8->seedRandom(loaded.getSeed());
+    CHECK(chip8->getStateHash() == loaded.getInitialHash());
+
+    JournalPlayer player(loaded);
+    while(!player.finished()) {
+        player.runFrame(*chip8, interpreter);
+        if(!player.frameMatches(*chip8)) {
+            CHECK(!"replay diverged");
+            break;
+        }
+    }
+    CHECK(chip8->getStateHash() == finalHash);
+
+    CHECK(InputJournal::load(tempPath("chip8_round_trip_missing.journal"), loaded) != 0);
+    std::filesystem::remove(path);
+
+    return;
+}
+
+int main(int argc, char* argv[]) {
+    const std::string rom = (argc > 1) ? argv[1] : CHIP8_TEST_ROM;
+
+    testLz();
+    testTraceEntries(false);
+    testTraceEntries(true);
+    testTraceCore(rom);
+    testTraceWrappedStore();
+    testSnapshot(rom);
+    testJournal(rom);
+
+    if(failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("OK\n");
+
+    return 0;
+}